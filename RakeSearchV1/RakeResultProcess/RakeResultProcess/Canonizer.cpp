@@ -0,0 +1,326 @@
+﻿// Канонизатор диагональных латинских квадратов и пар ОДЛК
+
+# include <string.h>
+# include "Canonizer.h"
+
+using namespace std;
+
+// Конструктор для квадратов ранга squareRank
+Canonizer::Canonizer(int squareRank)
+{
+	rank = squareRank;
+	cellsCount = rank*rank;
+	half = rank / 2;
+	componentsCount = 0;
+	minType = 0;
+}
+
+
+// Каноническая форма квадрата
+void Canonizer::CanonizeSquare(const uint8_t* square, uint8_t* canonical)
+{
+	components[0] = square;
+	componentsCount = 1;
+	Canonize(canonical);
+}
+
+
+// Каноническая форма пары
+void Canonizer::CanonizePair(const uint8_t* a, const uint8_t* b, uint8_t* canonical)
+{
+	components[0] = a;
+	components[1] = b;
+	componentsCount = 2;
+	Canonize(canonical);
+}
+
+
+// Поиск канонической формы: перебор M-преобразований с отсечением по цикловому типу первых строк
+void Canonizer::Canonize(uint8_t* canonical)
+{
+	PrepareTypes();
+	memset(best, 0xFF, componentsCount*cellsCount);
+	memset(isPairUsed, 0, sizeof(isPairUsed));
+
+	// Центральная строка квадрата нечётного ранга остаётся на месте
+	if (rank % 2 == 1)
+	{
+		q[half] = half;
+	}
+
+	Enumerate(0);
+	memcpy(canonical, best, componentsCount*cellsCount);
+}
+
+
+// Цикловой тип перестановки, переводящей строку first в строку second: длины циклов по убыванию,
+// упакованные по 4 бита (длина - 1). При одном ранге разные типы дают разные значения
+uint64_t Canonizer::CycleType(const uint8_t* first, const uint8_t* second)
+{
+	int next[MaxRank];
+	int isVisited[MaxRank];
+	int lengths[MaxRank];
+	int lengthsCount = 0;
+	uint64_t type = 0;
+
+	for (int i = 0; i < rank; i++)
+	{
+		next[first[i]] = second[i];
+		isVisited[i] = 0;
+	}
+
+	for (int value = 0; value < rank; value++)
+	{
+		int length = 0;
+
+		for (int current = value; !isVisited[current]; current = next[current])
+		{
+			isVisited[current] = 1;
+			length++;
+		}
+
+		if (length > 0)
+		{
+			// Вставка с сохранением порядка по убыванию
+			int position = lengthsCount++;
+
+			while (position > 0 && lengths[position - 1] < length)
+			{
+				lengths[position] = lengths[position - 1];
+				position--;
+			}
+
+			lengths[position] = length;
+		}
+	}
+
+	for (int i = 0; i < lengthsCount; i++)
+	{
+		type |= (uint64_t) (lengths[i] - 1) << (60 - 4*i);
+	}
+
+return type;
+}
+
+
+// Вычисление цикловых типов всех пар строк и столбцов исходных квадратов и наименьшего типа
+// среди пар, которые могут стать первыми двумя строками: нецентральные строки (столбцы), не симметричные друг другу
+void Canonizer::PrepareTypes()
+{
+	uint8_t columns[MaxCells];
+
+	minType = ~0ULL;
+
+	for (int componentId = 0; componentId < componentsCount; componentId++)
+	{
+		const uint8_t* square = components[componentId];
+
+		for (int i = 0; i < rank; i++)
+		{
+			for (int j = 0; j < rank; j++)
+			{
+				columns[j*rank + i] = square[i*rank + j];
+			}
+		}
+
+		for (int first = 0; first < rank; first++)
+		{
+			for (int second = 0; second < rank; second++)
+			{
+				if (first == second)
+				{
+					continue;
+				}
+
+				rowTypes[componentId][first][second] = CycleType(square + first*rank, square + second*rank);
+				columnTypes[componentId][first][second] = CycleType(columns + first*rank, columns + second*rank);
+
+				if (IsFirstRowsPair(first, second))
+				{
+					if (rowTypes[componentId][first][second] < minType)
+					{
+						minType = rowTypes[componentId][first][second];
+					}
+
+					if (columnTypes[componentId][first][second] < minType)
+					{
+						minType = columnTypes[componentId][first][second];
+					}
+				}
+			}
+		}
+	}
+
+	// Строки и столбцы, с которых может начинаться результат
+	for (int componentId = 0; componentId < componentsCount; componentId++)
+	{
+		for (int first = 0; first < rank; first++)
+		{
+			isMinRow[componentId][first] = 0;
+			isMinColumn[componentId][first] = 0;
+
+			for (int second = 0; second < rank; second++)
+			{
+				if (first != second && IsFirstRowsPair(first, second))
+				{
+					isMinRow[componentId][first] |= rowTypes[componentId][first][second] == minType;
+					isMinColumn[componentId][first] |= columnTypes[componentId][first][second] == minType;
+				}
+			}
+		}
+	}
+}
+
+
+// Проверка того, что строки first и second могут стать первыми двумя строками результата:
+// они не центральные и не симметричны друг другу
+int Canonizer::IsFirstRowsPair(int first, int second)
+{
+	return second != rank - 1 - first && !(rank % 2 == 1 && (first == half || second == half));
+}
+
+
+// Перебор M-преобразований: позициям (position, rank - 1 - position) назначается пара симметричных строк
+// в одной из двух ориентаций. После выбора первых двух пар известны первые две строки результата для всех
+// вариантов поворота, и ветви без наименьшего циклового типа отсекаются
+void Canonizer::Enumerate(int position)
+{
+	if (position == half)
+	{
+		for (int variant = 0; variant < 4; variant++)
+		{
+			for (int order = 0; order < componentsCount; order++)
+			{
+				Evaluate(variant, order);
+			}
+		}
+
+		return;
+	}
+
+	for (int pairId = 0; pairId < half; pairId++)
+	{
+		if (isPairUsed[pairId])
+		{
+			continue;
+		}
+
+		isPairUsed[pairId] = 1;
+
+		for (int orientation = 0; orientation < 2; orientation++)
+		{
+			q[position] = orientation ? rank - 1 - pairId : pairId;
+			q[rank - 1 - position] = rank - 1 - q[position];
+
+			// Отсечение по первой строке: она должна входить в пару наименьшего типа
+			if (position == 0)
+			{
+				int isViable = 0;
+
+				for (int order = 0; order < componentsCount && !isViable; order++)
+				{
+					isViable = isMinRow[order][q[0]] || isMinColumn[order][q[0]]
+						|| isMinRow[order][rank - 1 - q[0]] || isMinColumn[order][rank - 1 - q[0]];
+				}
+
+				if (!isViable)
+				{
+					continue;
+				}
+			}
+
+			// Отсечение по первым двум строкам
+			if (position == 1)
+			{
+				int isViable = 0;
+
+				for (int order = 0; order < componentsCount && !isViable; order++)
+				{
+					int a = q[0];
+					int b = q[1];
+
+					isViable = rowTypes[order][a][b] == minType || columnTypes[order][a][b] == minType
+						|| rowTypes[order][rank - 1 - a][rank - 1 - b] == minType
+						|| columnTypes[order][rank - 1 - a][rank - 1 - b] == minType;
+				}
+
+				if (!isViable)
+				{
+					continue;
+				}
+			}
+
+			Enumerate(position + 1);
+		}
+
+		isPairUsed[pairId] = 0;
+	}
+}
+
+
+// Построение преобразованного варианта и сравнение с лучшей формой с ранним выходом.
+// variant: бит 0 - транспонирование, бит 1 - обращение порядка строк (вместе с M-преобразованиями дают все
+// повороты и отражения); order - порядок квадратов пары. Строки с неподходящим цикловым типом пропускаются
+void Canonizer::Evaluate(int variant, int order)
+{
+	const int* rows = q;
+	int reversed[MaxRank];
+	int isBetter = 0;
+
+	if (variant & 2)
+	{
+		for (int i = 0; i < rank; i++)
+		{
+			reversed[i] = q[rank - 1 - i];
+		}
+
+		rows = reversed;
+	}
+
+	// Отсечение по цикловому типу первых двух строк
+	if (((variant & 1) ? columnTypes[order][rows[0]][rows[1]] : rowTypes[order][rows[0]][rows[1]]) != minType)
+	{
+		return;
+	}
+
+	for (int componentId = 0; componentId < componentsCount; componentId++)
+	{
+		const uint8_t* square = components[componentId ^ order];
+		uint8_t* target = best + componentId*cellsCount;
+		int labels[MaxRank];
+		int nextLabel = 0;
+
+		memset(labels, -1, sizeof(labels));
+
+		for (int i = 0; i < rank; i++)
+		{
+			for (int j = 0; j < rank; j++)
+			{
+				int cellId = i*rank + j;
+				int value = (variant & 1) ? square[q[j]*rank + rows[i]] : square[rows[i]*rank + q[j]];
+
+				if (labels[value] < 0)
+				{
+					labels[value] = nextLabel++;
+				}
+
+				value = labels[value];
+
+				if (!isBetter)
+				{
+					if (value > target[cellId])
+					{
+						return;
+					}
+
+					isBetter = value < target[cellId];
+				}
+
+				if (isBetter)
+				{
+					target[cellId] = (uint8_t) value;
+				}
+			}
+		}
+	}
+}
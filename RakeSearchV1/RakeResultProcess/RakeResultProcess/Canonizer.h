@@ -0,0 +1,53 @@
+﻿// Канонизатор диагональных латинских квадратов и пар ОДЛК
+
+# if !defined Canonizer_h
+# define Canonizer_h
+
+# include <stdint.h>
+# include "Result.h"
+
+using namespace std;
+
+// Каноническая форма - лексикографически наименьший (построчно) квадрат, получаемый из исходного
+// преобразованиями, сохраняющими диагональность: M-преобразованиями (одинаковой симметричной перестановкой
+// строк и столбцов), поворотами и отражениями, с последующей нормализацией значений по порядку их появления.
+// Минимум берётся только среди преобразований, при которых у первых двух строк наименьший цикловой тип
+// (тип перестановки, переводящей одну строку в другую), - это инвариант, отсекающий почти все ветви перебора.
+// Для пары (A, B) одно преобразование применяется к обоим квадратам, значения нормализуются независимо,
+// учитываются оба порядка квадратов
+class Canonizer
+{
+public:
+	static const int MaxRank = Result::MaxRank;			// Наибольший ранг квадрата
+	static const int MaxCells = MaxRank*MaxRank;		// Наибольшее число клеток квадрата
+	static const int MinRank = 4;						// Наименьший ранг квадрата (диагональных латинских квадратов ранга 2 и 3 нет)
+
+	Canonizer(int squareRank);											// Конструктор для квадратов ранга squareRank
+	void CanonizeSquare(const uint8_t* square, uint8_t* canonical);		// Каноническая форма квадрата (по байту на клетку)
+	void CanonizePair(const uint8_t* a, const uint8_t* b, uint8_t* canonical);	// Каноническая форма пары: два квадрата подряд
+
+protected:
+private:
+	void Canonize(uint8_t* canonical);					// Поиск канонической формы для заданных компонент
+	uint64_t CycleType(const uint8_t* first, const uint8_t* second);	// Цикловой тип перестановки, переводящей строку first в second
+	void PrepareTypes();								// Вычисление цикловых типов пар строк и столбцов и наименьшего из них
+	int IsFirstRowsPair(int first, int second);			// Проверка допустимости пары первых строк
+	void Enumerate(int position);						// Перебор M-преобразований по парам симметричных позиций
+	void Evaluate(int variant, int order);				// Сравнение преобразованного квадрата с лучшим найденным
+
+	int rank;							// Ранг квадрата
+	int cellsCount;						// Число клеток квадрата
+	int half;							// Число пар симметричных позиций
+	int componentsCount;				// Число квадратов (1 - квадрат, 2 - пара)
+	const uint8_t* components[2];		// Исходные квадраты
+	uint64_t rowTypes[2][MaxRank][MaxRank];		// Цикловые типы пар строк квадратов
+	uint64_t columnTypes[2][MaxRank][MaxRank];	// Цикловые типы пар столбцов квадратов
+	uint64_t minType;					// Наименьший цикловой тип пары первых строк
+	int isMinRow[2][MaxRank];			// Флаги строк, входящих в пару наименьшего типа
+	int isMinColumn[2][MaxRank];		// Флаги столбцов, входящих в пару наименьшего типа
+	int q[MaxRank];						// Текущее M-преобразование: строка i результата - строка q[i] исходного квадрата
+	int isPairUsed[MaxRank];			// Флаги использованных пар симметричных строк
+	uint8_t best[2*MaxCells];			// Лучшая найденная форма
+};
+
+# endif
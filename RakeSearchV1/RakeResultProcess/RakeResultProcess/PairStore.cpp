@@ -0,0 +1,143 @@
+﻿// Двоичное хранилище пар ОДЛК
+
+# include <string.h>
+# include "PairStore.h"
+# include "Result.h"
+
+using namespace std;
+
+const char PairStore::Signature[8] = { 'R', 'S', 'P', 'A', 'I', 'R', '0', '1' };
+
+// Конструктор по умолчанию
+PairStore::PairStore()
+{
+	rank = 0;
+	pairsCount = 0;
+}
+
+
+// Деструктор
+PairStore::~PairStore()
+{
+	Close();
+}
+
+
+// Чтение всех пар хранилища
+int PairStore::Read(string fileName, int& rank, vector<uint8_t>& pairs, long long& count)
+{
+	fstream storeFile;
+	uint8_t header[HeaderSize];
+	uint32_t headerRank;
+	uint32_t recordSize;
+	uint64_t headerCount;
+
+	storeFile.open(fileName.c_str(), std::ios_base::in | std::ios_base::binary);
+
+	if (!storeFile.is_open())
+	{
+		return 0;
+	}
+
+	storeFile.read((char*) header, HeaderSize);
+	memcpy(&headerRank, header + 8, sizeof(headerRank));
+	memcpy(&recordSize, header + 12, sizeof(recordSize));
+	memcpy(&headerCount, header + 16, sizeof(headerCount));
+
+	if (storeFile.fail() || memcmp(header, Signature, sizeof(Signature)) != 0 || headerRank > Result::MaxRank
+		|| recordSize != (uint32_t) Result::RecordSize(headerRank))
+	{
+		return 0;
+	}
+
+	rank = headerRank;
+	count = headerCount;
+	pairs.resize((size_t) count*2*recordSize);
+	storeFile.read((char*) pairs.data(), pairs.size());
+
+return !storeFile.fail();
+}
+
+
+// Создание файла хранилища с пустым заголовком
+int PairStore::Create(string fileName)
+{
+	Close();
+	rank = 0;
+	pairsCount = 0;
+
+	storeFile.open(fileName.c_str(), std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+
+	if (!storeFile.is_open())
+	{
+		return 0;
+	}
+
+	WriteHeader();
+
+return 1;
+}
+
+
+// Запись пар; все пары хранилища должны иметь один ранг
+int PairStore::Write(int pairsRank, const uint8_t* pairs, long long count)
+{
+	if (count == 0)
+	{
+		return 1;
+	}
+
+	if (rank != 0 && pairsRank != rank)
+	{
+		return 0;
+	}
+
+	rank = pairsRank;
+	storeFile.write((const char*) pairs, count*2*Result::RecordSize(rank));
+	pairsCount += count;
+
+return 1;
+}
+
+
+// Запись заголовка с итоговым числом пар и закрытие файла
+void PairStore::Close()
+{
+	if (storeFile.is_open())
+	{
+		WriteHeader();
+		storeFile.close();
+	}
+}
+
+
+// Число записанных пар
+long long PairStore::Count()
+{
+	return pairsCount;
+}
+
+
+// Запись заголовка: сигнатура, ранг, размер упакованного квадрата (uint32) и число пар (uint64)
+void PairStore::WriteHeader()
+{
+	uint8_t header[HeaderSize];
+	uint32_t headerRank = rank;
+	uint32_t recordSize = Result::RecordSize(rank);
+	uint64_t headerCount = pairsCount;
+	std::streampos endPosition = storeFile.tellp();
+
+	memset(header, 0, HeaderSize);
+	memcpy(header, Signature, sizeof(Signature));
+	memcpy(header + 8, &headerRank, sizeof(headerRank));
+	memcpy(header + 12, &recordSize, sizeof(recordSize));
+	memcpy(header + 16, &headerCount, sizeof(headerCount));
+
+	storeFile.seekp(0);
+	storeFile.write((const char*) header, HeaderSize);
+
+	if (endPosition > (std::streampos) HeaderSize)
+	{
+		storeFile.seekp(endPosition);
+	}
+}
@@ -0,0 +1,39 @@
+﻿// Двоичное хранилище пар ОДЛК
+
+# if !defined PairStore_h
+# define PairStore_h
+
+# include <fstream>
+# include <string>
+# include <vector>
+# include <stdint.h>
+
+using namespace std;
+
+// Формат файла: заголовок из 32 байт (сигнатура, ранг, размер упакованного квадрата, число пар),
+// затем пары - упакованный квадрат A и упакованный квадрат B, по полбайта на клетку
+class PairStore
+{
+public:
+	PairStore();								// Конструктор по умолчанию
+	~PairStore();								// Деструктор - закрытие файла
+
+	static int Read(string fileName, int& rank, vector<uint8_t>& pairs, long long& count);	// Чтение хранилища; возвращает 1 в случае успеха
+	int Create(string fileName);				// Создание файла хранилища; возвращает 1 в случае успеха
+	int Write(int rank, const uint8_t* pairs, long long count);	// Запись count пар ранга rank; возвращает 0 при несовпадении ранга
+	void Close();								// Запись заголовка и закрытие файла
+	long long Count();							// Число записанных пар
+
+protected:
+private:
+	static const char Signature[8];				// Сигнатура файла
+	static const int HeaderSize = 32;			// Размер заголовка файла
+
+	void WriteHeader();							// Запись заголовка в начало файла
+
+	fstream storeFile;			// Файл хранилища
+	int rank;					// Ранг квадратов (0 - пар ещё нет)
+	long long pairsCount;		// Число записанных пар
+};
+
+# endif
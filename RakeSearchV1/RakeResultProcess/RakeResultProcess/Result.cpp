@@ -1,5 +1,7 @@
 ﻿# include <fstream>
 # include <string>
+# include <sstream>
+# include <string.h>
 
 # include "Result.h"
 
@@ -7,59 +9,299 @@ using namespace std;
 
 // Конструктор по умолчанию
 Result::Result()
+{
+	Reset();
+}
+
+
+// Сброс данных результата
+void Result::Reset()
 {
 	TotalPairs = 0;
 	TotalSquaresWithPairs = 0;
 	SquaresProcessed = 0;
+	TotalsCount = 0;
+	Rank = 0;
+	PairsCount = 0;
+	Pairs.clear();
+	IsError = 0;
 }
 
 
 // Чтение данных результата из файла
 void Result::Read(istream& is)
 {
-	string markerTotalPairs = "# Total pairs found: ";						// Подстрока - маркер числа найденных пар
-	string markerTotalSquaresWithPairs = "# Total squares with pairs: ";	// Подстрока - маркер числа квадратов в парах
-	string markerSquaresProcessed_A = "# Processes ";						// Подстрока - начало строки с числом обработанных квадратов
-	string markerSquaresProcessed_B = " milliards ";						// Подстрока - вставка с числом миллиардов
-	string markerSquaresProcessed_C = " squares";							// Подстрока - отрезаемое окончание после числа квадратов
-
-	string line;									// Читаемая строка
-	string lineTotalPairs;							// Строка с числом найденных пар
-	string lineTotalSquaresWithPairs;				// Строка с числом квадратов, входящих в пары
-	string lineSquaresProcessed;					// Строка с числом обработанных квадратов
-
-	int markerTotalPairsLength = markerTotalPairs.length();
-
-	int milliards;			// Число миллиардов квадратов
-	int squares;			// Число квадратов в рамках миллиарда
-	size_t milliardsStart;
-	size_t milliardsEnds;
-	size_t squaresStart;
-	size_t squaresEnds;
-
-	// Поиск маркера итогов
-	do
+	stringstream buffer;
+	string text;
+
+	buffer << is.rdbuf();
+	text = buffer.str();
+	Parse(text.data(), text.size());
+}
+
+
+// Размер упакованного квадрата ранга rank
+int Result::RecordSize(int rank)
+{
+	return (rank*rank + 1) / 2;
+}
+
+
+// Упаковка квадрата: по полбайта на клетку, чётные клетки - в младших половинах байт
+void Result::PackSquare(const uint8_t* cells, int rank, uint8_t* record)
+{
+	memset(record, 0, RecordSize(rank));
+
+	for (int cellId = 0; cellId < rank*rank; cellId++)
+	{
+		record[cellId / 2] |= (uint8_t) (cells[cellId] << (4*(cellId % 2)));
+	}
+}
+
+
+// Распаковка квадрата: по байту на клетку
+void Result::UnpackSquare(const uint8_t* record, int rank, uint8_t* cells)
+{
+	for (int cellId = 0; cellId < rank*rank; cellId++)
+	{
+		cells[cellId] = (record[cellId / 2] >> (4*(cellId % 2))) & 0xF;
+	}
+}
+
+
+// Разбор текста результата. Файл результата состоит из блоков пар и блоков итогов:
+//   {                                   - начало блока пар
+//   # ... комментарии ...
+//   { квадрат A }
+//   # ------------------------
+//   { квадрат B1 } { квадрат B2 } ...   - квадраты, ортогональные квадрату A
+//   # Square i # j, # Pairs found: N
+//   }                                   - окончание блока пар
+//   # Total pairs found: N, # Total squares with pairs: N, # Processed N squares - итоги
+// Итоги всех блоков файла суммируются; поддерживается также старая строка "# Processes N milliards M squares"
+int Result::Parse(const char* data, size_t size)
+{
+	const char* position = data;
+	const char* end = data + size;
+	int depth = 0;							// Уровень вложенности фигурных скобок
+	int squaresInBlock = 0;					// Число квадратов, прочитанных в текущем блоке пар
+	uint8_t squareA[MaxRank*MaxRank / 2];	// Квадрат A текущего блока пар
+	uint8_t squareB[MaxRank*MaxRank / 2];	// Очередной квадрат B текущего блока пар
+
+	Reset();
+
+	while (position < end && !IsError)
+	{
+		const char* lineEnd = (const char*) memchr(position, '\n', end - position);
+
+		if (lineEnd == NULL)
+		{
+			lineEnd = end;
+		}
+
+		// Пропуск ведущих пробелов
+		while (position < lineEnd && (*position == ' ' || *position == '\t' || *position == '\r'))
+		{
+			position++;
+		}
+
+		if (position < lineEnd && *position == '#')
+		{
+			ParseComment(position, lineEnd);
+		}
+		else if (position < lineEnd && *position == '{')
+		{
+			if (depth == 0)
+			{
+				// Начало блока пар
+				depth = 1;
+				squaresInBlock = 0;
+			}
+			else
+			{
+				// Квадрат блока пар: первый - квадрат A, остальные - его пары
+				if (!ParseSquare(position, end, squaresInBlock == 0 ? squareA : squareB))
+				{
+					IsError = 1;
+					break;
+				}
+
+				if (squaresInBlock > 0)
+				{
+					Pairs.insert(Pairs.end(), squareA, squareA + RecordSize(Rank));
+					Pairs.insert(Pairs.end(), squareB, squareB + RecordSize(Rank));
+					PairsCount++;
+				}
+
+				squaresInBlock++;
+
+				// Продолжение с символа после квадрата
+				continue;
+			}
+		}
+		else if (position < lineEnd && *position == '}')
+		{
+			// Окончание блока пар
+			if (depth == 0)
+			{
+				IsError = 1;
+			}
+
+			depth = 0;
+		}
+
+		position = lineEnd + 1;
+	}
+
+	// Незакрытый блок пар
+	if (depth != 0)
+	{
+		IsError = 1;
+	}
+
+return !IsError;
+}
+
+
+// Проверка того, что строка начинается с маркера
+int Result::StartsWith(const char* position, const char* lineEnd, const char* marker)
+{
+	size_t length = strlen(marker);
+
+	return (size_t) (lineEnd - position) >= length && memcmp(position, marker, length) == 0;
+}
+
+
+// Чтение неотрицательного числа с пропуском предшествующих пробелов
+long long Result::ParseNumber(const char*& position, const char* end)
+{
+	long long value = 0;
+
+	while (position < end && (*position == ' ' || *position == '\t'))
+	{
+		position++;
+	}
+
+	while (position < end && *position >= '0' && *position <= '9')
+	{
+		value = value*10 + (*position - '0');
+		position++;
+	}
+
+return value;
+}
+
+
+// Разбор строки-комментария: из строк итогов извлекаются числа, остальные строки пропускаются
+void Result::ParseComment(const char* position, const char* lineEnd)
+{
+	const char* markerTotalPairs = "# Total pairs found: ";						// Маркер числа найденных пар
+	const char* markerTotalSquaresWithPairs = "# Total squares with pairs: ";	// Маркер числа квадратов в парах
+	const char* markerSquaresProcessed = "# Processed ";						// Маркер числа обработанных квадратов
+	const char* markerLegacyProcessed = "# Processes ";							// Маркер старой строки с числом обработанных квадратов
+	const char* markerLegacyMilliards = " milliards ";							// Вставка с числом миллиардов в старой строке
+
+	if (StartsWith(position, lineEnd, markerTotalPairs))
+	{
+		position += strlen(markerTotalPairs);
+		TotalPairs += ParseNumber(position, lineEnd);
+		TotalsCount++;
+	}
+	else if (StartsWith(position, lineEnd, markerTotalSquaresWithPairs))
 	{
-		std::getline(is, line);
+		position += strlen(markerTotalSquaresWithPairs);
+		TotalSquaresWithPairs += ParseNumber(position, lineEnd);
 	}
-	while (line.substr(0, markerTotalPairsLength) != markerTotalPairs);
+	else if (StartsWith(position, lineEnd, markerSquaresProcessed))
+	{
+		position += strlen(markerSquaresProcessed);
+		SquaresProcessed += ParseNumber(position, lineEnd);
+	}
+	else if (StartsWith(position, lineEnd, markerLegacyProcessed))
+	{
+		long long milliards;
 
-	// Чтение итогов
-	lineTotalPairs = line;
-	std::getline(is, lineTotalSquaresWithPairs);
-	std::getline(is, lineSquaresProcessed);
+		position += strlen(markerLegacyProcessed);
+		milliards = ParseNumber(position, lineEnd);
 
-	// Извлечение итогов из строк
-	TotalPairs = std::stoi(lineTotalPairs.substr(markerTotalPairs.length()));
-	TotalSquaresWithPairs = std::stoi(lineTotalSquaresWithPairs.substr(markerTotalSquaresWithPairs.length()));
+		if (StartsWith(position, lineEnd, markerLegacyMilliards))
+		{
+			position += strlen(markerLegacyMilliards);
+			SquaresProcessed += milliards*1000000000LL + ParseNumber(position, lineEnd);
+		}
+	}
+}
 
-	milliardsStart = markerSquaresProcessed_A.length();
-	milliardsEnds = lineSquaresProcessed.find(markerSquaresProcessed_B);
-	squaresStart = milliardsEnds + markerSquaresProcessed_B.length();
-	squaresEnds = lineSquaresProcessed.find(markerSquaresProcessed_C);
 
-	milliards = std::stoi(lineSquaresProcessed.substr(milliardsStart, milliardsEnds - milliardsStart));
-	squares = std::stoi(lineSquaresProcessed.substr(squaresStart, squaresEnds - squaresStart));
+// Чтение квадрата "{ a b c ... }" и его упаковка по полбайта на клетку. Ранг определяется по числу клеток
+// первого квадрата файла; квадраты другого ранга и значения вне ранга считаются ошибкой
+int Result::ParseSquare(const char*& position, const char* end, uint8_t* record)
+{
+	uint8_t cells[MaxRank*MaxRank];
+	int cellsCount = 0;
+	int rank = 0;
 
-	SquaresProcessed = milliards*1000000000 + squares;
-}
\ No newline at end of file
+	// Пропуск открывающей скобки
+	position++;
+
+	// Чтение клеток до закрывающей скобки
+	while (position < end && *position != '}')
+	{
+		if (*position >= '0' && *position <= '9')
+		{
+			if (cellsCount == MaxRank*MaxRank)
+			{
+				return 0;
+			}
+
+			long long value = ParseNumber(position, end);
+
+			if (value >= MaxRank)
+			{
+				return 0;
+			}
+
+			cells[cellsCount++] = (uint8_t) value;
+		}
+		else if (*position == ' ' || *position == '\t' || *position == '\r' || *position == '\n')
+		{
+			position++;
+		}
+		else
+		{
+			return 0;
+		}
+	}
+
+	if (position == end)
+	{
+		return 0;
+	}
+
+	position++;
+
+	// Определение ранга
+	while (rank*rank < cellsCount)
+	{
+		rank++;
+	}
+
+	if (rank == 0 || rank*rank != cellsCount || (Rank != 0 && rank != Rank))
+	{
+		return 0;
+	}
+
+	Rank = rank;
+
+	for (int cellId = 0; cellId < cellsCount; cellId++)
+	{
+		if (cells[cellId] >= Rank)
+		{
+			return 0;
+		}
+	}
+
+	PackSquare(cells, Rank, record);
+
+return 1;
+}
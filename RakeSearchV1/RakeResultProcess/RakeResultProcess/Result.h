@@ -4,18 +4,39 @@
 # define Result_h
 
 # include <fstream>
+# include <vector>
+# include <stdint.h>
 
 using namespace std;
 
 class Result
 {
 public:
+	static const int MaxRank = 16;				// Наибольший ранг квадратов (значение клетки должно помещаться в полбайта)
+
 	Result();					// Конструктор по умолчанию
+	void Reset();				// Сброс данных результата
 	void Read(istream& is);		// Чтение данных результата из файла
+	int Parse(const char* data, size_t size);	// Разбор текста результата; возвращает 1, если ошибок разбора не было
+	static int RecordSize(int rank);			// Размер упакованного квадрата ранга rank
+	static void PackSquare(const uint8_t* cells, int rank, uint8_t* record);	// Упаковка квадрата: по полбайта на клетку
+	static void UnpackSquare(const uint8_t* record, int rank, uint8_t* cells);	// Распаковка квадрата: по байту на клетку
+
+	long long TotalPairs;			// Общее число найденных пар
+	long long TotalSquaresWithPairs;	// Общее число квадратов в парах
+	long long SquaresProcessed;		// Число обработанных квадратов
+	int TotalsCount;				// Число блоков итогов в файле
+	int Rank;						// Ранг квадратов из блоков пар (0 - пар нет)
+	long long PairsCount;			// Число пар, прочитанных из блоков пар
+	vector<uint8_t> Pairs;			// Пары в упакованном виде: квадрат A и квадрат B, по полбайта на клетку
+	int IsError;					// Флаг ошибки разбора
 
-	int TotalPairs;				// Общее число найденных пар
-	int TotalSquaresWithPairs;	// Общее число квадратов в парах
-	int SquaresProcessed;		// Число обработанных квадратов
+protected:
+private:
+	static int StartsWith(const char* position, const char* lineEnd, const char* marker);	// Проверка начала строки
+	static long long ParseNumber(const char*& position, const char* end);					// Чтение неотрицательного числа
+	void ParseComment(const char* position, const char* lineEnd);							// Разбор строки-комментария с итогами
+	int ParseSquare(const char*& position, const char* end, uint8_t* record);				// Чтение и упаковка квадрата
 };
 
-# endif
\ No newline at end of file
+# endif
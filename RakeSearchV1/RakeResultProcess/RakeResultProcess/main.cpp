@@ -1,60 +1,470 @@
 ﻿# include <iostream>
 # include <fstream>
 # include <string>
+# include <vector>
+# include <algorithm>
+# include <atomic>
+# include <chrono>
+# include <thread>
+# include <string.h>
+# if defined(_WIN32)
 # include <Windows.h>
+# else
+# include <dirent.h>
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <unistd.h>
+# endif
 
 # include "Result.h"
+# include "PairStore.h"
+# include "Canonizer.h"
 
 using namespace std;
 
-int main()
+// Проверка соответствия имени файла маске с символами '*' (любая последовательность) и '?' (любой символ)
+int MatchMask(const char* name, const char* mask)
 {
+	const char* starMask = NULL;	// Позиция в маске после последней звёздочки
+	const char* starName = NULL;	// Позиция в имени, с которой сопоставлена последняя звёздочка
+
+	while (*name)
+	{
+		if (*mask == '*')
+		{
+			starMask = ++mask;
+			starName = name;
+		}
+		else if (*mask == '?' || *mask == *name)
+		{
+			mask++;
+			name++;
+		}
+		else if (starMask != NULL)
+		{
+			mask = starMask;
+			name = ++starName;
+		}
+		else
+		{
+			return 0;
+		}
+	}
+
+	while (*mask == '*')
+	{
+		mask++;
+	}
+
+	return *mask == 0;
+}
+
+
+// Получение отсортированного списка файлов каталога, соответствующих маске
+void ListFiles(string directory, string mask, vector<string>& fileNames)
+{
+	fileNames.clear();
+
+# if defined(_WIN32)
+	WIN32_FIND_DATA findData;		// Данные поиска
+	HANDLE findHandle;				// Заголовок структур поиска
+
+	findHandle = FindFirstFile((directory + mask).c_str(), &findData);
+
+	if (findHandle != INVALID_HANDLE_VALUE)
+	{
+		do
+		{
+			if (!(findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+			{
+				fileNames.push_back(findData.cFileName);
+			}
+		}
+		while (FindNextFile(findHandle, &findData));
+
+		FindClose(findHandle);
+	}
+# else
+	DIR* directoryHandle = opendir(directory.c_str());
+	struct dirent* entry;
+
+	if (directoryHandle != NULL)
+	{
+		while ((entry = readdir(directoryHandle)) != NULL)
+		{
+			if (entry->d_type != DT_DIR && MatchMask(entry->d_name, mask.c_str()))
+			{
+				fileNames.push_back(entry->d_name);
+			}
+		}
+
+		closedir(directoryHandle);
+	}
+# endif
+
+	sort(fileNames.begin(), fileNames.end());
+}
+
+
+// Чтение и разбор файла результата. В Linux файл отображается в память и разбирается без копирования
+int ProcessFile(string fileName, Result& result)
+{
+# if defined(_WIN32)
+	fstream resultFile;
+
+	resultFile.open(fileName, std::ios_base::in | std::ios_base::binary);
+	if (!resultFile.is_open())
+	{
+		result.IsError = 1;
+		return 0;
+	}
+
+	result.Read(resultFile);
+	resultFile.close();
+# else
+	struct stat fileStat;
+	void* data;
+	int fileDescriptor = open(fileName.c_str(), O_RDONLY);
+
+	if (fileDescriptor < 0)
+	{
+		result.IsError = 1;
+		return 0;
+	}
+
+	fstat(fileDescriptor, &fileStat);
+
+	if (fileStat.st_size == 0)
+	{
+		result.Parse("", 0);
+	}
+	else
+	{
+		data = mmap(NULL, fileStat.st_size, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+
+		if (data == MAP_FAILED)
+		{
+			close(fileDescriptor);
+			result.IsError = 1;
+			return 0;
+		}
+
+		madvise(data, fileStat.st_size, MADV_SEQUENTIAL);
+		result.Parse((const char*) data, fileStat.st_size);
+		munmap(data, fileStat.st_size);
+	}
+
+	close(fileDescriptor);
+# endif
+
+return !result.IsError;
+}
+
+
+// Разбиение пар хранилища на классы эквивалентности: пары канонизируются в несколько потоков,
+// канонические формы сортируются, в хранилище классов записывается по одной канонической паре на класс
+int DeduplicatePairs(string pairsFileName, string classesFileName, int threadsCount)
+{
+	int rank = 0;					// Ранг квадратов пар
+	long long pairsCount = 0;		// Число пар в хранилище
+	vector<uint8_t> pairs;			// Пары в упакованном виде
+	vector<uint8_t> canonicalPairs;	// Канонические формы пар в упакованном виде
+	vector<long long> order;		// Номера пар в порядке возрастания канонических форм
+	vector<uint8_t> classes;		// Канонические формы классов
+	atomic<long long> nextPairId(0);	// Номер следующей обрабатываемой пары (общий для потоков)
+	vector<thread> workers;			// Потоки обработки
+	PairStore classesStore;			// Хранилище классов
+	long long classesCount = 0;		// Число классов
+	long long largestClass = 0;		// Число пар в наибольшем классе
+	int recordSize;					// Размер упакованного квадрата
+	int pairSize;					// Размер упакованной пары
+
+	auto startTime = chrono::steady_clock::now();
+
+	if (!PairStore::Read(pairsFileName, rank, pairs, pairsCount))
+	{
+		cerr << "Error reading pairs store " << pairsFileName << endl;
+		return 1;
+	}
+
+	if (pairsCount > 0 && rank < Canonizer::MinRank)
+	{
+		cerr << "Pairs of rank " << rank << " can not be canonized" << endl;
+		return 1;
+	}
+
+	recordSize = Result::RecordSize(rank);
+	pairSize = 2*recordSize;
+	canonicalPairs.resize(pairs.size());
+
+	// Канонизация пар
+	for (int workerId = 0; workerId < threadsCount; workerId++)
+	{
+		workers.push_back(thread([&]()
+		{
+			Canonizer canonizer(rank);
+			uint8_t a[Canonizer::MaxCells];
+			uint8_t b[Canonizer::MaxCells];
+			uint8_t canonical[2*Canonizer::MaxCells];
+			long long pairId;
+
+			while ((pairId = nextPairId++) < pairsCount)
+			{
+				const uint8_t* pair = &pairs[(size_t) pairId*pairSize];
+				uint8_t* canonicalPair = &canonicalPairs[(size_t) pairId*pairSize];
+
+				Result::UnpackSquare(pair, rank, a);
+				Result::UnpackSquare(pair + recordSize, rank, b);
+				canonizer.CanonizePair(a, b, canonical);
+				Result::PackSquare(canonical, rank, canonicalPair);
+				Result::PackSquare(canonical + rank*rank, rank, canonicalPair + recordSize);
+			}
+		}));
+	}
+
+	for (int workerId = 0; workerId < threadsCount; workerId++)
+	{
+		workers[workerId].join();
+	}
+
+	// Выделение классов
+	order.resize(pairsCount);
+
+	for (long long pairId = 0; pairId < pairsCount; pairId++)
+	{
+		order[pairId] = pairId;
+	}
+
+	sort(order.begin(), order.end(), [&](long long first, long long second)
+	{
+		return memcmp(&canonicalPairs[(size_t) first*pairSize], &canonicalPairs[(size_t) second*pairSize], pairSize) < 0;
+	});
+
+	for (long long i = 0, classStart = 0; i < pairsCount; i++)
+	{
+		const uint8_t* canonicalPair = &canonicalPairs[(size_t) order[i]*pairSize];
+
+		if (i + 1 == pairsCount || memcmp(canonicalPair, &canonicalPairs[(size_t) order[i + 1]*pairSize], pairSize) != 0)
+		{
+			classes.insert(classes.end(), canonicalPair, canonicalPair + pairSize);
+			classesCount++;
+			largestClass = max(largestClass, i + 1 - classStart);
+			classStart = i + 1;
+		}
+	}
+
+	// Запись классов
+	if (!classesStore.Create(classesFileName))
+	{
+		cerr << "Error opening file " << classesFileName << endl;
+		return 1;
+	}
+
+	classesStore.Write(rank, classes.data(), classesCount);
+	classesStore.Close();
+
+	cout << "Pairs in store: " << pairsCount << endl;
+	cout << "Equivalence classes: " << classesCount << endl;
+	cout << "Pairs in the largest class: " << largestClass << endl;
+	cout << "Classes written to " << classesFileName << endl;
+	cout << "Time: " << chrono::duration<double>(chrono::steady_clock::now() - startTime).count() << " s" << endl;
+
+	return 0;
+}
+
+
+int main(int argsCount, char* argsValues[])
+{
+# if defined(_WIN32)
 	string directory = "D:\\WorkFiles\\RakeResults\\";		// Пусть к каталогу с файлами
+	string pathDelimiter = "\\";							// Разделитель каталогов в пути
+# else
+	string directory = "./";								// Пусть к каталогу с файлами
+	string pathDelimiter = "/";								// Разделитель каталогов в пути
+# endif
 	string mask = "rs*.txt";								// Маска поиска файлов
-	string maskWithPath = directory + mask;					// Маска поиска файлов по заданному пути
-	string fileName;										// Имя найденного файла
-	string fullFileName;									// Имя файла с путём
-	WIN32_FIND_DATA findData;								// Данные поиска
-	HANDLE findHandle;										// Заголовок структур поиска
+	string pairsFileName = "pairs.bin";						// Имя файла двоичного хранилища пар
+	string statsFileName = "workunit_stats.txt";			// Имя файла со статистикой по заданиям
+	string dedupFileName;									// Имя хранилища пар для разбиения на классы (режим разбиения)
+	string classesFileName = "pair_classes.bin";			// Имя хранилища классов пар
+	int threadsCount = thread::hardware_concurrency();		// Число потоков обработки
 
-	fstream resultFile;
-	Result taskResult;
-	long long int totalSquares = 0;
+	vector<string> fileNames;			// Имена найденных файлов
+	vector<Result> results;				// Результаты, прочитанные из файлов
+	atomic<int> nextFileId(0);			// Номер следующего обрабатываемого файла (общий для потоков)
+	vector<thread> workers;				// Потоки обработки
+	fstream statsFile;					// Файл со статистикой по заданиям
+	PairStore pairStore;				// Двоичное хранилище пар
+
+	long long totalSquares = 0;			// Число обработанных квадратов
+	long long totalPairs = 0;			// Число найденных пар по итогам файлов
+	long long totalSquaresWithPairs = 0;	// Число квадратов в парах по итогам файлов
+	int errorsCount = 0;				// Число файлов с ошибками
+	int mismatchesCount = 0;			// Число файлов, в которых число пар в блоках не совпадает с итогами
+
+	// Переменные для разбора параметров
+	string argument;							// Название обрабатываемого аргумента
+	string paramName;							// Имя параметра, полученное из аргумента
+	string paramValue;							// Значение параметра, полученное из аргумента
+	string directoryParamName = "--dir";		// Название параметра "Каталог с файлами результатов"
+	string maskParamName = "--mask";			// Название параметра "Маска файлов результатов"
+	string pairsParamName = "--pairs";			// Название параметра "Файл двоичного хранилища пар"
+	string statsParamName = "--stats";			// Название параметра "Файл со статистикой по заданиям"
+	string threadsParamName = "--threads";		// Название параметра "Число потоков обработки"
+	string dedupParamName = "--dedup";			// Название параметра "Хранилище пар для разбиения на классы"
+	string classesParamName = "--classes";		// Название параметра "Хранилище классов пар"
+	string delimiter = "=";						// Разделитель имени параметра и его значения в аргументе программы
+	size_t delimiterPosition;					// Позиция разделителя имени параметра и его значения в аргументе
+
+	// Чтение входных параметров
+	for (int i = 1; i < argsCount; i++)
+	{
+		argument = argsValues[i];
+		delimiterPosition = argument.find(delimiter, 0);
+
+		if (delimiterPosition == string::npos)
+		{
+			continue;
+		}
+
+		paramName = argument.substr(0, delimiterPosition);
+		paramValue = argument.substr(delimiterPosition + 1);
+
+		if (paramName == directoryParamName)
+		{
+			directory = paramValue;
+		}
+
+		if (paramName == maskParamName)
+		{
+			mask = paramValue;
+		}
 
-	// Обработка файлов 
-		// Инициализация поиска
-		findHandle = FindFirstFile(maskWithPath.c_str(), &findData);
-	
-		// Перебор файлов
-		if (findHandle != INVALID_HANDLE_VALUE)
+		if (paramName == pairsParamName)
 		{
-			do
+			pairsFileName = paramValue;
+		}
+
+		if (paramName == statsParamName)
+		{
+			statsFileName = paramValue;
+		}
+
+		if (paramName == threadsParamName)
+		{
+			threadsCount = std::stoi(paramValue, nullptr);
+		}
+
+		if (paramName == dedupParamName)
+		{
+			dedupFileName = paramValue;
+		}
+
+		if (paramName == classesParamName)
+		{
+			classesFileName = paramValue;
+		}
+	}
+
+	if (threadsCount < 1)
+	{
+		threadsCount = 1;
+	}
+
+	// Режим разбиения пар на классы эквивалентности
+	if (!dedupFileName.empty())
+	{
+		return DeduplicatePairs(dedupFileName, classesFileName, threadsCount);
+	}
+
+	if (!directory.empty() && directory.substr(directory.length() - 1) != pathDelimiter)
+	{
+		directory += pathDelimiter;
+	}
+
+	auto startTime = chrono::steady_clock::now();
+
+	// Получение списка файлов
+	ListFiles(directory, mask, fileNames);
+	cout << "Found " << fileNames.size() << " files " << directory << mask << endl;
+
+	// Обработка файлов в несколько потоков: файлы раздаются по общему счётчику
+	results.resize(fileNames.size());
+
+	for (int workerId = 0; workerId < threadsCount; workerId++)
+	{
+		workers.push_back(thread([&]()
+		{
+			int fileId;
+
+			while ((fileId = nextFileId++) < (int) fileNames.size())
 			{
-				fileName = findData.cFileName;
-				fullFileName = directory + fileName;
-
-				resultFile.open(fullFileName, std::ios_base::in);
-				if (resultFile.is_open())
-				{
-					taskResult.Read(resultFile);
-				}
-				resultFile.close();
-
-				cout << fileName << " " << taskResult.SquaresProcessed << endl;
-				totalSquares += taskResult.SquaresProcessed;
+				ProcessFile(directory + fileNames[fileId], results[fileId]);
 			}
-			while (FindNextFile(findHandle, &findData));
+		}));
+	}
+
+	for (int workerId = 0; workerId < threadsCount; workerId++)
+	{
+		workers[workerId].join();
+	}
+
+	// Запись статистики по заданиям и пар в порядке имён файлов
+	statsFile.open(statsFileName, std::ios_base::out);
+	statsFile << "File;TotalPairs;SquaresWithPairs;SquaresProcessed;PairsInBlocks;Status" << endl;
+
+	if (!pairStore.Create(pairsFileName))
+	{
+		cerr << "Error opening file " << pairsFileName << endl;
+	}
+
+	for (size_t fileId = 0; fileId < fileNames.size(); fileId++)
+	{
+		Result& taskResult = results[fileId];
+		string status = "OK";
+
+		if (taskResult.IsError || taskResult.TotalsCount == 0)
+		{
+			status = "ERROR";
+			errorsCount++;
+		}
+		else if (taskResult.PairsCount != taskResult.TotalPairs)
+		{
+			status = "MISMATCH";
+			mismatchesCount++;
 		}
 
-		// Закрытие структур поиска
-		FindClose(findHandle);
+		if (!pairStore.Write(taskResult.Rank, taskResult.Pairs.data(), taskResult.PairsCount))
+		{
+			cerr << "Rank of pairs in " << fileNames[fileId] << " differs from previous files, pairs are skipped" << endl;
+			status = "ERROR";
+		}
+
+		statsFile << fileNames[fileId] << ";" << taskResult.TotalPairs << ";" << taskResult.TotalSquaresWithPairs << ";"
+			<< taskResult.SquaresProcessed << ";" << taskResult.PairsCount << ";" << status << endl;
+
+		totalSquares += taskResult.SquaresProcessed;
+		totalPairs += taskResult.TotalPairs;
+		totalSquaresWithPairs += taskResult.TotalSquaresWithPairs;
+
+		// Освобождение памяти, занятой парами
+		vector<uint8_t>().swap(taskResult.Pairs);
+	}
+
+	statsFile.close();
+	pairStore.Close();
 
 	// Вывод результата
 	cout << endl;
+	cout << "Files processed: " << fileNames.size() << endl;
+	cout << "Files with errors: " << errorsCount << endl;
+	cout << "Files with pairs count mismatch: " << mismatchesCount << endl;
 	cout << "Squares in results: " << totalSquares << endl;
-	cout << endl << "Press any key to continue ..." << endl;
-
-	cin.get();
+	cout << "Total pairs found: " << totalPairs << endl;
+	cout << "Total squares with pairs: " << totalSquaresWithPairs << endl;
+	cout << "Pairs written to " << pairsFileName << ": " << pairStore.Count() << endl;
+	cout << "Time: " << chrono::duration<double>(chrono::steady_clock::now() - startTime).count() << " s" << endl;
 
-	return 0;
-}
\ No newline at end of file
+	return errorsCount > 0 ? 1 : 0;
+}
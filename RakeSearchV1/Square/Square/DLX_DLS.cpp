@@ -58,79 +58,132 @@ void TV_check(vector<vector<int>> &TVSET, vector<vector<int>> &LS, vector<int> &
 	}
 }
 
-void orth_mate_search::cover(DLX_column *&c)
-{
-	//cout << "Covered " << c->column_number << endl;
-	c->Right->Left = c->Left;
-	c->Left->Right = c->Right;
-
-	DLX_column *i;
-	DLX_column *j;
-	i = c->Down;
-	while (i != c) {
-		j = i->Right;
-		while (j != i) {
-			j->Down->Up = j->Up;
-			j->Up->Down = j->Down;
-			//	cout << "covered element " << j->row_id << " in column " << j->column_number << endl;
-			j->Column->size--;
-			if (j->Column->size < 0) {
-				cout << "We are in deep trouble" << endl;
-			}
-			j = j->Right;
-		}
-		i = i->Down;
-	}
+// Матрица DLX хранится в арене индексов: узел 0 - корень, узлы 1..columns_count - заголовки столбцов,
+// далее - элементы строк. Память массивов сохраняется между вызовами, поэтому перестройка матрицы
+// для очередного квадрата не выделяет память
+void DLX_links::reset(int columns_count)
+{
+	int nodes_count = columns_count + 1;
+
+	Left.resize(nodes_count);
+	Right.resize(nodes_count);
+	Up.resize(nodes_count);
+	Down.resize(nodes_count);
+	Column.resize(nodes_count);
+	row_id.resize(nodes_count);
+	size.assign(nodes_count, 0);
+
+	for (int i = 0; i < nodes_count; i++) {
+		Left[i] = i - 1;
+		Right[i] = i + 1;
+		Up[i] = i;
+		Down[i] = i;
+		Column[i] = i;
+		row_id[i] = -1;
+	}
+	Left[0] = columns_count;
+	Right[columns_count] = 0;
+	size[0] = -1;
 }
 
-void orth_mate_search::uncover(DLX_column *&c)
+void DLX_links::add_row(int row, const int *columns, int count)
 {
-	//cout << "Uncovered " << c->column_number << endl;
-	DLX_column *i;
-	DLX_column *j;
-	i = c->Up;
-	while (i != c) {
-		j = i->Left;
-		while (j != i) {
-			j->Column->size++;
-
-			j->Down->Up = j;
-			j->Up->Down = j;
+	int first = (int)Left.size();
+
+	for (int j = 0; j < count; j++) {
+		int c = columns[j] + 1;
+		int node = first + j;
+
+		Left.push_back(j == 0 ? first + count - 1 : node - 1);
+		Right.push_back(j == count - 1 ? first : node + 1);
+		Up.push_back(Up[c]);
+		Down.push_back(c);
+		Column.push_back(c);
+		row_id.push_back(row);
+		Down[Up[c]] = node;
+		Up[c] = node;
+		size[c]++;
+	}
+}
 
-			j = j->Left;
+void orth_mate_search::cover(int c)
+{
+	//cout << "Covered " << c << endl;
+	int *L = dlx.Left.data();
+	int *R = dlx.Right.data();
+	int *U = dlx.Up.data();
+	int *D = dlx.Down.data();
+	const int *C = dlx.Column.data();
+	int *S = dlx.size.data();
+
+	R[L[c]] = R[c];
+	L[R[c]] = L[c];
+
+	for (int i = D[c]; i != c; i = D[i]) {
+		for (int j = R[i]; j != i; j = R[j]) {
+			int up = U[j];
+			int down = D[j];
+			int column = C[j];
+			U[down] = up;
+			D[up] = down;
+			//	cout << "covered element " << dlx.row_id[j] << " in column " << column << endl;
+			S[column]--;
 		}
-		i = i->Up;
 	}
-	c->Right->Left = c;
-	c->Left->Right = c;
 }
 
-void orth_mate_search::choose_c(DLX_column &h, DLX_column *&c)
+void orth_mate_search::uncover(int c)
 {
-	DLX_column * j;
+	//cout << "Uncovered " << c << endl;
+	int *L = dlx.Left.data();
+	int *R = dlx.Right.data();
+	int *U = dlx.Up.data();
+	int *D = dlx.Down.data();
+	const int *C = dlx.Column.data();
+	int *S = dlx.size.data();
+
+	for (int i = U[c]; i != c; i = U[i]) {
+		for (int j = L[i]; j != i; j = L[j]) {
+			int up = U[j];
+			int down = D[j];
+			S[C[j]]++;
+
+			U[down] = j;
+			D[up] = j;
+		}
+	}
+	R[L[c]] = c;
+	L[R[c]] = c;
+}
 
-	j = h.Right;
-	int min = j->size;
-	c = j;
-	while (j != &h) {
-		if (j->size < min) {
+int orth_mate_search::choose_c()
+{
+	const int *R = dlx.Right.data();
+	const int *S = dlx.size.data();
+
+	int j = R[0];
+	int min = S[j];
+	int c = j;
+	while (j != 0) {
+		if (S[j] < min) {
 			c = j;
-			min = j->size;
+			min = S[j];
 		}
-		j = j->Right;
+		j = R[j];
 	}
+	return c;
 }
 
-void orth_mate_search::print_solution(vector<DLX_column*> &ps)
+void orth_mate_search::print_solution(const vector<int> &ps)
 {
 	cout << endl;
 	for (int i = 0; i < ps.size(); i++) {
-		cout << ps[i]->row_id << " ";
+		cout << dlx.row_id[ps[i]] << " ";
 	}
 	cout << endl;
 }
 
-void orth_mate_search::search_limited(int k, DLX_column &h, vector<DLX_column*> &ps, vector<vector<int>> &tvr, bool &cont, unsigned long long &limit, bool &count_only, unsigned long long &count)
+void orth_mate_search::search_limited(int k, vector<int> &ps, vector<vector<int>> &tvr, bool &cont, unsigned long long &limit, bool &count_only, unsigned long long &count)
 {
 	//pd = partial solution
 	if (k > 10) {
@@ -138,13 +191,17 @@ void orth_mate_search::search_limited(int k, DLX_column &h, vector<DLX_column*>
 
 	}
 	//	cout << "Search " << k << endl;
+	const int *R = dlx.Right.data();
+	const int *L = dlx.Left.data();
+	const int *D = dlx.Down.data();
+	const int *C = dlx.Column.data();
 	if (cont == true) {
-		if (h.Right == &h) {
+		if (R[0] == 0) {
 			count++;
 			if (count_only == false) {
-				vector<int> tmpv;
+				vector<int> tmpv(ps.size());
 				for (int i = 0; i < ps.size(); i++) {
-					tmpv.push_back(ps[i]->row_id);
+					tmpv[i] = dlx.row_id[ps[i]];
 				}
 				tvr.push_back(tmpv);
 			}
@@ -153,40 +210,28 @@ void orth_mate_search::search_limited(int k, DLX_column &h, vector<DLX_column*>
 			//print_solution(ps);
 		}
 		else {
-			DLX_column * c = NULL;
-			choose_c(h, c);
-			//cout << "picked column " << c->column_number << endl;
+			int c = choose_c();
+			//cout << "picked column " << c << endl;
 			cover(c);
-			DLX_column * r = c->Down;
-			while ((r != c) && (cont == true)) {
+			for (int r = D[c]; (r != c) && (cont == true); r = D[r]) {
 				ps.push_back(r);
-				DLX_column * j;
-				j = r->Right;
-				while (j != r) {
-					cover(j->Column);
-					j = j->Right;
+				for (int j = R[r]; j != r; j = R[j]) {
+					cover(C[j]);
 				}
 
-				search_limited(k + 1, h, ps, tvr, cont, limit, count_only, count);
-				r = ps.back();
-				//questionable.
+				search_limited(k + 1, ps, tvr, cont, limit, count_only, count);
 				ps.pop_back();
-				c = r->Column;
 
-				j = r->Left;
-				while (j != r) {
-					uncover(j->Column);
-					j = j->Left;
+				for (int j = L[r]; j != r; j = L[j]) {
+					uncover(C[j]);
 				}
-				r = r->Down;
 			}
 			uncover(c);
-			//return;
 		}
 	}
 }
 
-void orth_mate_search::search(int k, DLX_column &h, vector<DLX_column*> &ps, vector<vector<int>> &tvr)
+void orth_mate_search::search(int k, vector<int> &ps, vector<vector<int>> &tvr)
 {
 	//pd = partial solution
 	if (k > 10) {
@@ -194,306 +239,269 @@ void orth_mate_search::search(int k, DLX_column &h, vector<DLX_column*> &ps, vec
 
 	}
 	//	cout << "Search " << k << endl;
-	if (h.Right == &h) {
-		vector<int> tmpv;
+	const int *R = dlx.Right.data();
+	const int *L = dlx.Left.data();
+	const int *D = dlx.Down.data();
+	const int *C = dlx.Column.data();
+	if (R[0] == 0) {
+		vector<int> tmpv(ps.size());
 		for (int i = 0; i < ps.size(); i++) {
-			tmpv.push_back(ps[i]->row_id);
+			tmpv[i] = dlx.row_id[ps[i]];
 		}
 		tvr.push_back(tmpv);
 		//cout << tvr.size() << endl;
 		//print_solution(ps);
 	}
 	else {
-		DLX_column * c = NULL;
-		choose_c(h, c);
-		//	cout << "picked column " << c->column_number << endl;
+		int c = choose_c();
+		//	cout << "picked column " << c << endl;
 		cover(c);
-		DLX_column * r = c->Down;
-		while (r != c) {
+		for (int r = D[c]; r != c; r = D[r]) {
 			ps.push_back(r);
-			DLX_column * j;
-			j = r->Right;
-			while (j != r) {
-				cover(j->Column);
-				j = j->Right;
+			for (int j = R[r]; j != r; j = R[j]) {
+				cover(C[j]);
 			}
 
-			search(k + 1, h, ps, tvr);
-
-			r = ps.back();
-			//questionable.
+			search(k + 1, ps, tvr);
 			ps.pop_back();
-			c = r->Column;
 
-			j = r->Left;
-			while (j != r) {
-				uncover(j->Column);
-				j = j->Left;
+			for (int j = L[r]; j != r; j = L[j]) {
+				uncover(C[j]);
 			}
-			r = r->Down;
 		}
 		uncover(c);
-		//return;
 	}
 }
 
-void orth_mate_search::TVSET_TO_DLX(DLX_column &root, vector<vector<int>> & tvset, vector<DLX_column*> & elements)
+// Подсчёт решений без их сохранения
+unsigned long long orth_mate_search::search_count(int k)
 {
-	int dimension = tvset[0].size();
-	root.Up = NULL;
-	root.Down = NULL;
-	root.Column = NULL;
-	root.row_id = -1;
-	root.size = -1;
-	//	root.column_number= -1;
-	elements.push_back(&root);
-	vector<DLX_column *> columns;
-	DLX_column * lastleft = &root;
-	for (int i = 0; i < dimension* dimension; i++) {
-		DLX_column *ct;
-		ct = new (DLX_column);
-		//	ct->column_number = i;
-		ct->Down = ct;
-		ct->Up = ct;
-		ct->size = 0;
-		ct->row_id = 0;
-		ct->Column = ct;
-		ct->Left = lastleft;
-		lastleft->Right = ct;
-		lastleft = ct;
-		columns.push_back(ct);
-		elements.push_back(ct);
-	}
-	lastleft->Right = &root;
-	root.Left = lastleft;
+	const int *R = dlx.Right.data();
+	const int *L = dlx.Left.data();
+	const int *D = dlx.Down.data();
+	const int *C = dlx.Column.data();
+	unsigned long long count = 0;
 
-	for (int i = 0; i < tvset.size(); i++) {
-		vector<int> curtv = tvset[i];
-		vector<DLX_column *> tvrow;
-		for (int j = 0; j < curtv.size(); j++) {
-			DLX_column *ctve;
-			ctve = new (DLX_column);
-			//column corresponds to characteristic vector of LS or smth of that kind
-			int k = j*dimension + curtv[j];
+	if (R[0] == 0) {
+		return 1;
+	}
 
-			ctve->Column = columns[k];
-			ctve->Column->size++;
-			ctve->Down = columns[k];
-			ctve->Up = columns[k]->Up;
-			ctve->Up->Down = ctve;
-			ctve->Down->Up = ctve;
-			ctve->row_id = i;
-			//	ctve->column_number = k;
-			ctve->size = -10;
-			elements.push_back(ctve);
-			tvrow.push_back(ctve);
+	int c = choose_c();
+	if (dlx.size[c] == 0) {
+		return 0;
+	}
+	cover(c);
+	for (int r = D[c]; r != c; r = D[r]) {
+		for (int j = R[r]; j != r; j = R[j]) {
+			cover(C[j]);
 		}
 
-		for (int j = 0; j < tvrow.size() - 1; j++) {
-			tvrow[j]->Right = tvrow[j + 1];
-			tvrow[j]->Right->Left = tvrow[j];
+		count += search_count(k + 1);
+
+		for (int j = L[r]; j != r; j = L[j]) {
+			uncover(C[j]);
 		}
-		tvrow[tvrow.size() - 1]->Right = tvrow[0];
-		tvrow[0]->Left = tvrow[tvrow.size() - 1];
 	}
-	DLX_column *pr = &root;
+	uncover(c);
 
+	return count;
+}
+
+// Разбиение верхних уровней поиска на независимые задачи. Задача - узлы строк, выбранных
+// на первых max_depth уровнях; задачи перечисляются в порядке обхода последовательного поиска
+void orth_mate_search::collect_tasks(int k, int max_depth, vector<int> &prefix, vector<vector<int>> &tasks)
+{
+	const int *R = dlx.Right.data();
+	const int *L = dlx.Left.data();
+	const int *D = dlx.Down.data();
+	const int *C = dlx.Column.data();
+
+	if ((k == max_depth) || (R[0] == 0)) {
+		tasks.push_back(prefix);
+		return;
+	}
+
+	int c = choose_c();
+	cover(c);
+	for (int r = D[c]; r != c; r = D[r]) {
+		prefix.push_back(r);
+		for (int j = R[r]; j != r; j = R[j]) {
+			cover(C[j]);
+		}
+
+		collect_tasks(k + 1, max_depth, prefix, tasks);
+		prefix.pop_back();
+
+		for (int j = L[r]; j != r; j = L[j]) {
+			uncover(C[j]);
+		}
+	}
+	uncover(c);
+}
+
+// Применение задачи к копии матрицы: покрытие столбцов всех строк префикса
+void orth_mate_search::apply_task(const vector<int> &prefix)
+{
+	for (int i = 0; i < prefix.size(); i++) {
+		int r = prefix[i];
+		cover(dlx.Column[r]);
+		for (int j = dlx.Right[r]; j != r; j = dlx.Right[j]) {
+			cover(dlx.Column[j]);
+		}
+	}
+	ps = prefix;
+}
+
+// Параллельный поиск по матрице dlx: задачи раздаются потокам через общий счётчик, каждый поток
+// работает со своей копией матрицы, результаты задач объединяются в порядке задач, поэтому
+// решения выдаются в том же порядке, что и при последовательном поиске
+unsigned long long orth_mate_search::search_parallel(vector<vector<int>> &tvr, bool count_only)
+{
+	vector<vector<int>> tasks;
+	vector<int> prefix;
+	int max_depth = 1;
+
+	do {
+		tasks.clear();
+		collect_tasks(0, max_depth, prefix, tasks);
+		max_depth++;
+	} while ((tasks.size() < 8 * threads_count) && (max_depth <= 3));
+
+	vector<vector<vector<int>>> task_solutions(count_only ? 0 : tasks.size());
+	vector<unsigned long long> task_counts(tasks.size(), 0);
+	atomic<int> next_task(0);
+
+	auto worker_function = [&]()
+	{
+		orth_mate_search worker;
+		int task_id;
+
+		while ((task_id = next_task++) < (int)tasks.size()) {
+			worker.dlx = dlx;
+			worker.apply_task(tasks[task_id]);
+			if (count_only) {
+				task_counts[task_id] = worker.search_count(tasks[task_id].size());
+			}
+			else {
+				worker.search(tasks[task_id].size(), worker.ps, task_solutions[task_id]);
+				task_counts[task_id] = task_solutions[task_id].size();
+			}
+		}
+	};
+
+	vector<thread> workers;
+	for (int i = 1; i < threads_count; i++) {
+		workers.push_back(thread(worker_function));
+	}
+	worker_function();
+	for (int i = 0; i < workers.size(); i++) {
+		workers[i].join();
+	}
+
+	unsigned long long count = 0;
+	for (int i = 0; i < tasks.size(); i++) {
+		count += task_counts[i];
+		if (!count_only) {
+			for (int j = 0; j < task_solutions[i].size(); j++) {
+				tvr.push_back(vector<int>());
+				tvr.back().swap(task_solutions[i][j]);
+			}
+		}
+	}
+
+	return count;
+}
+
+// Поиск всех решений по матрице dlx (в несколько потоков, если их число задано)
+void orth_mate_search::search_all(vector<vector<int>> &tvr)
+{
+	if (threads_count > 1) {
+		search_parallel(tvr, false);
+	}
+	else {
+		ps.clear();
+		search(0, ps, tvr);
+	}
+}
+
+// Подсчёт всех решений по матрице dlx
+unsigned long long orth_mate_search::count_all()
+{
+	vector<vector<int>> tvr;
+
+	if (threads_count > 1) {
+		return search_parallel(tvr, true);
+	}
+	return search_count(0);
+}
+
+void orth_mate_search::TVSET_TO_DLX(const vector<vector<int>> &tvset)
+{
+	int dimension = tvset[0].size();
+	vector<int> tvrow(dimension);
+
+	dlx.reset(dimension * dimension);
+	for (int i = 0; i < tvset.size(); i++) {
+		//column corresponds to characteristic vector of LS or smth of that kind
+		for (int j = 0; j < dimension; j++) {
+			tvrow[j] = j*dimension + tvset[i][j];
+		}
+		dlx.add_row(i, tvrow.data(), dimension);
+	}
 }
 
-void orth_mate_search::SQ_TO_DLX(DLX_column &root, vector<vector<int>> & SQ, vector<DLX_column*> & elements)
+void orth_mate_search::SQ_TO_DLX(const vector<vector<int>> &SQ)
 {
 	int dimension = SQ[0].size();
-	root.Up = NULL;
-	root.Down = NULL;
-	root.Column = NULL;
-	root.row_id = -1;
-	root.size = -1;
-	//	root.column_number= -1;
-	elements.push_back(&root);
-	vector<DLX_column *> columns;
-	DLX_column * lastleft = &root;
+	int tvrow[5];
+
 	// first n - row number
 	// n to 2n - column number
 	//2n to 3n - value
 	//3n+1 - diag
 	//3n+2 - antidiag
-	for (int i = 0; i < 3 * dimension + 2; i++) {
-		DLX_column *ct;
-		ct = new (DLX_column);
-		//	ct->column_number = i;
-		ct->Down = ct;
-		ct->Up = ct;
-		ct->size = 0;
-		ct->row_id = 0;
-		ct->Column = ct;
-		ct->Left = lastleft;
-		lastleft->Right = ct;
-		lastleft = ct;
-		columns.push_back(ct);
-		elements.push_back(ct);
-	}
-	lastleft->Right = &root;
-	root.Left = lastleft;
+	dlx.reset(3 * dimension + 2);
 	for (int i = 0; i < SQ.size(); i++) {
 		for (int j = 0; j < SQ[i].size(); j++) {
-			vector<DLX_column *> tvrow;
-			DLX_column *ctve;
-			ctve = new (DLX_column);
-
-			ctve->Column = columns[i];
-			ctve->Column->size++;
-			ctve->Down = columns[i];
-			ctve->Up = columns[i]->Up;
-			ctve->Up->Down = ctve;
-			ctve->Down->Up = ctve;
-			ctve->row_id = i*dimension + j;
-			//	ctve->column_number = k;
-			ctve->size = -10;
-			elements.push_back(ctve);
-			tvrow.push_back(ctve);
-
-			ctve = new (DLX_column);
-			//column corresponds to characteristic vector of LS or smth of that kind
-
-			ctve->Column = columns[dimension + j];
-			ctve->Column->size++;
-			ctve->Down = columns[dimension + j];
-			ctve->Up = columns[dimension + j]->Up;
-			ctve->Up->Down = ctve;
-			ctve->Down->Up = ctve;
-			ctve->row_id = i*dimension + j;
-			//	ctve->column_number = k;
-			ctve->size = -10;
-			elements.push_back(ctve);
-			tvrow.push_back(ctve);
-
-			ctve = new (DLX_column);
-			//column corresponds to characteristic vector of LS or smth of that kind
-
-			ctve->Column = columns[2 * dimension + SQ[i][j]];
-			ctve->Column->size++;
-			ctve->Down = columns[2 * dimension + SQ[i][j]];
-			ctve->Up = columns[2 * dimension + SQ[i][j]]->Up;
-			ctve->Up->Down = ctve;
-			ctve->Down->Up = ctve;
-			ctve->row_id = i*dimension + j;
-			//	ctve->column_number = k;
-			ctve->size = -10;
-			elements.push_back(ctve);
-			tvrow.push_back(ctve);
-
+			int count = 0;
+			tvrow[count++] = i;
+			tvrow[count++] = dimension + j;
+			tvrow[count++] = 2 * dimension + SQ[i][j];
 			if (i == j) {
-				ctve = new (DLX_column);
-				ctve->Column = columns[3 * dimension];
-				ctve->Column->size++;
-				ctve->Down = columns[3 * dimension];
-				ctve->Up = columns[3 * dimension]->Up;
-				ctve->Up->Down = ctve;
-				ctve->Down->Up = ctve;
-				ctve->row_id = i*dimension + j;
-				//	ctve->column_number = k;
-				ctve->size = -10;
-				elements.push_back(ctve);
-				tvrow.push_back(ctve);
+				tvrow[count++] = 3 * dimension;
 			}
-
 			if (i == (dimension - j - 1)) {
-				ctve = new (DLX_column);
-				ctve->Column = columns[3 * dimension + 1];
-				ctve->Column->size++;
-				ctve->Down = columns[3 * dimension + 1];
-				ctve->Up = columns[3 * dimension + 1]->Up;
-				ctve->Up->Down = ctve;
-				ctve->Down->Up = ctve;
-				ctve->row_id = i*dimension + j;
-				//	ctve->column_number = k;
-				ctve->size = -10;
-				elements.push_back(ctve);
-				tvrow.push_back(ctve);
-			}
-
-			for (int j = 0; j < tvrow.size() - 1; j++) {
-				tvrow[j]->Right = tvrow[j + 1];
-				tvrow[j]->Right->Left = tvrow[j];
+				tvrow[count++] = 3 * dimension + 1;
 			}
-			tvrow[tvrow.size() - 1]->Right = tvrow[0];
-			tvrow[0]->Left = tvrow[tvrow.size() - 1];
-
+			dlx.add_row(i*dimension + j, tvrow, count);
 		}
 	}
-	DLX_column *pr = &root;
 }
 
-void orth_mate_search::TVSET_TO_DLX_EXT(DLX_column &root, vector<vector<int>> & tvset, vector<DLX_column*> & columns, vector<vector<DLX_column*>> &rows)
+void orth_mate_search::TVSET_TO_DLX_EXT(const vector<vector<int>> &tvset, vector<int> &columns, vector<vector<int>> &rows)
 {
 	int dimension = tvset[0].size();
-	root.Up = NULL;
-	root.Down = NULL;
-	root.Column = NULL;
-	root.row_id = -1;
-	root.size = -1;
-	//	root.column_number= -1;
+
+	TVSET_TO_DLX(tvset);
 	columns.clear();
 	rows.clear();
-	DLX_column * lastleft = &root;
-	for (int i = 0; i < dimension* dimension; i++) {
-		DLX_column *ct;
-		ct = new (DLX_column);
-		//	ct->column_number = i;
-		ct->Down = ct;
-		ct->Up = ct;
-		ct->size = 0;
-		ct->row_id = 0;
-		ct->Column = ct;
-		ct->Left = lastleft;
-		lastleft->Right = ct;
-		lastleft = ct;
-		columns.push_back(ct);
-	}
-	lastleft->Right = &root;
-	root.Left = lastleft;
-
+	for (int i = 0; i < dimension * dimension; i++) {
+		columns.push_back(i + 1);
+	}
 	for (int i = 0; i < tvset.size(); i++) {
-		vector<int> curtv = tvset[i];
-		vector<DLX_column *> tvrow;
-		for (int j = 0; j < curtv.size(); j++) {
-			DLX_column *ctve;
-			ctve = new (DLX_column);
-			//column corresponds to characteristic vector of LS or smth of that kind
-			int k = j*dimension + curtv[j];
-
-			ctve->Column = columns[k];
-			ctve->Column->size++;
-			ctve->Down = columns[k];
-			ctve->Up = columns[k]->Up;
-			ctve->Up->Down = ctve;
-			ctve->Down->Up = ctve;
-			ctve->row_id = i;
-			//	ctve->column_number = k;
-			ctve->size = -10;
-			tvrow.push_back(ctve);
-		}
-
-		for (int j = 0; j < tvrow.size() - 1; j++) {
-			tvrow[j]->Right = tvrow[j + 1];
-			tvrow[j]->Right->Left = tvrow[j];
-		}
-		tvrow[tvrow.size() - 1]->Right = tvrow[0];
-		tvrow[0]->Left = tvrow[tvrow.size() - 1];
+		vector<int> tvrow(dimension);
+		for (int j = 0; j < dimension; j++) {
+			tvrow[j] = 1 + dimension * dimension + i * dimension + j;
+		}
 		rows.push_back(tvrow);
 	}
 }
 
-vector<vector<int>> orth_mate_search::find_tv_dlx(int n, vector<vector<int>> &SQ)
+vector<vector<int>> orth_mate_search::find_tv_dlx(int n, const vector<vector<int>> &SQ)
 {
-	DLX_column *root;
-	root = new (DLX_column);
-	vector<DLX_column*> elements;
-	SQ_TO_DLX(*root, SQ, elements);
-	vector<DLX_column*> ps;
-	ps.clear();
+	SQ_TO_DLX(SQ);
 	vector<vector<int>> tvr;
-	search(0, *root, ps, tvr);
+	search_all(tvr);
 
 
 	//cout << "Found " << tvr.size() << " transversals\n";
@@ -505,30 +513,166 @@ vector<vector<int>> orth_mate_search::find_tv_dlx(int n, vector<vector<int>> &SQ
 		//printvector(tvr[i]);
 		//cout << endl;
 	}
-	for (auto i = 0; i < elements.size(); i++) {
-		delete elements[i];
+	// Порядок трансверсалей, совпадающий с find_tv_masks
+	sort(tvr.begin(), tvr.end());
+	return tvr;
+}
+
+// Поиск диагональных трансверсалей для рангов до MaxMaskRank: перебор по строкам квадрата,
+// свободные строки, занятые столбцы и значения хранятся в 16-битных масках.
+// Трансверсали выдаются в лексикографическом порядке (столбцы строк 0, 1, ...)
+static inline int lowest_bit_index(unsigned x)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward(&index, x);
+	return (int)index;
+#else
+	return __builtin_ctz(x);
+#endif
+}
+
+static inline int bit_count(unsigned x)
+{
+#ifdef _MSC_VER
+	return (int)__popcnt(x);
+#else
+	return __builtin_popcount(x);
+#endif
+}
+
+// Маска столбцов строки i, значения в которых ещё не использованы
+inline unsigned orth_mate_search::tv_free_columns(int i, unsigned used_values)
+{
+#if defined(__AVX2__)
+	__m256i values = _mm256_loadu_si256((const __m256i*)tv_values[i]);
+	__m256i used = _mm256_set1_epi16((short)used_values);
+	__m256i free = _mm256_cmpeq_epi16(_mm256_and_si256(values, used), _mm256_setzero_si256());
+	__m128i packed = _mm_packs_epi16(_mm256_castsi256_si128(free), _mm256_extracti128_si256(free, 1));
+	return (unsigned)_mm_movemask_epi8(packed);
+#elif defined(__SSE2__)
+	__m128i used = _mm_set1_epi16((short)used_values);
+	__m128i low = _mm_loadu_si128((const __m128i*)tv_values[i]);
+	__m128i high = _mm_loadu_si128((const __m128i*)(tv_values[i] + 8));
+	low = _mm_cmpeq_epi16(_mm_and_si128(low, used), _mm_setzero_si128());
+	high = _mm_cmpeq_epi16(_mm_and_si128(high, used), _mm_setzero_si128());
+	return (unsigned)_mm_movemask_epi8(_mm_packs_epi16(low, high));
+#else
+	unsigned free_columns = 0;
+	for (int j = 0; j < tv_rank; j++) {
+		if ((tv_values[i][j] & used_values) == 0) {
+			free_columns |= 1u << j;
+		}
+	}
+	return free_columns;
+#endif
+}
+
+void orth_mate_search::search_tv_masks(unsigned free_rows, unsigned used_columns, unsigned used_values, vector<vector<int>> &tvr)
+{
+	if (free_rows == 0) {
+		tvr.push_back(vector<int>(tv_columns, tv_columns + tv_rank));
+		return;
+	}
+
+	// Продолжаем со строкой, в которой меньше всего кандидатов
+	int best_row = -1;
+	int best_count = tv_rank + 1;
+	unsigned best_columns = 0;
+	unsigned rows = free_rows;
+
+	while (rows != 0) {
+		int i = lowest_bit_index(rows);
+		rows &= rows - 1;
+
+		unsigned free_columns = tv_free_columns(i, used_values) & ~used_columns & tv_allowed[i];
+		int count = bit_count(free_columns);
+		if (count < best_count) {
+			if (count == 0) {
+				return;
+			}
+			best_row = i;
+			best_count = count;
+			best_columns = free_columns;
+		}
 	}
-	elements.clear();
+
+	while (best_columns != 0) {
+		int j = lowest_bit_index(best_columns);
+		best_columns &= best_columns - 1;
+
+		tv_columns[best_row] = j;
+		search_tv_masks(free_rows & ~(1u << best_row), used_columns | (1u << j), used_values | tv_values[best_row][j], tvr);
+	}
+}
+
+vector<vector<int>> orth_mate_search::find_tv_masks(int n, const vector<vector<int>> &SQ)
+{
+	vector<vector<int>> tvr;
+
+	tv_rank = n;
+	tv_full = (1u << n) - 1;
+	for (int i = 0; i < n; i++) {
+		for (int j = 0; j < MaxMaskRank; j++) {
+			tv_values[i][j] = j < n ? (uint16_t)(1u << SQ[i][j]) : 0xFFFF;
+		}
+		// Клетки диагоналей выбираются заранее, остальные строки их не используют
+		tv_allowed[i] = tv_full & ~(1u << i) & ~(1u << (n - 1 - i));
+	}
+
+	// Трансверсаль содержит ровно одну клетку главной диагонали (a, a) и одну клетку побочной (b, n - 1 - b);
+	// при нечётном ранге это может быть одна центральная клетка
+	for (int a = 0; a < n; a++) {
+		for (int b = 0; b < n; b++) {
+			int main_column = a;
+			int anti_column = n - 1 - b;
+
+			if (a == b) {
+				if (main_column == anti_column) {
+					tv_columns[a] = main_column;
+					search_tv_masks(tv_full & ~(1u << a), 1u << main_column, tv_values[a][main_column], tvr);
+				}
+				continue;
+			}
+			// Центральная клетка лежит на обеих диагоналях и не может сочетаться с другой клеткой диагонали
+			if ((a == n - 1 - a) || (b == n - 1 - b) || (main_column == anti_column)
+				|| (tv_values[a][main_column] & tv_values[b][anti_column])) {
+				continue;
+			}
+
+			tv_columns[a] = main_column;
+			tv_columns[b] = anti_column;
+			search_tv_masks(tv_full & ~(1u << a) & ~(1u << b), (1u << main_column) | (1u << anti_column),
+				tv_values[a][main_column] | tv_values[b][anti_column], tvr);
+		}
+	}
+	sort(tvr.begin(), tvr.end());
+
 	return tvr;
 }
 
+// Поиск диагональных трансверсалей: для рангов до MaxMaskRank - перебором по маскам, иначе - через DLX
+vector<vector<int>> orth_mate_search::find_tv(int n, const vector<vector<int>> &SQ)
+{
+	if (n <= MaxMaskRank) {
+		return find_tv_masks(n, SQ);
+	}
+	return find_tv_dlx(n, SQ);
+}
+
 // Find all orthogonal mates for a given DLS
-void orth_mate_search::check_dlx_rc1(vector<vector<int>> SQ, vector<vector<vector<int>>> &ort_SQ_vec )
-{
-	vector<vector<int>> trm = find_tv_dlx(SQ.size(), SQ);
-	DLX_column *root;
-	root = new (DLX_column);
-	vector<DLX_column*> elements;
-	TVSET_TO_DLX(*root, trm, elements);
-	vector<DLX_column*> ps;
-	ps.clear();
+void orth_mate_search::check_dlx_rc1(const vector<vector<int>> &SQ, vector<vector<vector<int>>> &ort_SQ_vec)
+{
+	vector<vector<int>> trm = find_tv(SQ.size(), SQ);
+	if (trm.size() == 0)
+		return;
+
+	TVSET_TO_DLX(trm);
 	vector<vector<int>> tvr;
 	
-	search(0, *root, ps, tvr);
+	search_all(tvr);
 	for (int i = 0; i < tvr.size(); i++)
 		sort(tvr[i].begin(), tvr[i].end());
-	for (int i = 0; i < elements.size(); i++)
-		delete elements[i];
 	
 	if (tvr.size() == 0)
 		return;
@@ -544,16 +688,40 @@ void orth_mate_search::check_dlx_rc1(vector<vector<int>> SQ, vector<vector<vecto
 	out << "Found " << tvr.size() << " sets of disjoint transversals" << endl;
 	out << "(DLX_refresh)Total: " << trm.size() << " transversals" << endl;*/
 	ort_SQ_vec.resize(tvr.size());
-	vector<vector<int>> ort_SQ(SQ.size(), vector<int>(SQ.size()));
 	for (int i = 0; i < tvr.size(); i++) {
+		vector<vector<int>> &ort_SQ = ort_SQ_vec[i];
+		ort_SQ.resize(SQ.size());
+		for (auto v = 0; v < SQ.size(); v++)
+			ort_SQ[v].resize(SQ.size());
 		for (auto u = 0; u < SQ.size(); u++)
 			for (auto v = 0; v < SQ.size(); v++)
 				ort_SQ[v][trm[tvr[i][u]][v]] = u;
-		ort_SQ_vec[i] = ort_SQ;
 	}
 }
+// Count all diagonal transversals of a given DLS
+unsigned long long orth_mate_search::count_tv_dlx(const vector<vector<int>> &SQ)
+{
+	SQ_TO_DLX(SQ);
+	return count_all();
+}
+
+// Count all orthogonal mates of a given DLS
+unsigned long long orth_mate_search::count_dlx_rc1(const vector<vector<int>> &SQ)
+{
+	vector<vector<int>> trm = find_tv(SQ.size(), SQ);
+	if (trm.size() == 0)
+		return 0;
+
+	TVSET_TO_DLX(trm);
+	return count_all();
+}
 
-void orth_mate_search::generate_permutations_masked_rc1(int n, vector<vector<int>> &perm, vector<vector<int>> mask_LS, bool diag)
+void orth_mate_search::set_threads_count(int threads)
+{
+	threads_count = threads > 1 ? threads : 1;
+}
+
+void orth_mate_search::generate_permutations_masked_rc1(int n, vector<vector<int>> &perm, const vector<vector<int>> &mask_LS, bool diag)
 {
 	vector<vector<int>> MTV(10, vector<int>(10));
 	for (int i = 0; i < n; i++) {
@@ -585,7 +753,7 @@ void orth_mate_search::generate_permutations_masked_rc1(int n, vector<vector<int
 			}
 		}
 	}
-	perm = res;
+	perm.swap(res);
 }
 
 bool orth_mate_search::isdiagls(int n, vector<vector<int>> &SQ)
@@ -626,25 +794,26 @@ bool orth_mate_search::isdiagls(int n, vector<vector<int>> &SQ)
 }
 
 void orth_mate_search::Generate_DLS_masked_DLXrefresh( int n, bool diag, unsigned long long limit, 
-													   vector<vector<int>> mask, vector<vector<vector<int>>> &squares_vec)
+													   const vector<vector<int>> &mask, vector<vector<vector<int>>> &squares_vec)
 {
 	vector<vector<int>> perm_diag;
 	generate_permutations_masked_rc1(n, perm_diag, mask, diag);
 	sort(perm_diag.begin(), perm_diag.end());
 
-	DLX_column *root;
-	root = new (DLX_column);
-	vector<DLX_column*> elements;
-	TVSET_TO_DLX(*root, perm_diag, elements);
+	if (perm_diag.size() == 0) {
+		squares_vec.clear();
+		return;
+	}
+
+	TVSET_TO_DLX(perm_diag);
 
-	vector<DLX_column*> ps;
 	ps.clear();
 	vector<vector<int>> tvr;
 	bool cont = true;
 	double t1 = cpuTime();
 	unsigned long long count = 0;
 	bool count_only = false;
-	search_limited(0, *root, ps, tvr, cont, limit, count_only, count);
+	search_limited(0, ps, tvr, cont, limit, count_only, count);
 	double t2 = cpuTime();
 
 	//cout << tvr.size() << " squares generated in " << t2 - t1 << " seconds" << endl;
@@ -652,7 +821,7 @@ void orth_mate_search::Generate_DLS_masked_DLXrefresh( int n, bool diag, unsigne
 	double sc_t1 = cpuTime();
 	vector<vector<vector<int>>> SQUARES(tvr.size(), vector<vector<int>>(n, vector<int>(n)));
 	construct_squares_from_tv_set(perm_diag, tvr, SQUARES);
-	squares_vec = SQUARES;
+	squares_vec.swap(SQUARES);
 	/*
 	vector<vector<vector<int>>> ort_SQ_vec;
 	double OLDDLX_check0_rc1 = cpuTime();
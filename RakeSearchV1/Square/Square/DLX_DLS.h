@@ -7,47 +7,89 @@
 #include <chrono>
 #include <string>
 #include <algorithm>
+#include <thread>
+#include <atomic>
+#include <stdint.h>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
 
 static inline double cpuTime(void) { return (double)clock() / CLOCKS_PER_SEC; }
 
 using namespace std;
 
-class DLX_column {
+// Матрица Dancing Links в виде структуры массивов связей (индексы узлов вместо указателей).
+// Узел 0 - корень, узлы 1..columns_count - заголовки столбцов, далее - элементы строк
+class DLX_links {
 public:
-	int size;
-	int column_number;
-	int row_id;
-	DLX_column *Left;
-	DLX_column *Right;
-	DLX_column *Up;
-	DLX_column *Down;
-	DLX_column *Column;
+	vector<int> Left;
+	vector<int> Right;
+	vector<int> Up;
+	vector<int> Down;
+	vector<int> Column;
+	vector<int> row_id;
+	vector<int> size;		// Число элементов в столбце (определено для заголовков)
+
+	void reset(int columns_count);
+	void add_row(int row, const int *columns, int count);
 };
 
 class orth_mate_search
 {
 public:
+	static const int MaxMaskRank = 16;	// Наибольший ранг для поиска трансверсалей по битовым маскам
+
 	void generate_permutations(int n, vector<vector<int>> &perm, bool diag);
 	void construct_square_from_tv(vector<vector<int>> &tv_set, vector<int> &tv_ind, vector<vector<int>> &SQ);
 	void construct_squares_from_tv_set(vector<vector<int>>&tv_set, vector<vector<int>> &tv_index_sets, vector<vector<vector<int>>> &SQUARES);
 	void TV_check(vector<vector<int>> &TVSET, vector<vector<int>> &LS, vector<int> &indices);
-	void cover(DLX_column *&c);
-	void uncover(DLX_column *&c);
-	void choose_c(DLX_column &h, DLX_column *&c);
-	void print_solution(vector<DLX_column*> &ps);
-	void search_limited(int k, DLX_column &h, vector<DLX_column*> &ps, vector<vector<int>> &tvr, bool &cont, unsigned long long &limit, bool &count_only, unsigned long long &count);
-	void search(int k, DLX_column &h, vector<DLX_column*> &ps, vector<vector<int>> &tvr);
-	void TVSET_TO_DLX(DLX_column &root, vector<vector<int>> & tvset, vector<DLX_column*> & elements);
-	void SQ_TO_DLX(DLX_column &root, vector<vector<int>> & SQ, vector<DLX_column*> & elements);
-	void TVSET_TO_DLX_EXT(DLX_column &root, vector<vector<int>> & tvset, vector<DLX_column*> & columns, vector<vector<DLX_column*>> &rows);
-	vector<vector<int>> find_tv_dlx(int n, vector<vector<int>> &SQ);
-	void check_dlx_rc1(vector<vector<int>> SQ, vector<vector<vector<int>>> &ort_SQ_vec);
-	void generate_permutations_masked_rc1(int n, vector<vector<int>> &perm, vector<vector<int>> mask_LS, bool diag);
+	void cover(int c);
+	void uncover(int c);
+	int choose_c();
+	void print_solution(const vector<int> &ps);
+	void search_limited(int k, vector<int> &ps, vector<vector<int>> &tvr, bool &cont, unsigned long long &limit, bool &count_only, unsigned long long &count);
+	void search(int k, vector<int> &ps, vector<vector<int>> &tvr);
+	unsigned long long search_count(int k);
+	void collect_tasks(int k, int max_depth, vector<int> &prefix, vector<vector<int>> &tasks);
+	void apply_task(const vector<int> &prefix);
+	unsigned long long search_parallel(vector<vector<int>> &tvr, bool count_only);
+	void search_all(vector<vector<int>> &tvr);
+	unsigned long long count_all();
+	void TVSET_TO_DLX(const vector<vector<int>> &tvset);
+	void SQ_TO_DLX(const vector<vector<int>> &SQ);
+	void TVSET_TO_DLX_EXT(const vector<vector<int>> &tvset, vector<int> &columns, vector<vector<int>> &rows);
+	vector<vector<int>> find_tv_dlx(int n, const vector<vector<int>> &SQ);
+	vector<vector<int>> find_tv_masks(int n, const vector<vector<int>> &SQ);
+	vector<vector<int>> find_tv(int n, const vector<vector<int>> &SQ);
+	void check_dlx_rc1(const vector<vector<int>> &SQ, vector<vector<vector<int>>> &ort_SQ_vec);
+	unsigned long long count_tv_dlx(const vector<vector<int>> &SQ);
+	unsigned long long count_dlx_rc1(const vector<vector<int>> &SQ);
+	void set_threads_count(int threads);
+	void generate_permutations_masked_rc1(int n, vector<vector<int>> &perm, const vector<vector<int>> &mask_LS, bool diag);
 	bool isdiagls(int n, vector<vector<int>> &SQ);
-	void Generate_DLS_masked_DLXrefresh(int n, bool diag, unsigned long long limit, vector<vector<int>> mask, vector<vector<vector<int>>> &squares_vec);
+	void Generate_DLS_masked_DLXrefresh(int n, bool diag, unsigned long long limit, const vector<vector<int>> &mask, vector<vector<vector<int>>> &squares_vec);
 	void print_sq(vector<vector<int>> &SQ);
 	vector<vector<int>> compute_masked_LS(vector<vector<int>> &LS, vector<vector<int>> &MASK);
 	vector<vector<int>> compute_masked_LS(vector<vector<int>> &LS, int k);
+
+protected:
+	DLX_links dlx;		// Матрица DLX, память которой переиспользуется между вызовами
+	vector<int> ps;		// Текущее частичное решение (узлы выбранных строк)
+	int threads_count = 1;	// Число потоков поиска
+
+	int tv_rank = 0;						// Ранг квадрата при поиске трансверсалей по маскам
+	unsigned tv_full = 0;					// Маска всех столбцов квадрата
+	uint16_t tv_values[MaxMaskRank][MaxMaskRank];	// Битовые маски значений клеток квадрата
+	unsigned tv_allowed[MaxMaskRank];		// Маски столбцов строк, доступных после выбора клеток диагоналей
+	int tv_columns[MaxMaskRank];			// Столбцы текущей частичной трансверсали
+
+	unsigned tv_free_columns(int i, unsigned used_values);
+	void search_tv_masks(unsigned free_rows, unsigned used_columns, unsigned used_values, vector<vector<int>> &tvr);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,220 @@
+﻿// Построение рёбер графа из ОДЛК: блочная проверка ортогональности всех пар квадратов множества
+
+# include <algorithm>
+# include <atomic>
+# include <condition_variable>
+# include <mutex>
+# include <thread>
+# if defined(__AVX2__)
+# include <immintrin.h>
+# elif defined(__SSE4_1__)
+# include <smmintrin.h>
+# endif
+# include "GraphEdges.h"
+
+using namespace std;
+
+// Вычисление масок значений: для каждого значения - множество клеток квадрата, где оно стоит.
+// Маски недостающих до MasksCount значений заполняются единицами и не влияют на проверку
+void GraphEdges::PrepareMasks(SquareDatabase& squares)
+{
+	static_assert(SquareDatabase::CellsCount <= 128, "Value masks are limited to 128 cells");
+
+	Square square;
+
+	squaresCount = squares.Size();
+	masks.assign((size_t) squaresCount*MasksCount, ValueMask());
+
+	for (int squareId = 0; squareId < squaresCount; squareId++)
+	{
+		ValueMask* squareMasks = &masks[(size_t) squareId*MasksCount];
+
+		for (int value = 0; value < MasksCount; value++)
+		{
+			squareMasks[value].Low = value < Square::Rank ? 0 : ~0ULL;
+			squareMasks[value].High = value < Square::Rank ? 0 : ~0ULL;
+		}
+
+		squares.Get(squareId, square);
+
+		for (int cellId = 0; cellId < SquareDatabase::CellsCount; cellId++)
+		{
+			int value = square.Matrix[cellId / Square::Rank][cellId % Square::Rank];
+
+			if (cellId < 64)
+			{
+				squareMasks[value].Low |= 1ULL << cellId;
+			}
+			else
+			{
+				squareMasks[value].High |= 1ULL << (cellId - 64);
+			}
+		}
+	}
+}
+
+
+// Проверка ортогональности квадратов a и b. Квадраты ортогональны, если для любых значений v и w
+// есть клетка, где в a стоит v, а в b - w: Rank*Rank пар на Rank*Rank клеток, значит каждая пара ровно одна.
+// Для значения v квадрата a сразу проверяются все значения w квадрата b; проверка прекращается на первом
+// значении v с пустым пересечением, что для неортогональных квадратов обычно происходит уже при v = 0
+int GraphEdges::IsOrthogonal(int a, int b)
+{
+	const ValueMask* aMasks = &masks[(size_t) a*MasksCount];
+	const ValueMask* bMasks = &masks[(size_t) b*MasksCount];
+
+	for (int value = 0; value < Square::Rank; value++)
+	{
+# if defined(__AVX2__)
+		__m256i aMask = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*) &aMasks[value]));
+		int emptyPairs = 0;
+
+		for (int pairId = 0; pairId < MasksCount; pairId += 2)
+		{
+			__m256i bMask = _mm256_loadu_si256((const __m256i*) &bMasks[pairId]);
+			__m256i isZero = _mm256_cmpeq_epi64(_mm256_and_si256(aMask, bMask), _mm256_setzero_si256());
+			int zeroWords = _mm256_movemask_pd(_mm256_castsi256_pd(isZero));
+
+			// Пересечение пусто, если обе 64-битные половины нулевые
+			emptyPairs |= zeroWords & (zeroWords >> 1) & 0x5;
+		}
+
+		if (emptyPairs)
+		{
+			return 0;
+		}
+# elif defined(__SSE4_1__)
+		__m128i aMask = _mm_loadu_si128((const __m128i*) &aMasks[value]);
+
+		for (int pairId = 0; pairId < Square::Rank; pairId++)
+		{
+			if (_mm_testz_si128(aMask, _mm_loadu_si128((const __m128i*) &bMasks[pairId])))
+			{
+				return 0;
+			}
+		}
+# else
+		for (int pairId = 0; pairId < Square::Rank; pairId++)
+		{
+			if (((aMasks[value].Low & bMasks[pairId].Low) | (aMasks[value].High & bMasks[pairId].High)) == 0)
+			{
+				return 0;
+			}
+		}
+# endif
+	}
+
+return 1;
+}
+
+
+// Поиск рёбер для квадратов i задачи tileId со всеми квадратами j > i. Квадраты j перебираются блоками,
+// чтобы маски блока оставались в кеше, пока с ним сравниваются все квадраты задачи.
+// Рёбра упаковываются как (i << 32) | j и сортируются, т.е. выдаются в порядке (i, j)
+void GraphEdges::ProcessTile(int tileId, vector<uint64_t>& edges)
+{
+	int tileStart = tileId*TileSize;
+	int tileEnd = min(tileStart + TileSize, squaresCount);
+
+	edges.clear();
+
+	for (int blockStart = tileStart; blockStart < squaresCount; blockStart += BlockSize)
+	{
+		int blockEnd = min(blockStart + BlockSize, squaresCount);
+
+		for (int i = tileStart; i < tileEnd && i < blockEnd; i++)
+		{
+			for (int j = max(i + 1, blockStart); j < blockEnd; j++)
+			{
+				if (IsOrthogonal(i, j))
+				{
+					edges.push_back(((uint64_t) i << 32) | (uint32_t) j);
+				}
+			}
+		}
+	}
+
+	sort(edges.begin(), edges.end());
+}
+
+
+// Построение рёбер графа. Задачи (блоки по TileSize квадратов) раздаются потокам через общий счётчик,
+// рёбра задач записываются в поток по мере готовности в порядке задач: текстом "IdA;IdB" и,
+// если задан binaryStream, парами 32-битных номеров
+long long GraphEdges::Build(SquareDatabase& squares, int threadsCount, std::ostream& textStream, std::ostream* binaryStream)
+{
+	long long edgesCount = 0;
+	int tilesCount;
+	int writtenTiles = 0;
+	atomic<int> nextTile(0);
+	mutex tilesMutex;
+	condition_variable tileReady;
+	vector<vector<uint64_t>> tileEdges;
+	vector<int> isTileReady;
+	vector<thread> workers;
+
+	PrepareMasks(squares);
+	tilesCount = (squaresCount + TileSize - 1) / TileSize;
+	tileEdges.resize(tilesCount);
+	isTileReady.assign(tilesCount, 0);
+
+	auto worker = [&]()
+	{
+		vector<uint64_t> edges;
+		int tileId;
+
+		while ((tileId = nextTile++) < tilesCount)
+		{
+			ProcessTile(tileId, edges);
+
+			lock_guard<mutex> lock(tilesMutex);
+			tileEdges[tileId].swap(edges);
+			isTileReady[tileId] = 1;
+			tileReady.notify_one();
+		}
+	};
+
+	if (threadsCount < 1)
+	{
+		threadsCount = 1;
+	}
+	for (int i = 0; i < threadsCount; i++)
+	{
+		workers.push_back(thread(worker));
+	}
+
+	// Запись рёбер задач по порядку
+	while (writtenTiles < tilesCount)
+	{
+		vector<uint64_t> edges;
+
+		{
+			unique_lock<mutex> lock(tilesMutex);
+			tileReady.wait(lock, [&]() { return isTileReady[writtenTiles] != 0; });
+			edges.swap(tileEdges[writtenTiles]);
+		}
+
+		for (size_t edgeId = 0; edgeId < edges.size(); edgeId++)
+		{
+			uint32_t pair[2] = { (uint32_t) (edges[edgeId] >> 32), (uint32_t) edges[edgeId] };
+
+			textStream << pair[0] << ";" << pair[1] << "\n";
+			if (binaryStream != NULL)
+			{
+				binaryStream->write((const char*) pair, sizeof(pair));
+			}
+		}
+
+		edgesCount += edges.size();
+		writtenTiles++;
+		cout << "Processed " << min(writtenTiles*TileSize, squaresCount) << " of " << squaresCount
+			<< " squares, " << edgesCount << " edges" << endl;
+	}
+
+	for (size_t i = 0; i < workers.size(); i++)
+	{
+		workers[i].join();
+	}
+
+return edgesCount;
+}
@@ -0,0 +1,39 @@
+﻿// Построение рёбер графа из ОДЛК: блочная проверка ортогональности всех пар квадратов множества
+
+# if !defined GraphEdges_h
+# define GraphEdges_h
+
+# include <iostream>
+# include <vector>
+# include <stdint.h>
+# include "Square.h"
+# include "SquareDatabase.h"
+
+using namespace std;
+
+class GraphEdges
+{
+public:
+	static const int MasksCount = (Square::Rank + 1) / 2 * 2;	// Число масок значений квадрата (чётное - по две маски в регистре AVX2)
+	static const int TileSize = 1024;		// Число квадратов в задаче потока (строк блока пар)
+	static const int BlockSize = 64;		// Число квадратов в блоке столбцов, проверяемом со всеми квадратами задачи
+
+	long long Build(SquareDatabase& squares, int threadsCount, std::ostream& textStream, std::ostream* binaryStream);	// Построение рёбер графа
+
+protected:
+private:
+	struct ValueMask						// Маска клеток квадрата, содержащих заданное значение
+	{
+		uint64_t Low;
+		uint64_t High;
+	};
+
+	void PrepareMasks(SquareDatabase& squares);				// Вычисление масок значений всех квадратов
+	int IsOrthogonal(int a, int b);						// Проверка ортогональности квадратов a и b
+	void ProcessTile(int tileId, vector<uint64_t>& edges);	// Поиск рёбер для квадратов задачи tileId
+
+	int squaresCount;						// Число квадратов графа
+	vector<ValueMask> masks;				// Маски значений: masks[squareId*MasksCount + value]
+};
+
+# endif
@@ -0,0 +1,206 @@
+﻿// Поиск графа из ОДЛК обходом в ширину с параллельной обработкой фронта и сохранением уровней в базе квадратов
+
+# include <chrono>
+# include <thread>
+# include "GraphSearch.h"
+
+using namespace std;
+
+// Конструктор по умолчанию
+GraphSearch::GraphSearch()
+{
+	threadsCount = 1;
+	level = 0;
+	frontierStart = 0;
+	nextSquareId = 0;
+	isTheGraph = 0;
+}
+
+
+// Инициализация поиска: открывается база квадратов. Если задано продолжение поиска и база не пуста,
+// поиск продолжается с сохранённого в ней фронта - только когда база построена от того же квадрата start.
+// Иначе база очищается, и поиск начинается с квадрата start
+int GraphSearch::Initialize(Square& start, string databaseFileName, int threads, int isResumed)
+{
+	threadsCount = threads > 0 ? threads : 1;
+	finders.resize(threadsCount);
+
+	if (!squaresDatabase.Open(databaseFileName, 0))
+	{
+		return 0;
+	}
+
+	if (isResumed && squaresDatabase.Size() > 0)
+	{
+		if (!squaresDatabase.IsStart(start))
+		{
+			cerr << "Square database " << databaseFileName << " was built from another start square, it cannot be resumed" << endl;
+			return 0;
+		}
+
+		level = squaresDatabase.Level();
+		frontierStart = squaresDatabase.FrontierStart();
+		cout << "Resume from square database: level " << level << ", " << squaresDatabase.Size() << " squares, "
+			<< squaresDatabase.Size() - frontierStart << " squares in frontier" << endl;
+	}
+	else
+	{
+		if (squaresDatabase.Size() > 0)
+		{
+			cout << "Square database " << databaseFileName << " is cleared, use --resume to continue its search" << endl;
+		}
+
+		squaresDatabase.Clear();
+		squaresDatabase.SetStart(start);
+		squaresDatabase.Add(start);
+		level = 0;
+		frontierStart = 0;
+		squaresDatabase.Commit(frontierStart, level);
+	}
+
+return 1;
+}
+
+
+// Запуск поиска: на каждом уровне для квадратов фронта (квадратов, добавленных на предыдущем уровне)
+// ищутся ОДЛК, новые квадраты добавляются в базу и образуют следующий фронт.
+// После обработки уровня база сохраняется вместе с курсором фронта
+int GraphSearch::Start(SquareSet& checkList)
+{
+	vector<vector<Square>> found;	// Найденные ОДЛК, которых ещё нет в базе, - для каждого квадрата фронта
+	long long matesCount;			// Число найденных ОДЛК, включая уже известные
+	int frontierSize;				// Число квадратов во фронте
+	int newSquaresInIteration;		// Число новых квадратов, найденных на уровне
+	int newFrontierStart;			// Номер первого квадрата следующего фронта
+
+	cout << "Starting to search an orthogonal squares ..." << endl;
+
+	isTheGraph = 0;
+
+	// Обход продолжается, пока фронт не пуст - т.е. пока на предыдущем уровне находятся новые квадраты
+	while (frontierStart < squaresDatabase.Size())
+	{
+		auto startTime = chrono::steady_clock::now();
+
+		frontierSize = squaresDatabase.Size() - frontierStart;
+		found.clear();
+		found.resize(frontierSize);
+		matesCount = ExpandFrontier(checkList, found);
+
+		if (isTheGraph)
+		{
+			cout << "Found The Graph! Exit." << endl;
+			break;
+		}
+
+		// Добавление новых квадратов в порядке фронта - номера квадратов не зависят от числа потоков
+		newFrontierStart = squaresDatabase.Size();
+		newSquaresInIteration = 0;
+
+		for (int squareId = 0; squareId < frontierSize; squareId++)
+		{
+			for (size_t itemId = 0; itemId < found[squareId].size(); itemId++)
+			{
+				newSquaresInIteration += squaresDatabase.Add(found[squareId][itemId]);
+			}
+		}
+
+		frontierStart = newFrontierStart;
+		level++;
+
+		// Вывод статистики уровня
+		double seconds = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+
+		cout << "Level " << level << ": processed " << frontierSize << " squares, found " << matesCount << " mates, "
+			<< newSquaresInIteration << " new squares, " << seconds << " s" << endl;
+		cout << "Total squares: " << squaresDatabase.Size() << endl;
+
+		squaresDatabase.Commit(frontierStart, level);
+	}
+
+return isTheGraph;
+}
+
+
+// База найденных квадратов
+SquareDatabase& GraphSearch::Squares()
+{
+	return squaresDatabase;
+}
+
+
+// Поиск ОДЛК для квадратов фронта. Если квадратов во фронте не меньше, чем потоков, то каждый поток
+// обрабатывает свои квадраты однопоточным искателем; иначе квадраты обрабатываются по очереди
+// искателем, распараллеливающим поиск для одного квадрата
+long long GraphSearch::ExpandFrontier(SquareSet& checkList, vector<vector<Square>>& found)
+{
+	vector<thread> workers;
+	vector<long long> workerMates(threadsCount, 0);
+	long long matesCount = 0;
+
+	nextSquareId = 0;
+	isTheGraph = 0;
+
+	if ((int) found.size() < threadsCount)
+	{
+		finders[0].set_threads_count(threadsCount);
+		matesCount = ExpandSquares(0, checkList, found);
+	}
+	else
+	{
+		for (int workerId = 0; workerId < threadsCount; workerId++)
+		{
+			finders[workerId].set_threads_count(1);
+			workers.push_back(thread([&, workerId]() { workerMates[workerId] = ExpandSquares(workerId, checkList, found); }));
+		}
+
+		for (int workerId = 0; workerId < threadsCount; workerId++)
+		{
+			workers[workerId].join();
+			matesCount += workerMates[workerId];
+		}
+	}
+
+return matesCount;
+}
+
+
+// Обработка квадратов фронта одним потоком: квадраты берутся по общему счётчику,
+// найденные ОДЛК проверяются по проверочному списку и по базе найденных квадратов.
+// Список и база во время обработки фронта только читаются, поэтому доступны всем потокам
+long long GraphSearch::ExpandSquares(int workerId, SquareSet& checkList, vector<vector<Square>>& found)
+{
+	orth_mate_search& finder = finders[workerId];
+	vector<vector<int>> squareVector;
+	vector<vector<vector<int>>> result;
+	Square square;
+	long long matesCount = 0;
+	int squareId;
+
+	while (!isTheGraph && (squareId = nextSquareId++) < (int) found.size())
+	{
+		squaresDatabase.Get(frontierStart + squareId, square);
+		squareVector.clear();
+		squareVector << square;
+		result.clear();
+		finder.check_dlx_rc1(squareVector, result);
+		matesCount += result.size();
+
+		for (size_t resultItemId = 0; resultItemId < result.size(); resultItemId++)
+		{
+			result[resultItemId] >> square;
+
+			if (checkList.Contains(square))
+			{
+				isTheGraph = 1;
+			}
+
+			if (!squaresDatabase.Contains(square))
+			{
+				found[squareId].push_back(square);
+			}
+		}
+	}
+
+return matesCount;
+}
@@ -0,0 +1,39 @@
+﻿// Поиск графа из ОДЛК обходом в ширину с параллельной обработкой фронта и сохранением уровней в базе квадратов
+
+# if !defined GraphSearch_h
+# define GraphSearch_h
+
+# include <atomic>
+# include <iostream>
+# include <string>
+# include <vector>
+# include "Square.h"
+# include "SquareSet.h"
+# include "SquareDatabase.h"
+# include "DLX_DLS.h"
+
+using namespace std;
+
+class GraphSearch
+{
+public:
+	GraphSearch();											// Конструктор по умолчанию
+	int Initialize(Square& start, string databaseFileName, int threads, int isResumed);	// Инициализация поиска; возвращает 1 в случае успеха
+	int Start(SquareSet& checkList);						// Запуск поиска; возвращает 1, если найден квадрат из проверочного списка
+	SquareDatabase& Squares();								// База найденных квадратов
+
+protected:
+private:
+	long long ExpandFrontier(SquareSet& checkList, vector<vector<Square>>& found);	// Поиск ОДЛК для квадратов фронта; возвращает число найденных ОДЛК
+	long long ExpandSquares(int workerId, SquareSet& checkList, vector<vector<Square>>& found);	// Обработка квадратов фронта одним потоком
+
+	int threadsCount;					// Число потоков поиска
+	int level;							// Номер уровня обхода (итерации поиска)
+	int frontierStart;					// Номер первого квадрата фронта - квадраты фронта идут в конце базы
+	atomic<int> nextSquareId;			// Номер следующего обрабатываемого квадрата фронта (общий для потоков)
+	atomic<int> isTheGraph;				// Флаг нахождения квадрата из проверочного списка
+	SquareDatabase squaresDatabase;		// База найденных квадратов
+	vector<orth_mate_search> finders;	// Искатели ОДЛК - по одному на поток
+};
+
+# endif
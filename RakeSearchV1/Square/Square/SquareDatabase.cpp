@@ -0,0 +1,503 @@
+﻿// База квадратов: файл из упакованных записей фиксированной длины, отображаемый в память, с хеш-индексом
+
+# include <iostream>
+# include <string.h>
+# if defined(_WIN32)
+# include <windows.h>
+# else
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <unistd.h>
+# endif
+# include "SquareDatabase.h"
+
+using namespace std;
+
+const char SquareDatabase::Signature[8] = { 'R', 'S', 'Q', 'D', 'B', '0', '2', 0 };
+
+// Конструктор по умолчанию
+SquareDatabase::SquareDatabase()
+{
+	static_assert(Square::Rank <= 16, "Square values must fit in a nibble");
+	static_assert(sizeof(Header) == HeaderSize, "Wrong database header size");
+
+	isReadOnly = 1;
+	count = 0;
+	capacity = 0;
+	data = NULL;
+	mappedSize = 0;
+	fileDescriptor = -1;
+	fileHandle = NULL;
+	mappingHandle = NULL;
+	slots.assign(1024, 0);
+	slotsMask = slots.size() - 1;
+}
+
+
+// Деструктор
+SquareDatabase::~SquareDatabase()
+{
+	Close();
+}
+
+
+// Открытие базы. Несуществующий файл создаётся (если база открывается не только для чтения).
+// Учитываются только сохранённые вызовом Commit квадраты; индекс строится по ним заново
+int SquareDatabase::Open(string fileName, int readOnly)
+{
+	size_t fileSize = 0;
+	Header* header;
+
+	Close();
+	isReadOnly = readOnly;
+
+	// Открытие файла
+# if defined(_WIN32)
+	HANDLE file = CreateFileA(fileName.c_str(), isReadOnly ? GENERIC_READ : GENERIC_READ | GENERIC_WRITE,
+		FILE_SHARE_READ, NULL, isReadOnly ? OPEN_EXISTING : OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	LARGE_INTEGER size;
+
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		cerr << "Error opening square database " << fileName << endl;
+		return 0;
+	}
+
+	fileHandle = file;
+	GetFileSizeEx(file, &size);
+	fileSize = (size_t) size.QuadPart;
+# else
+	struct stat fileStat;
+
+	fileDescriptor = open(fileName.c_str(), isReadOnly ? O_RDONLY : O_RDWR | O_CREAT, 0644);
+
+	if (fileDescriptor < 0)
+	{
+		cerr << "Error opening square database " << fileName << endl;
+		return 0;
+	}
+
+	fstat(fileDescriptor, &fileStat);
+	fileSize = (size_t) fileStat.st_size;
+# endif
+
+	// Создание пустой базы или проверка заголовка существующей
+	if (fileSize == 0 && !isReadOnly)
+	{
+		if (!Map(HeaderSize + (size_t) InitialCapacity*RecordSize))
+		{
+			cerr << "Error creating square database " << fileName << endl;
+			Close();
+			return 0;
+		}
+
+		header = FileHeader();
+		memset(header, 0, HeaderSize);
+		memcpy(header->Signature, Signature, sizeof(Signature));
+		header->Rank = Square::Rank;
+		header->RecordSize = RecordSize;
+		Flush();
+	}
+	else
+	{
+		if (fileSize < HeaderSize || !Map(fileSize))
+		{
+			cerr << "Error mapping square database " << fileName << endl;
+			Close();
+			return 0;
+		}
+
+		header = FileHeader();
+
+		if (memcmp(header->Signature, Signature, sizeof(Signature)) != 0 || header->Rank != Square::Rank
+			|| header->RecordSize != RecordSize || header->Count > (uint64_t) capacity
+			|| header->FrontierStart > header->Count)
+		{
+			cerr << "Wrong square database " << fileName << endl;
+			Close();
+			return 0;
+		}
+	}
+
+	// Построение индекса
+	count = (int) FileHeader()->Count;
+	slots.assign(1024, 0);
+	slotsMask = slots.size() - 1;
+
+	for (int itemId = 0; itemId < count; itemId++)
+	{
+		Index(itemId, ComputeHash(Record(itemId)));
+	}
+
+return 1;
+}
+
+
+// Закрытие базы. Квадраты, добавленные после последнего вызова Commit, не сохраняются
+void SquareDatabase::Close()
+{
+	Unmap();
+
+# if defined(_WIN32)
+	if (fileHandle != NULL)
+	{
+		CloseHandle((HANDLE) fileHandle);
+		fileHandle = NULL;
+	}
+# else
+	if (fileDescriptor >= 0)
+	{
+		close(fileDescriptor);
+		fileDescriptor = -1;
+	}
+# endif
+
+	count = 0;
+	capacity = 0;
+}
+
+
+// Упаковка квадрата в запись: по полбайта на клетку, чётные клетки - в младших половинах байт
+void SquareDatabase::Pack(const Square& value, uint8_t* record)
+{
+	memset(record, 0, RecordSize);
+
+	for (int cellId = 0; cellId < CellsCount; cellId++)
+	{
+		record[cellId / 2] |= (uint8_t) (value.Matrix[cellId / Square::Rank][cellId % Square::Rank] << (4*(cellId % 2)));
+	}
+}
+
+
+// Вычисление 64-битного хеша записи: свёртка по 8 байт за шаг с перемешиванием итогового значения
+uint64_t SquareDatabase::ComputeHash(const uint8_t* record, uint64_t seed)
+{
+	uint64_t hash = seed;
+
+	for (int offset = 0; offset < RecordSize; offset += 8)
+	{
+		uint64_t word = 0;
+		int length = RecordSize - offset < 8 ? RecordSize - offset : 8;
+
+		memcpy(&word, record + offset, length);
+		hash = (hash ^ word) * 0xFF51AFD7ED558CCDULL;
+		hash ^= hash >> 32;
+	}
+
+	hash ^= hash >> 33;
+	hash *= 0xC4CEB9FE1A85EC53ULL;
+	hash ^= hash >> 33;
+
+return hash;
+}
+
+
+// Запись квадрата по номеру
+uint8_t* SquareDatabase::Record(int index)
+{
+	return data + HeaderSize + (size_t) index*RecordSize;
+}
+
+
+// Заголовок файла
+SquareDatabase::Header* SquareDatabase::FileHeader()
+{
+	return (Header*) data;
+}
+
+
+// Поиск ячейки индекса, в которой лежит квадрат, или пустой ячейки, в которую его можно добавить.
+// Записи сравниваются только при совпадении старших 32 бит хеша, хранящихся в ячейке
+int SquareDatabase::FindSlot(uint64_t hash, const uint8_t* record)
+{
+	uint64_t slotId = hash & slotsMask;
+	uint64_t tag = hash >> 32;
+
+	while (slots[slotId] != 0)
+	{
+		if ((slots[slotId] >> 32) == tag
+			&& memcmp(Record((int) (slots[slotId] & 0xFFFFFFFFULL) - 1), record, RecordSize) == 0)
+		{
+			break;
+		}
+
+		slotId = (slotId + 1) & slotsMask;
+	}
+
+return (int) slotId;
+}
+
+
+// Добавление квадрата в индекс; индекс увеличивается при заполнении наполовину
+void SquareDatabase::Index(int index, uint64_t hash)
+{
+	uint64_t slotId;
+
+	if ((uint64_t) (index + 1)*2 > slots.size())
+	{
+		GrowIndex(index);
+	}
+
+	slotId = hash & slotsMask;
+
+	while (slots[slotId] != 0)
+	{
+		slotId = (slotId + 1) & slotsMask;
+	}
+
+	slots[slotId] = (hash & 0xFFFFFFFF00000000ULL) | (uint64_t) (index + 1);
+}
+
+
+// Увеличение индекса вдвое: хеши первых indexedCount квадратов пересчитываются по записям базы
+void SquareDatabase::GrowIndex(int indexedCount)
+{
+	slots.assign(slots.size()*2, 0);
+	slotsMask = slots.size() - 1;
+
+	for (int itemId = 0; itemId < indexedCount; itemId++)
+	{
+		uint64_t hash = ComputeHash(Record(itemId));
+		uint64_t slotId = hash & slotsMask;
+
+		while (slots[slotId] != 0)
+		{
+			slotId = (slotId + 1) & slotsMask;
+		}
+
+		slots[slotId] = (hash & 0xFFFFFFFF00000000ULL) | (uint64_t) (itemId + 1);
+	}
+}
+
+
+// Добавление квадрата в конец базы. Запись попадает в файл сразу, но учитывается при следующем
+// открытии базы только после вызова Commit
+int SquareDatabase::Add(const Square& value)
+{
+	uint8_t record[RecordSize];
+	uint64_t hash;
+	int slotId;
+
+	Pack(value, record);
+	hash = ComputeHash(record);
+	slotId = FindSlot(hash, record);
+
+	if (slots[slotId] != 0 || isReadOnly)
+	{
+		return 0;
+	}
+
+	// Увеличение файла вдвое при заполнении
+	if (count == capacity)
+	{
+		size_t newSize = HeaderSize + (size_t) capacity*2*RecordSize;
+
+		Unmap();
+
+		if (!Map(newSize))
+		{
+			cerr << "Error growing square database!" << endl;
+			throw ("Error growing square database");
+		}
+	}
+
+	memcpy(Record(count), record, RecordSize);
+	Index(count, hash);
+	count++;
+
+return 1;
+}
+
+
+// Поиск квадрата в базе
+int SquareDatabase::Find(const Square& value)
+{
+	uint8_t record[RecordSize];
+	uint64_t hash;
+	int slotId;
+
+	Pack(value, record);
+	hash = ComputeHash(record);
+	slotId = FindSlot(hash, record);
+
+return (int) (slots[slotId] & 0xFFFFFFFFULL) - 1;
+}
+
+
+// Проверка наличия квадрата в базе
+int SquareDatabase::Contains(const Square& value)
+{
+	return Find(value) >= 0;
+}
+
+
+// Получение квадрата по номеру
+void SquareDatabase::Get(int index, Square& value)
+{
+	const uint8_t* record = Record(index);
+
+	for (int cellId = 0; cellId < CellsCount; cellId++)
+	{
+		value.Matrix[cellId / Square::Rank][cellId % Square::Rank] = (record[cellId / 2] >> (4*(cellId % 2))) & 0xF;
+	}
+}
+
+
+// Число квадратов в базе
+int SquareDatabase::Size()
+{
+	return count;
+}
+
+
+// Номер первого квадрата фронта поиска
+int SquareDatabase::FrontierStart()
+{
+	return (int) FileHeader()->FrontierStart;
+}
+
+
+// Номер уровня поиска
+int SquareDatabase::Level()
+{
+	return (int) FileHeader()->Level;
+}
+
+
+// Сохранение базы: сначала на диск записываются добавленные квадраты, затем - заголовок с их числом
+// и курсором фронта. Сбой между двумя записями оставляет в силе предыдущее сохранённое состояние
+void SquareDatabase::Commit(int frontierStart, int level)
+{
+	Header* header = FileHeader();
+
+	if (isReadOnly)
+	{
+		return;
+	}
+
+	Flush();
+	header->Count = count;
+	header->FrontierStart = frontierStart;
+	header->Level = level;
+	Flush();
+}
+
+
+// Удаление всех квадратов базы: файл остаётся прежнего размера, заголовок сразу записывается на диск
+void SquareDatabase::Clear()
+{
+	if (isReadOnly)
+	{
+		return;
+	}
+
+	count = 0;
+	slots.assign(1024, 0);
+	slotsMask = slots.size() - 1;
+	memset(FileHeader()->StartHash, 0, sizeof(FileHeader()->StartHash));
+	Commit(0, 0);
+}
+
+
+// Запоминание 128-битного хеша начального квадрата - два 64-битных хеша записи с разными начальными значениями
+void SquareDatabase::SetStart(const Square& start)
+{
+	uint8_t record[RecordSize];
+
+	if (isReadOnly)
+	{
+		return;
+	}
+
+	Pack(start, record);
+	FileHeader()->StartHash[0] = ComputeHash(record);
+	FileHeader()->StartHash[1] = ComputeHash(record, 0xD6E8FEB86659FD93ULL);
+}
+
+
+// Проверка того, что база построена от квадрата start
+int SquareDatabase::IsStart(const Square& start)
+{
+	uint8_t record[RecordSize];
+
+	Pack(start, record);
+
+return FileHeader()->StartHash[0] == ComputeHash(record)
+	&& FileHeader()->StartHash[1] == ComputeHash(record, 0xD6E8FEB86659FD93ULL);
+}
+
+
+// Отображение файла в память. Если база открыта для записи, файл предварительно увеличивается до size
+int SquareDatabase::Map(size_t size)
+{
+# if defined(_WIN32)
+	mappingHandle = CreateFileMappingA((HANDLE) fileHandle, NULL, isReadOnly ? PAGE_READONLY : PAGE_READWRITE,
+		(DWORD) ((uint64_t) size >> 32), (DWORD) size, NULL);
+
+	if (mappingHandle == NULL)
+	{
+		return 0;
+	}
+
+	data = (uint8_t*) MapViewOfFile((HANDLE) mappingHandle, isReadOnly ? FILE_MAP_READ : FILE_MAP_WRITE, 0, 0, size);
+
+	if (data == NULL)
+	{
+		CloseHandle((HANDLE) mappingHandle);
+		mappingHandle = NULL;
+		return 0;
+	}
+# else
+	void* address;
+
+	if (!isReadOnly && ftruncate(fileDescriptor, (off_t) size) != 0)
+	{
+		return 0;
+	}
+
+	address = mmap(NULL, size, isReadOnly ? PROT_READ : PROT_READ | PROT_WRITE, MAP_SHARED, fileDescriptor, 0);
+
+	if (address == MAP_FAILED)
+	{
+		return 0;
+	}
+
+	data = (uint8_t*) address;
+# endif
+
+	mappedSize = size;
+	capacity = (int) ((size - HeaderSize) / RecordSize);
+
+return 1;
+}
+
+
+// Отмена отображения файла
+void SquareDatabase::Unmap()
+{
+	if (data != NULL)
+	{
+# if defined(_WIN32)
+		UnmapViewOfFile(data);
+		CloseHandle((HANDLE) mappingHandle);
+		mappingHandle = NULL;
+# else
+		munmap(data, mappedSize);
+# endif
+		data = NULL;
+		mappedSize = 0;
+	}
+}
+
+
+// Запись изменённых страниц отображённого файла на диск
+void SquareDatabase::Flush()
+{
+# if defined(_WIN32)
+	FlushViewOfFile(data, 0);
+	FlushFileBuffers((HANDLE) fileHandle);
+# else
+	msync(data, mappedSize, MS_SYNC);
+# endif
+}
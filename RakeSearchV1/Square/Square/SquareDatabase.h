@@ -0,0 +1,77 @@
+﻿// База квадратов: файл из упакованных записей фиксированной длины, отображаемый в память, с хеш-индексом
+
+# if !defined SquareDatabase_h
+# define SquareDatabase_h
+
+# include <string>
+# include <vector>
+# include <stdint.h>
+# include "Square.h"
+
+using namespace std;
+
+class SquareDatabase
+{
+public:
+	static const int CellsCount = Square::Rank*Square::Rank;	// Число клеток квадрата
+	static const int RecordSize = (CellsCount + 1) / 2;			// Размер записи квадрата - по полбайта на клетку
+
+	SquareDatabase();								// Конструктор по умолчанию
+	~SquareDatabase();								// Деструктор - закрытие базы
+
+	int Open(string fileName, int isReadOnly);		// Открытие (создание) базы; возвращает 1 в случае успеха
+	void Close();									// Закрытие базы
+	int Add(const Square& value);					// Добавление квадрата в конец базы; возвращает 1, если квадрат новый
+	int Find(const Square& value);					// Поиск квадрата; возвращает его номер или -1
+	int Contains(const Square& value);				// Проверка наличия квадрата в базе
+	void Get(int index, Square& value);				// Получение квадрата по номеру
+	int Size();										// Число квадратов в базе
+	int FrontierStart();							// Номер первого квадрата фронта поиска (курсор фронта)
+	int Level();									// Номер уровня поиска, на котором сохранена база
+	void Commit(int frontierStart, int level);		// Сохранение добавленных квадратов и курсора фронта на диск
+	void Clear();									// Удаление всех квадратов базы
+	void SetStart(const Square& start);				// Запоминание начального квадрата поиска (сохраняется вызовом Commit)
+	int IsStart(const Square& start);				// Проверка того, что база построена от квадрата start
+
+protected:
+private:
+	static const char Signature[8];					// Сигнатура файла базы
+	static const size_t HeaderSize = 64;			// Размер заголовка файла
+	static const int InitialCapacity = 4096;		// Начальная ёмкость файла в записях
+
+	struct Header									// Заголовок файла базы
+	{
+		char Signature[8];							// Сигнатура файла
+		uint32_t Rank;								// Ранг квадратов
+		uint32_t RecordSize;						// Размер записи квадрата
+		uint64_t Count;								// Число сохранённых квадратов (записи за ними не учитываются)
+		uint64_t FrontierStart;						// Номер первого квадрата фронта
+		uint64_t Level;								// Номер уровня поиска
+		uint64_t StartHash[2];						// 128-битный хеш начального квадрата поиска
+		uint8_t Reserved[HeaderSize - 56];			// Резерв
+	};
+
+	static void Pack(const Square& value, uint8_t* record);		// Упаковка квадрата в запись
+	static uint64_t ComputeHash(const uint8_t* record, uint64_t seed = 0x9E3779B97F4A7C15ULL);	// Вычисление хеша записи
+	uint8_t* Record(int index);									// Запись квадрата по номеру
+	Header* FileHeader();										// Заголовок файла
+	int FindSlot(uint64_t hash, const uint8_t* record);			// Поиск ячейки индекса с квадратом или первой пустой ячейки
+	void Index(int index, uint64_t hash);						// Добавление квадрата в индекс
+	void GrowIndex(int indexedCount);							// Увеличение индекса вдвое
+	int Map(size_t size);										// Отображение файла размера size в память (с увеличением файла)
+	void Unmap();												// Отмена отображения файла
+	void Flush();												// Запись изменённых страниц на диск
+
+	int isReadOnly;					// Флаг открытия базы только для чтения
+	int count;						// Число квадратов в базе, включая ещё не сохранённые
+	int capacity;					// Число записей, помещающихся в отображённый файл
+	uint8_t* data;					// Отображённый в память файл
+	size_t mappedSize;				// Размер отображённого файла
+	int fileDescriptor;				// Дескриптор файла (POSIX)
+	void* fileHandle;				// Описатель файла (Windows)
+	void* mappingHandle;			// Описатель отображения файла (Windows)
+	vector<uint64_t> slots;			// Индекс с открытой адресацией: старшие 32 бита хеша и номер квадрата + 1, 0 - пустая ячейка
+	uint64_t slotsMask;				// Маска номера ячейки индекса (размер индекса - степень двойки)
+};
+
+# endif
@@ -0,0 +1,184 @@
+﻿// Множество квадратов с поиском по 128-битному хешу
+
+# include <string.h>
+# include "SquareSet.h"
+
+using namespace std;
+
+// Конструктор по умолчанию
+SquareSet::SquareSet()
+{
+	Clear();
+}
+
+
+// Очистка множества
+void SquareSet::Clear()
+{
+	cells.clear();
+	hashes.clear();
+	slots.assign(1024, 0);
+	slotsMask = slots.size() - 1;
+}
+
+
+// Упаковка квадрата: по байту на клетку
+void SquareSet::Pack(const Square& value, uint8_t* packed)
+{
+	for (int rowId = 0; rowId < Square::Rank; rowId++)
+	{
+		for (int columnId = 0; columnId < Square::Rank; columnId++)
+		{
+			packed[rowId*Square::Rank + columnId] = (uint8_t) value.Matrix[rowId][columnId];
+		}
+	}
+}
+
+
+// Вычисление 128-битного хеша упакованного квадрата: две независимые 64-битные свёртки
+// по 8 байт за шаг с перемешиванием итогового значения
+SquareSet::Hash SquareSet::ComputeHash(const uint8_t* packed)
+{
+	Hash hash;
+	uint64_t low = 0x9E3779B97F4A7C15ULL;
+	uint64_t high = 0xC2B2AE3D27D4EB4FULL;
+
+	for (int offset = 0; offset < CellsCount; offset += 8)
+	{
+		uint64_t word = 0;
+		int length = CellsCount - offset < 8 ? CellsCount - offset : 8;
+
+		memcpy(&word, packed + offset, length);
+		low = (low ^ word) * 0xFF51AFD7ED558CCDULL;
+		low ^= low >> 32;
+		high = (high + word) * 0xC4CEB9FE1A85EC53ULL;
+		high ^= high >> 29;
+	}
+
+	low ^= low >> 33;
+	low *= 0xFF51AFD7ED558CCDULL;
+	low ^= low >> 33;
+	high ^= high >> 31;
+	high *= 0x94D049BB133111EBULL;
+	high ^= high >> 31;
+
+	hash.Low = low;
+	hash.High = high;
+
+return hash;
+}
+
+
+// Поиск ячейки таблицы, в которой лежит квадрат, или пустой ячейки, в которую его можно добавить.
+// Полное сравнение квадратов выполняется только при совпадении обеих половин хеша
+int SquareSet::FindSlot(const Hash& hash, const uint8_t* packed)
+{
+	uint64_t slotId = hash.Low & slotsMask;
+
+	while (slots[slotId] != 0)
+	{
+		int itemId = slots[slotId] - 1;
+
+		if (hashes[itemId].Low == hash.Low && hashes[itemId].High == hash.High
+			&& memcmp(&cells[(size_t) itemId*CellsCount], packed, CellsCount) == 0)
+		{
+			break;
+		}
+
+		slotId = (slotId + 1) & slotsMask;
+	}
+
+return (int) slotId;
+}
+
+
+// Увеличение таблицы вдвое с перераспределением квадратов по сохранённым хешам
+void SquareSet::Grow()
+{
+	slots.assign(slots.size()*2, 0);
+	slotsMask = slots.size() - 1;
+
+	for (int itemId = 0; itemId < (int) hashes.size(); itemId++)
+	{
+		uint64_t slotId = hashes[itemId].Low & slotsMask;
+
+		while (slots[slotId] != 0)
+		{
+			slotId = (slotId + 1) & slotsMask;
+		}
+
+		slots[slotId] = itemId + 1;
+	}
+}
+
+
+// Добавление квадрата в множество
+int SquareSet::Add(const Square& value)
+{
+	uint8_t packed[CellsCount];
+	Hash hash;
+	int slotId;
+
+	Pack(value, packed);
+	hash = ComputeHash(packed);
+	slotId = FindSlot(hash, packed);
+
+	if (slots[slotId] != 0)
+	{
+		return 0;
+	}
+
+	cells.insert(cells.end(), packed, packed + CellsCount);
+	hashes.push_back(hash);
+	slots[slotId] = (int) hashes.size();
+
+	// Заполнение таблицы не более чем наполовину
+	if (hashes.size()*2 > slots.size())
+	{
+		Grow();
+	}
+
+return 1;
+}
+
+
+// Поиск квадрата в множестве
+int SquareSet::Find(const Square& value)
+{
+	uint8_t packed[CellsCount];
+	Hash hash;
+
+	Pack(value, packed);
+	hash = ComputeHash(packed);
+
+return slots[FindSlot(hash, packed)] - 1;
+}
+
+
+// Проверка наличия квадрата в множестве
+int SquareSet::Contains(const Square& value)
+{
+	return Find(value) >= 0;
+}
+
+
+// Получение квадрата по номеру в порядке добавления
+void SquareSet::Get(int index, Square& value)
+{
+	const uint8_t* packed = &cells[(size_t) index*CellsCount];
+
+	for (int rowId = 0; rowId < Square::Rank; rowId++)
+	{
+		for (int columnId = 0; columnId < Square::Rank; columnId++)
+		{
+			value.Matrix[rowId][columnId] = packed[rowId*Square::Rank + columnId];
+		}
+	}
+}
+
+
+// Число квадратов в множестве
+int SquareSet::Size()
+{
+	return (int) hashes.size();
+}
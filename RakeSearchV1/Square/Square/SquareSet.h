@@ -0,0 +1,45 @@
+﻿// Множество квадратов с поиском по 128-битному хешу
+
+# if !defined SquareSet_h
+# define SquareSet_h
+
+# include <vector>
+# include <stdint.h>
+# include "Square.h"
+
+using namespace std;
+
+class SquareSet
+{
+public:
+	static const int CellsCount = Square::Rank*Square::Rank;	// Число клеток квадрата (байт в упакованном квадрате)
+
+	SquareSet();									// Конструктор по умолчанию
+
+	int Add(const Square& value);					// Добавление квадрата в множество; возвращает 1, если квадрат новый
+	int Find(const Square& value);					// Поиск квадрата; возвращает его номер в порядке добавления или -1
+	int Contains(const Square& value);				// Проверка наличия квадрата в множестве
+	void Get(int index, Square& value);				// Получение квадрата по номеру в порядке добавления
+	int Size();										// Число квадратов в множестве
+	void Clear();									// Очистка множества
+
+protected:
+private:
+	struct Hash										// 128-битный хеш упакованного квадрата
+	{
+		uint64_t Low;
+		uint64_t High;
+	};
+
+	static void Pack(const Square& value, uint8_t* packed);		// Упаковка квадрата - по байту на клетку
+	static Hash ComputeHash(const uint8_t* packed);				// Вычисление хеша упакованного квадрата
+	int FindSlot(const Hash& hash, const uint8_t* packed);		// Поиск ячейки таблицы с квадратом или первой пустой ячейки
+	void Grow();												// Увеличение таблицы вдвое
+
+	vector<uint8_t> cells;		// Упакованные квадраты в порядке добавления
+	vector<Hash> hashes;		// Хеши квадратов в порядке добавления
+	vector<int> slots;			// Таблица с открытой адресацией: номер квадрата + 1, 0 - пустая ячейка
+	uint64_t slotsMask;			// Маска номера ячейки (размер таблицы - степень двойки)
+};
+
+# endif
@@ -1,7 +1,9 @@
 # include <iostream>
 # include <fstream>
 # include "Square.h"
-# include "DLX_DLS.h"
+# include "SquareSet.h"
+# include "GraphSearch.h"
+# include "GraphEdges.h"
 
 using namespace std;
 
@@ -12,32 +14,30 @@ int main(int argsCount, char* argsValues[])
 	string startFileName = "start_square.txt";		// Имя файла с начальным квадратов
 	string setFileName = "squares_set.txt";			// Имя файла с набором найденных квадратов
 	string edgesFileName = "squares_edges.txt";		// Имя файла с перечнем рёбер графа из ОДЛК
+	string binaryEdgesFileName;						// Имя файла с рёбрами графа в двоичном виде (пары 32-битных номеров)
 	string totalsFileName = "graph_totals.txt";		// Имя файла с характеристиками графа из ОДЛК
 	string checkListFileName = "check_list.txt";	// Имя файла с проверочным списком квадратов
+	string databaseFileName = "squares_database.bin";	// Имя файла базы найденных квадратов
 	int checkListSize = 0;							// Размер проверочного списка квадратов
+	int threadsCount = 1;							// Число потоков поиска ОДЛК
+	int isResumed = 0;								// Флаг продолжения поиска по базе квадратов
 
 	fstream startFile;								// Файл с начальным квадратом
 	fstream setFile;								// Файл с набором найденных квадратов
 	fstream edgesFile;								// Файл с перечнем рёбер графа из ОДЛК
+	fstream binaryEdgesFile;						// Файл с рёбрами графа в двоичном виде
 	fstream totalsFile;								// Файл с характеристиками графа из ОДЛК
 	fstream checkListFile;							// Файл с проверочным списком квадратов
 
-	orth_mate_search finder;				// Искатель ОДЛК
+	GraphSearch graphSearch;				// Искатель графа из ОДЛК
+	GraphEdges graphEdges;					// Построитель рёбер графа из ОДЛК
 
-	const int FullOrthoDegree = Square::Rank*Square::Rank;	// Степерь ортогональности, соответствующая ортогональным квадратам
-
-	vector<Square> checkList;				// Список квадратов на соответствие с которым проверяются найденные
-	vector<vector<int>> startSquareVector;	// Квадрат, с которого начинается поиск
-	vector<vector<vector<int>>> result;		// Результат поиска
-	vector<Square> squaresSet;				// Множество найденных квадратов
-	vector<Square> iterationSet;			// Множество квадратов, найденных в рамках итерации
-	vector<Square> currentSet;				// Множество квадратов, обрабатываемых в рамках текущей итерации
-	Square newSquare;						// Квадрат, добавляемый в множество
+	SquareSet checkList;					// Список квадратов на соответствие с которым проверяются найденные
+	SquareDatabase& squaresSet = graphSearch.Squares();	// База найденных квадратов
+	Square newSquare;						// Квадрат, записываемый в файл
 	Square checkSquare;						// Квадрат, добавляемый в список проверки
-	int isNewSquare = 0;					// Флаг нового квадрата
 	int isTheGraph = 0;						// Флаг нахождения квадрата из The Graph
-	int newSquaresInIteration = 0;			// Число новых квадратов, найденных в рамках очередной итерации
-	int edgesCount = 0;						// Число рёбер в графе из ОДЛК
+	long long edgesCount = 0;				// Число рёбер в графе из ОДЛК
 
 	// Переменные для разбора параметров
 	string argument;							// Название обрабатываемого аргумента
@@ -46,9 +46,13 @@ int main(int argsCount, char* argsValues[])
 	string startFileParamName = "--start";		// Название параметра "Файл с начальным квадратом"
 	string setFileParamName = "--set";			// Название параметра "Файл с набором найденных квадратов"
 	string edgesFileParamName = "--edges";		// Название параметра "Файл с рёбрами графа"
+	string binaryEdgesFileParamName = "--binary_edges";	// Название параметра "Файл с рёбрами графа в двоичном виде"
 	string totalsFileParamName = "--totals";	// Название параметра "Файл с характеристиками графа"
 	string checkListParamName = "--check_list";	// Название параметра "Проверочный список квадратов" (для определения того, что столкнулись с The Graph)
 	string checkListSizeParamName = "--check_list_size";	// Название параметра "Длина проверочного списка"
+	string threadsParamName = "--threads";		// Название параметра "Число потоков поиска"
+	string databaseParamName = "--database";	// Название параметра "Файл базы найденных квадратов"
+	string resumeParamName = "--resume";		// Название параметра "Продолжение поиска по базе квадратов" (без значения)
 	string delimiter = "=";						// Разделитель имени параметра и его значения в аргументе программы
 	size_t delimiterPosition = -1;              // Позиция разделителя имени параметра и его значения в аргументе
 	std::string::size_type size;
@@ -85,6 +89,11 @@ int main(int argsCount, char* argsValues[])
 					edgesFileName = paramValue;
 				}
 
+				if (paramName == binaryEdgesFileParamName)
+				{
+					binaryEdgesFileName = paramValue;
+				}
+
 				if (paramName == totalsFileParamName)
 				{
 					totalsFileName = paramValue;
@@ -99,6 +108,21 @@ int main(int argsCount, char* argsValues[])
 				{
 					checkListSize =std::stoi(paramValue, nullptr);
 				}
+
+				if (paramName == threadsParamName)
+				{
+					threadsCount = std::stoi(paramValue, nullptr);
+				}
+
+				if (paramName == databaseParamName)
+				{
+					databaseFileName = paramValue;
+				}
+
+				if (argument == resumeParamName)
+				{
+					isResumed = 1;
+				}
 		}
 	}
 
@@ -106,8 +130,15 @@ int main(int argsCount, char* argsValues[])
 	cout << "Start square file name: " << startFileName << endl;
 	cout << "Squares set file name: " << setFileName << endl;
 	cout << "Graph edges file name: " << edgesFileName << endl;
+	if (!binaryEdgesFileName.empty())
+	{
+		cout << "Binary graph edges file name: " << binaryEdgesFileName << endl;
+	}
 	cout << "Totals file name: " << totalsFileName << endl;
 	cout << "Check list file name: " << checkListFileName << endl;
+	cout << "Squares database file name: " << databaseFileName << endl;
+	cout << "Resume search from database: " << (isResumed ? "yes" : "no") << endl;
+	cout << "Search threads: " << threadsCount << endl;
 
 	// Считывание квадратов из списка проверки
 	checkListFile.open(checkListFileName, std::ios_base::in);
@@ -117,7 +148,7 @@ int main(int argsCount, char* argsValues[])
 		for (int i = 0; i < checkListSize; i++)
 		{
 			checkListFile >> checkSquare;
-			checkList.push_back(checkSquare);
+			checkList.Add(checkSquare);
 		}
 	}
 
@@ -131,83 +162,13 @@ int main(int argsCount, char* argsValues[])
 
 	startFile.close();
 
-	// Поиск структуры из ортогональных квадратов, начинающейся с заданного
-
-		// Добавляем первый квадрат в множество
-		squaresSet.clear();
-		squaresSet.push_back(startSquare);
-		currentSet.clear();
-		currentSet.push_back(startSquare);
-
-		// Поиск новых квадратов, ортогональных к известному и ортогональных ему и т.д.
-		cout << "Starting to search an orthogonal squares ..." << endl;
-
-		do
-		{
-			iterationSet.clear();
-			newSquaresInIteration = 0;
-
-			// Поиск квадратов, ортогональных квадратам, обнаруженным ранее множества
-			for (int squareId = 0; squareId < currentSet.size(); squareId++)
-			{
-				startSquareVector << currentSet[squareId];
-				result.clear();
-				finder.check_dlx_rc1(startSquareVector, result);
-	
-				for (int resultItemId = 0; resultItemId < result.size(); resultItemId++)
-				{
-					result[resultItemId] >> newSquare;
-					iterationSet.push_back(newSquare);
-				}
-			}
-
-			// Очистка рабочего множества
-			currentSet.clear();
-
-			// Проверка найденных квадратов на нахождение в проверочном списке
-			for (int i = 0; i < iterationSet.size() && !isTheGraph; i++)
-			{
-				for (int j = 0; j < checkListSize && !isTheGraph; j++)
-				{
-					if (iterationSet[i] == checkList[j])
-					{
-						isTheGraph = 1;
-					}
-				}
-			}
-
-			// Проверка найденных квадратов на уникальность и добавление новых квадратов в основное и рабочее множество
-			if (!isTheGraph)
-			{
-				for (int i = 0; i < iterationSet.size(); i++)
-				{
-					isNewSquare = 1;
-
-					for (int j = 0; j < squaresSet.size() && isNewSquare; j++)
-					{
-						if (squaresSet[j] == iterationSet[i])
-						{
-							isNewSquare = 0;
-						}
-					}
-
-					if (isNewSquare)
-					{
-						squaresSet.push_back(iterationSet[i]);
-						currentSet.push_back(iterationSet[i]);
-						newSquaresInIteration++;
-					}
-				}
+	// Поиск структуры из ортогональных квадратов, начинающейся с заданного (или продолжение поиска по базе квадратов)
+	if (!graphSearch.Initialize(startSquare, databaseFileName, threadsCount, isResumed))
+	{
+		return 1;
+	}
 
-				cout << "Found " << newSquaresInIteration << " new squares " << endl;
-				cout << "Total squares: " << squaresSet.size() << endl;
-			}
-			else
-			{
-				cout << "Found The Graph! Exit." << endl;
-			}
-		}
-		while (newSquaresInIteration > 0 && !isTheGraph);
+	isTheGraph = graphSearch.Start(checkList);
 
 	// Обработка найденного графа
 	if (!isTheGraph)
@@ -219,9 +180,10 @@ int main(int argsCount, char* argsValues[])
 
 		if (setFile.is_open())
 		{
-			for (int i = 0; i < squaresSet.size(); i++)
+			for (int i = 0; i < squaresSet.Size(); i++)
 			{
-				setFile << squaresSet[i];
+				squaresSet.Get(i, newSquare);
+				setFile << newSquare;
 			}
 		}
 
@@ -235,33 +197,23 @@ int main(int argsCount, char* argsValues[])
 			edgesFile.open(edgesFileName, std::ios_base::out);
 			edgesFile << "IdA;IdB" << endl;
 
-			// Проверка ортогональности ДЛК
-			for (int i = 0; i < squaresSet.size(); i++)
+			// Открытие файла для записи рёбер графа в двоичном виде
+			if (!binaryEdgesFileName.empty())
 			{
-				// Поиск квадратов ортогональных i-му квадрату
-				for (int j = i + 1; j < squaresSet.size(); j++)
-				{
-					// Проверка ортогональности i-го и j-го квадрата
-					if (Square::OrthoDegree(squaresSet[i], squaresSet[j]) == FullOrthoDegree)
-					{
-						edgesCount++;
-						edgesFile << i << ";" << j << endl;
-
-						if (edgesCount % 1000 == 0)
-						{
-							cout << "Reach " << edgesCount << " edges" << endl;
-						}
-					}
-				}
+				binaryEdgesFile.open(binaryEdgesFileName, std::ios_base::out | std::ios_base::binary);
 			}
 
+			// Проверка ортогональности ДЛК
+			edgesCount = graphEdges.Build(squaresSet, threadsCount, edgesFile, binaryEdgesFile.is_open() ? &binaryEdgesFile : NULL);
+
 		// Закрытие файла, хранящего рёбра графа
 		edgesFile.close();
+		binaryEdgesFile.close();
 
 		// Завершение работы
 			// Вывод итогов на экран
 			cout << "--------------------------------" << endl;
-			cout << "Total squares in graph: " << squaresSet.size() << endl;
+			cout << "Total squares in graph: " << squaresSet.Size() << endl;
 			cout << "Total edges count: " << edgesCount << endl;
 
 			// Сохранение итогов в файл
@@ -269,7 +221,7 @@ int main(int argsCount, char* argsValues[])
 
 			if (totalsFile.is_open())
 			{
-				totalsFile << "Total squares in graph: " << squaresSet.size() << endl;
+				totalsFile << "Total squares in graph: " << squaresSet.Size() << endl;
 				totalsFile << "Total edges count: " << edgesCount << endl;
 			}
 
@@ -3,6 +3,10 @@
 #include "RakeSearch.h"
 #include <string.h>
 #include <type_traits>
+#include <algorithm>
+#include <thread>
+#include <atomic>
+#include <memory>
 
 #ifdef HAS_SIMD
 #ifdef __SSE2__
@@ -17,7 +21,8 @@
 #define SetBit(bitfield, bitno) ((bitfield) |= (1u << (bitno)))
 #define ClearBit(bitfield, bitno) ((bitfield) &= ~(1u << (bitno)))
 
-#define AllBitsMask(numbits) ((1u << (numbits)) - 1)
+// Note: shift by 32 is undefined, so shift all-ones mask right instead
+#define AllBitsMask(numbits) (~0u >> (32 - (numbits)))
 
 // Used = 0, Free = 1, Code now uses bits, so dedicated macros would be helpful.
 #define SetUsed(bitfield, bitno) ClearBit(bitfield, bitno)
@@ -35,14 +40,43 @@
 // so sign check instead of value check can give faster code.
 #define IsCellEmpty(val) ((val) < 0)
 
+#if defined(__SSE2__) && defined(HAS_SIMD)
+// Load 8 consecutive 32-bit masks and pack them into one vector of 16-bit masks
+template <int Rank> static inline __m128i LoadMasks8(const int* p)
+{
+#if defined(__AVX512F__) && defined(__AVX512VL__)
+    // AVX512VL can truncate 32-bit lanes to 16 bits directly
+    return _mm256_cvtepi32_epi16(_mm256_loadu_si256((const __m256i*)p));
+#else
+    __m128i v1 = _mm_loadu_si128((const __m128i*)p);
+    __m128i v2 = _mm_loadu_si128((const __m128i*)(p + 4));
+#ifdef __SSE4_1__
+    // Masks are at most 0x8000, so unsigned saturation keeps them unchanged
+    return _mm_packus_epi32(v1, v2);
+#else
+    // _mm_packs_epi32 uses signed saturation, so for Rank 16 mask 0x8000 is sign-extended
+    // first to get it through unchanged.
+    if (Rank > 15)
+    {
+        v1 = _mm_srai_epi32(_mm_slli_epi32(v1, 16), 16);
+        v2 = _mm_srai_epi32(_mm_slli_epi32(v2, 16), 16);
+    }
+    return _mm_packs_epi32(v1, v2);
+#endif
+#endif
+}
+#endif
+
 // Конструктор по умолчанию
-RakeSearch::RakeSearch()
+template <int RankT> RakeSearch<RankT>::RakeSearch()
 {
     Reset();
 }
 
 // Задание имен файлов параметров и контрольной точки
-void RakeSearch::SetFileNames(const string& start, const string& result, const string& checkpoint, const string& temp)
+template <int RankT>
+void RakeSearch<RankT>::SetFileNames(const string& start, const string& result, const string& checkpoint,
+                                     const string& temp)
 {
     startParametersFileName = start;
     resultFileName = result;
@@ -51,15 +85,15 @@ void RakeSearch::SetFileNames(const string& start, const string& result, const s
 }
 
 // Сброс значений внутренних структур
-void RakeSearch::Reset()
+template <int RankT> void RakeSearch<RankT>::Reset()
 {
     // Очистка матриц квадратов
     for (int i = 0; i < Rank; i++)
     {
         for (int j = 0; j < Rank; j++)
         {
-            squareA[i][j] = Square::Empty;
-            squareB[i][j] = Square::Empty;
+            squareA[i][j] = Square<Rank>::Empty;
+            squareB[i][j] = Square<Rank>::Empty;
         }
     }
 
@@ -70,15 +104,16 @@ void RakeSearch::Reset()
 
     // Сброс значений структур генерации квадратов
     // Сброс значений, соответствующих ключевой клетке
-    keyRowId = Square::Empty;
-    keyColumnId = Square::Empty;
-    keyValue = Square::Empty;
+    keyRowId = Square<Rank>::Empty;
+    keyColumnId = Square<Rank>::Empty;
+    keyValue = Square<Rank>::Empty;
 
     // Сброс значений, связанных с путём заполнения клеток
+    cellsInPath = 0;
     for (int i = 0; i < MaxCellsInPath; i++)
     {
-        path[i][0] = Square::Empty;
-        path[i][1] = Square::Empty;
+        path[i][0] = Square<Rank>::Empty;
+        path[i][1] = Square<Rank>::Empty;
     }
 
     // Сброс значений в векторах использования элементов на диагонали
@@ -100,10 +135,11 @@ void RakeSearch::Reset()
             flagsCellsHistory[i][j] = AllFree;
         }
     }
+    SetupPathCells();
 
     // Сброс координат обрабатываемой клетки
-    rowId = Square::Empty;
-    columnId = Square::Empty;
+    rowId = Square<Rank>::Empty;
+    columnId = Square<Rank>::Empty;
 
     // Сброс названий файлов
     checkpointFileName.clear();
@@ -121,6 +157,12 @@ void RakeSearch::Reset()
     totalPairsCount = 0;
     totalSquaresWithPairs = 0;
 
+    // Reset range of path prefixes, by default whole workunit is processed
+    prefixRangeStart = 0;
+    prefixRangeEnd = -1;
+
+    forcedCellsCount = 0;
+
     // Задание имён входных файлов
     startParametersFileName = "start_parameters.txt";
     resultFileName = "result.txt";
@@ -129,13 +171,18 @@ void RakeSearch::Reset()
 
     // Задание константы - заголовка в файле параметров или контрольной точке
     workunitHeader = "# RakeSearch of diagonal Latin squares";
+    prefixRangeHeader = "# Path prefix range";
+
+    donationFileName = "donate.txt";
 
     // Сброс флага инициализации
     isInitialized = 0;
 }
 
 // Инициализация поиска
-void RakeSearch::Initialize(const string& start, const string& result, const string& checkpoint, const string& temp)
+template <int RankT>
+void RakeSearch<RankT>::Initialize(const string& start, const string& result, const string& checkpoint,
+                                   const string& temp)
 {
     ifstream startFile;
     ifstream checkpointFile;
@@ -153,7 +200,10 @@ void RakeSearch::Initialize(const string& start, const string& result, const str
 
     Read(startFile);
     array<int, MaxPathPrefixes> tmpPrefixes;
+    pathPrefixes.clear();
     GeneratePathPrefixes(tmpPrefixes, 0);
+    // Read() looks for optional data at the end of file, so EOF flag may be set here
+    startFile.clear();
     startFile.seekg(0);
 
     // Считывание состояния из файла контрольной точки
@@ -187,9 +237,416 @@ void RakeSearch::Initialize(const string& start, const string& result, const str
     // Закрытие файлов
     startFile.close();
     checkpointFile.close();
+
+    SetupPathPrefixRange();
+}
+
+// Flag set by RequestWorkDonation(). It is shared by all ranks, so signal handler does not need to know rank.
+static volatile sig_atomic_t isDonationRequested = 0;
+
+// Request donation of the rest of workunit. Only sets a flag, so it is safe to call it from signal handler.
+void RequestWorkDonation()
+{
+    isDonationRequested = 1;
+}
+
+// Split workunit into parts with ranges of path prefixes
+template <int RankT> void RakeSearch<RankT>::SplitWorkunit(const string& start, int parts, const string& partPrefix)
+{
+    LoadWorkunit(start);
+
+    int rangeEnd = prefixRangeEnd < 0 ? (int)pathPrefixes.size() : prefixRangeEnd;
+    WriteWorkunitParts(prefixRangeStart, rangeEnd, parts, partPrefix);
+}
+
+// Read workunit and generate its path prefixes
+template <int RankT> void RakeSearch<RankT>::LoadWorkunit(const string& start)
+{
+    ifstream startFile;
+
+    startFile.open(start.c_str(), std::ios_base::in);
+    if (!startFile.is_open())
+    {
+        throw("Cannot open workunit file.");
+    }
+
+    Read(startFile);
+    startFile.close();
+
+    array<int, MaxPathPrefixes> tmpPrefixes;
+    pathPrefixes.clear();
+    GeneratePathPrefixes(tmpPrefixes, 0);
+
+    if (cellId != 0)
+    {
+        throw("Only workunit with initial state can be used.");
+    }
+}
+
+// Write workunit parts for given range of path prefixes
+template <int RankT>
+void RakeSearch<RankT>::WriteWorkunitParts(int rangeStart, int rangeEnd, int parts, const string& partPrefix)
+{
+    int rangeSize = rangeEnd - rangeStart;
+
+    if (parts < 1)
+    {
+        throw("Invalid number of workunit parts.");
+    }
+    if (parts > rangeSize)
+    {
+        parts = rangeSize;
+    }
+
+    // Path prefixes are split evenly, remainder goes to first parts
+    for (int n = 0; n < parts; n++)
+    {
+        ofstream partFile;
+        string partFileName = partPrefix + "_" + std::to_string(n + 1) + ".txt";
+
+        prefixRangeStart = rangeStart + (int)((long long)rangeSize * n / parts);
+        prefixRangeEnd = rangeStart + (int)((long long)rangeSize * (n + 1) / parts);
+
+        partFile.open(partFileName.c_str(), std::ios_base::out);
+        if (!partFile.is_open())
+        {
+            throw("Cannot create workunit part file.");
+        }
+        Write(partFile);
+        partFile.close();
+
+        if (isDebug)
+        {
+            cout << "# " << partFileName << ": path prefixes " << prefixRangeStart << " - " << prefixRangeEnd << endl;
+        }
+    }
+}
+
+// Get number of parts to donate, or 0 when donation was not requested
+template <int RankT> int RakeSearch<RankT>::CheckWorkDonationRequest()
+{
+    int parts = 0;
+    ifstream donationFile;
+
+    if (isDonationRequested)
+    {
+        isDonationRequested = 0;
+        parts = DefaultDonationParts;
+    }
+
+    // Donation file may contain number of parts
+    donationFile.open(donationFileName.c_str(), std::ios_base::in);
+    if (donationFile.is_open())
+    {
+        if (!(donationFile >> parts) || (parts < 1))
+        {
+            parts = DefaultDonationParts;
+        }
+        donationFile.close();
+        remove(donationFileName.c_str());
+    }
+
+    return parts;
+}
+
+// Write path prefixes after the current one into new workunits, and limit search to the current prefix.
+// Each workunit is a copy of the original one with own range of path prefixes.
+template <int RankT> void RakeSearch<RankT>::DonateWork(int parts)
+{
+    if (!IsCellEmpty(keyValue) || (cellsInPath <= MaxPathPrefixes))
+    {
+        cerr << "Work donation is not supported by this workunit." << endl;
+        return;
+    }
+
+    // pathPrefixPos points to the prefix of the current square, it was updated just before this call
+    int donationStart = pathPrefixPos + 1;
+    int donationEnd = prefixRangeEnd < 0 ? (int)pathPrefixes.size() : prefixRangeEnd;
+
+    if (donationStart >= donationEnd)
+    {
+        cerr << "No work left to donate." << endl;
+        return;
+    }
+
+    try
+    {
+        // Donor is allocated on heap: the second search object does not fit into the stack at big ranks
+        unique_ptr<RakeSearch> donor(new RakeSearch);
+        donor->LoadWorkunit(startParametersFileName);
+        string partPrefix = "donated_" + std::to_string(donationStart) + "_part";
+        donor->WriteWorkunitParts(donationStart, donationEnd, parts, partPrefix);
+    }
+    catch (const char* str)
+    {
+        cerr << "Error donating work: " << str << endl;
+        return;
+    }
+
+    // Stop search when the first donated prefix is reached
+    prefixRangeEnd = donationStart;
+
+    CreateCheckpoint();
+    boinc_checkpoint_completed();
+}
+
+// Count squares of workunit for every path prefix. Orthogonal squares are not searched, so counting
+// is much faster than processing of workunit. Path prefixes are distributed between threads.
+template <int RankT> void RakeSearch<RankT>::CountSquares(const string& start, int threads)
+{
+    LoadWorkunit(start);
+
+    // Counting stops at the end of every path prefix, so it cannot be limited by key value
+    if ((cellsInPath <= MaxPathPrefixes) || !IsCellEmpty(keyValue))
+    {
+        throw("Counting of squares is not supported by this workunit.");
+    }
+
+    int rangeStart = prefixRangeStart;
+    int rangeEnd = prefixRangeEnd < 0 ? (int)pathPrefixes.size() : prefixRangeEnd;
+    if ((rangeStart < 0) || (rangeEnd > (int)pathPrefixes.size()) || (rangeEnd < rangeStart))
+    {
+        throw("Invalid path prefix range.");
+    }
+
+    vector<unsigned long long> counts(rangeEnd - rangeStart, 0);
+    std::atomic<int> nextPrefix(rangeStart);
+
+    // Every thread counts squares by its own copy of workunit, allocated on heap as it is too big for
+    // the stack of worker thread
+    auto countPrefixes = [&]()
+    {
+        unique_ptr<RakeSearch> counter(new RakeSearch);
+        counter->LoadWorkunit(start);
+        counter->SetupForcedCells();
+
+        int prefixId;
+        while ((prefixId = nextPrefix++) < rangeEnd)
+        {
+            counts[prefixId - rangeStart] = counter->CountPathPrefix(prefixId);
+        }
+    };
+
+    if (threads < 1)
+    {
+        threads = 1;
+    }
+    vector<std::thread> workers;
+    for (int i = 1; i < threads; i++)
+    {
+        workers.emplace_back(countPrefixes);
+    }
+    countPrefixes();
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+
+    // Counts are written in order of path prefixes: number of prefix, values of its cells and number of squares
+    unsigned long long totalCount = 0;
+    cout << "# Squares per path prefix" << endl;
+    for (int prefixId = rangeStart; prefixId < rangeEnd; prefixId++)
+    {
+        cout << prefixId;
+        for (int n = 0; n < MaxPathPrefixes; n++)
+        {
+            cout << " " << pathPrefixes[prefixId][n];
+        }
+        cout << " " << counts[prefixId - rangeStart] << endl;
+        totalCount += counts[prefixId - rangeStart];
+    }
+    cout << "# ------------------------" << endl;
+    cout << "# Path prefixes: " << rangeStart << " - " << rangeEnd << endl;
+    cout << "# Total squares: " << totalCount << endl;
+    cout << "# ------------------------" << endl;
+}
+
+// Find the longest tail of path in one row or column. When all other cells are filled, each column
+// (row) of tail cells misses exactly one value, and these values are exactly the free values of their row
+// (column). So values of tail cells are forced, and candidates of the last cell before tail give squares.
+template <int RankT> void RakeSearch<RankT>::SetupForcedCells()
+{
+    int rowCells = 0;
+    int columnCells = 0;
+
+    while ((rowCells < cellsInPath) && (path[cellsInPath - 1 - rowCells][0] == path[cellsInPath - 1][0]))
+    {
+        rowCells++;
+    }
+    while ((columnCells < cellsInPath) && (path[cellsInPath - 1 - columnCells][1] == path[cellsInPath - 1][1]))
+    {
+        columnCells++;
+    }
+
+    // Cells of path prefix must stay in the path
+    forcedCellsCount = std::max(rowCells, columnCells);
+    forcedCellsCount = std::min(forcedCellsCount, cellsInPath - MaxPathPrefixes - 1);
+}
+
+// Count squares with given path prefix, workunit must be in initial state
+template <int RankT> unsigned long long RakeSearch<RankT>::CountPathPrefix(int prefixId)
+{
+    ValueMask initialColumns[Rank];
+    ValueMask initialRows[Rank];
+
+    memcpy(initialColumns, flagsColumns, sizeof(flagsColumns));
+    memcpy(initialRows, flagsRows, sizeof(flagsRows));
+
+    squaresCount = 0;
+    ApplyPathPrefix(prefixId);
+
+    // Counting stops when the next path prefix is reached, the last prefix is counted to the end of workunit
+    if (prefixId + 1 < (int)pathPrefixes.size())
+    {
+        prefixRangeEnd = prefixId + 1;
+        StartImpl<true_type, true_type, true_type>();
+    }
+    else
+    {
+        prefixRangeEnd = -1;
+        StartImpl<true_type, false_type, true_type>();
+    }
+
+    // Return to initial state, values of cells after path prefix are rewritten before use
+    memcpy(flagsColumns, initialColumns, sizeof(flagsColumns));
+    memcpy(flagsRows, initialRows, sizeof(flagsRows));
+    cellId = 0;
+
+    return squaresCount;
+}
+
+// Check range of path prefixes and move to its start if needed
+template <int RankT> void RakeSearch<RankT>::SetupPathPrefixRange()
+{
+    const int prefixesCount = (int)pathPrefixes.size();
+
+    if ((0 == prefixRangeStart) && (prefixRangeEnd < 0))
+    {
+        return;
+    }
+
+    if ((prefixRangeStart < 0) || (prefixRangeStart > prefixesCount) || (prefixRangeEnd > prefixesCount) ||
+        ((prefixRangeEnd >= 0) && (prefixRangeEnd < prefixRangeStart)))
+    {
+        throw("Invalid path prefix range.");
+    }
+
+    // Search must stop when all prefixes are processed, it cannot be limited by key value
+    if ((cellsInPath <= MaxPathPrefixes) || !IsCellEmpty(keyValue))
+    {
+        throw("Path prefix range is not supported by this workunit.");
+    }
+
+    if (prefixRangeEnd == prefixesCount)
+    {
+        prefixRangeEnd = -1;
+    }
+
+    pathPrefixPos = prefixRangeStart;
+
+    // Checkpoint already contains state inside of the range
+    if (!isStartFromCheckpoint && (prefixRangeStart > 0) && (prefixRangeStart < prefixesCount))
+    {
+        if (cellId != 0)
+        {
+            throw("Path prefix range requires workunit with initial state.");
+        }
+        ApplyPathPrefix(prefixRangeStart);
+    }
+}
+
+// Fill first path cells with values from given path prefix. History of every cell keeps
+// remaining candidates greater than selected value, like it would be done by StartImpl.
+template <int RankT> void RakeSearch<RankT>::ApplyPathPrefix(int prefixId)
+{
+    const auto& prefix = pathPrefixes[prefixId];
+
+    for (int n = 0; n < MaxPathPrefixes; n++)
+    {
+        int r = path[n][0];
+        int c = path[n][1];
+        unsigned int bit = 1u << prefix[n];
+        unsigned int candidates = flagsColumns[c] & flagsRows[r];
+
+        squareA[r][c] = prefix[n];
+        SetUsed(flagsColumns[c], prefix[n]);
+        SetUsed(flagsRows[r], prefix[n]);
+        pathHistory[n] = candidates & ~(bit | (bit - 1));
+    }
+
+    cellId = MaxPathPrefixes;
+}
+
+// Check if values in first path cells are equal to or greater than given path prefix
+template <int RankT> bool RakeSearch<RankT>::IsPathPrefixReached(int prefixId) const
+{
+    const auto& prefix = pathPrefixes[prefixId];
+
+    for (int n = 0; n < MaxPathPrefixes; n++)
+    {
+        int value = squareA[path[n][0]][path[n][1]];
+        if (value != prefix[n])
+        {
+            return value > prefix[n];
+        }
+    }
+
+    return true;
+}
+
+// Check that square matches preset cells of loaded workunit and its path prefix is in range of workunit.
+// Path prefixes are generated in lexicographic order, so prefix of square is found by binary search.
+// Prefix must be one of generated ones, so values excluded by history of first path cells are rejected too.
+template <int RankT> bool RakeSearch<RankT>::IsSquareOfWorkunit(const Square<Rank>& square) const
+{
+    for (int r = 0; r < Rank; r++)
+    {
+        for (int c = 0; c < Rank; c++)
+        {
+            if (!IsCellEmpty(squareA[r][c]) && (squareA[r][c] != square.Matrix[r][c]))
+            {
+                return false;
+            }
+        }
+    }
+
+    // Prefix range is not supported by such workunits, whole workunit is processed
+    if (cellsInPath <= MaxPathPrefixes)
+    {
+        return true;
+    }
+
+    array<int, MaxPathPrefixes> prefix;
+    for (int n = 0; n < MaxPathPrefixes; n++)
+    {
+        prefix[n] = square.Matrix[path[n][0]][path[n][1]];
+    }
+
+    int rangeEnd = prefixRangeEnd < 0 ? (int)pathPrefixes.size() : std::min(prefixRangeEnd, (int)pathPrefixes.size());
+    int rangeStart = std::min(std::max(prefixRangeStart, 0), rangeEnd);
+    auto it = std::lower_bound(pathPrefixes.begin() + rangeStart, pathPrefixes.begin() + rangeEnd, prefix);
+
+    return (it != pathPrefixes.begin() + rangeEnd) && (*it == prefix);
+}
+
+// Values of path cells are tried in ascending order, so squares are generated in lexicographic order
+// of values of their path cells
+template <int RankT> bool RakeSearch<RankT>::IsBeforeInPath(const Square<Rank>& a, const Square<Rank>& b) const
+{
+    for (int n = 0; n < cellsInPath; n++)
+    {
+        int valueA = a.Matrix[path[n][0]][path[n][1]];
+        int valueB = b.Matrix[path[n][0]][path[n][1]];
+        if (valueA != valueB)
+        {
+            return valueA < valueB;
+        }
+    }
+
+    return false;
 }
 
-void RakeSearch::GeneratePathPrefixes(array<int, MaxPathPrefixes>& tmp, int pathPos)
+template <int RankT> void RakeSearch<RankT>::GeneratePathPrefixes(array<int, MaxPathPrefixes>& tmp, int pathPos)
 {
     if (MaxPathPrefixes == pathPos)
     {
@@ -200,20 +657,20 @@ void RakeSearch::GeneratePathPrefixes(array<int, MaxPathPrefixes>& tmp, int path
         int r = path[pathPos][0];
         int c = path[pathPos][1];
 
-        int rh = flagsRows[r];
-        int ch = flagsColumns[c];
-        int hh = flagsCellsHistory[r][c];
+        unsigned int rh = flagsRows[r];
+        unsigned int ch = flagsColumns[c];
+        unsigned int hh = pathHistory[pathPos];
 
-        int freeVals = rh & ch & hh;
+        unsigned int freeVals = rh & ch & hh;
 
         for (int n = 0; n < Rank; ++n)
         {
-            int m = 1 << n;
+            unsigned int m = 1u << n;
             if (0 != (freeVals & m))
             {
                 flagsRows[r] &= ~m;
                 flagsColumns[c] &= ~m;
-                flagsCellsHistory[r][c] &= ~m;
+                pathHistory[pathPos] &= ~m;
 
                 tmp[pathPos] = __builtin_ctz(m);
 
@@ -226,17 +683,37 @@ void RakeSearch::GeneratePathPrefixes(array<int, MaxPathPrefixes>& tmp, int path
 
         flagsRows[r] = rh;
         flagsColumns[c] = ch;
-        flagsCellsHistory[r][c] = hh;
+        pathHistory[pathPos] = hh;
+    }
+}
+
+// Fill coordinates of path cells and move history of path cells into path order
+template <int RankT> void RakeSearch<RankT>::SetupPathCells()
+{
+    for (int i = 0; i < MaxCellsInPath; i++)
+    {
+        if (i < cellsInPath)
+        {
+            pathCells[i].rowId = path[i][0];
+            pathCells[i].columnId = path[i][1];
+            pathCells[i].offset = path[i][0] * Rank + path[i][1];
+            pathHistory[i] = flagsCellsHistory[path[i][0]][path[i][1]];
+        }
+        else
+        {
+            pathCells[i] = PathCell();
+            pathHistory[i] = AllFree;
+        }
     }
 }
 
 // Чтение состояния поиска из потока
-void RakeSearch::Read(istream& is)
+template <int RankT> void RakeSearch<RankT>::Read(istream& is)
 {
     string marker;
     int rankToVerify;
     unsigned int storedBit = 0;
-    Square currentSquare;
+    Square<Rank> currentSquare;
 
     // Сброс флага инициализированности
     isInitialized = 0;
@@ -258,7 +735,7 @@ void RakeSearch::Read(istream& is)
     is >> rankToVerify;
 
     // Считывание данных поиска нужного нам ранга
-    if (rankToVerify == Square::Rank)
+    if (rankToVerify == Rank)
     {
         // Считывание из потока квадрата A - первого квадрата пары
         is >> currentSquare;
@@ -370,19 +847,32 @@ void RakeSearch::Read(istream& is)
     is >> totalPairsCount;
     is >> totalSquaresWithPairs;
 
+    // Read optional range of path prefixes
+    prefixRangeStart = 0;
+    prefixRangeEnd = -1;
+    is >> std::ws;
+    if (std::getline(is, marker) && (marker == prefixRangeHeader))
+    {
+        is >> prefixRangeStart;
+        is >> prefixRangeEnd;
+    }
+
     // Выставление флага инициализированности
     isInitialized = 1;
 
+    // History of path cells is moved into path order
+    SetupPathCells();
+
     // Data loaded. Perform necessary post-loading tasks.
     if (cellId == cellsInPath - 1)
     {
         // Start from WU
         // Convert old checkpoint format to new one if used
-        int row = path[cellsInPath - 2][0], col = path[cellsInPath - 2][1];
-        if (0 != flagsCellsHistory[row][col])
+        int row, col;
+        if (0 != pathHistory[cellsInPath - 2])
         {
-            int tmpColumns[Rank];
-            int tmpRows[Rank];
+            ValueMask tmpColumns[Rank];
+            ValueMask tmpRows[Rank];
             memcpy(tmpColumns, flagsColumns, sizeof(flagsColumns));
             memcpy(tmpRows, flagsRows, sizeof(flagsRows));
 
@@ -391,10 +881,10 @@ void RakeSearch::Read(istream& is)
             {
                 row = path[i][0];
                 col = path[i][1];
-                int bit = 1 << squareA[row][col];
+                int bit = 1u << squareA[row][col];
                 tmpColumns[col] |= bit;
                 tmpRows[row] |= bit;
-                flagsCellsHistory[row][col] &= tmpColumns[col] & tmpRows[row];
+                pathHistory[i] &= tmpColumns[col] & tmpRows[row];
 
                 // Update rows/cols data for last cell in path, it is no longer set
                 if (i == cellsInPath - 1)
@@ -422,9 +912,9 @@ void RakeSearch::Read(istream& is)
 }
 
 // Запись состояния поиска в поток
-void RakeSearch::Write(std::ostream& os)
+template <int RankT> void RakeSearch<RankT>::Write(std::ostream& os)
 {
-    Square currentSquare(squareA); // Первый квадрат пары, сформированный к моменту записи
+    Square<Rank> currentSquare(squareA); // Первый квадрат пары, сформированный к моменту записи
 
     // Запись состояния поиска
     // Запись заголовка
@@ -433,7 +923,7 @@ void RakeSearch::Write(std::ostream& os)
 
     // Запись состояния генератора ДЛК
     // Запись в поток ранга квадрата
-    os << Square::Rank << endl;
+    os << Rank << endl;
 
     // Запись в поток квадрата
     os << currentSquare;
@@ -500,14 +990,20 @@ void RakeSearch::Write(std::ostream& os)
     }
     os << endl;
 
-    // Запись информации об истории значений в клетках квадрата
+    // Запись информации об истории значений в клетках квадрата, история клеток пути берётся из pathHistory
+    unsigned int cellsHistory[Rank][Rank];
+    memcpy(cellsHistory, flagsCellsHistory, sizeof(cellsHistory));
+    for (int i = 0; i < cellsInPath; i++)
+    {
+        cellsHistory[path[i][0]][path[i][1]] = pathHistory[i];
+    }
     for (int h = 0; h < Rank; h++)
     {
         for (int i = 0; i < Rank; i++)
         {
             for (int j = 0; j < Rank; j++)
             {
-                os << GetBit01(flagsCellsHistory[i][j], h) << " ";
+                os << GetBit01(cellsHistory[i][j], h) << " ";
             }
             os << endl;
         }
@@ -522,10 +1018,18 @@ void RakeSearch::Write(std::ostream& os)
     // Запись статистических показателей
     os << pairsCount << " " << totalPairsCount << " " << totalSquaresWithPairs << endl;
     os << endl;
+
+    // Запись диапазона префиксов пути, если он задан
+    if ((prefixRangeStart > 0) || (prefixRangeEnd >= 0))
+    {
+        os << prefixRangeHeader << endl;
+        os << prefixRangeStart << " " << prefixRangeEnd << endl;
+        os << endl;
+    }
 }
 
 // Создание контрольной точки
-void RakeSearch::CreateCheckpoint()
+template <int RankT> void RakeSearch<RankT>::CreateCheckpoint()
 {
     ofstream checkpointFile;
 
@@ -544,15 +1048,15 @@ void RakeSearch::CreateCheckpoint()
 }
 
 // Обработка найденного, возможно что ортогонального квадрата
-void RakeSearch::ProcessOrthoSquare()
+template <int RankT> void RakeSearch<RankT>::ProcessOrthoSquare()
 {
-    Square a(squareA); // Квадрат A как объект
-    Square b(squareB); // Квадрат B как объект
+    Square<Rank> a(squareA); // Квадрат A как объект
+    Square<Rank> b(squareB); // Квадрат B как объект
 
     int orthoDegree = -1; // Метрика ортогональности проверяемых квадратов
 
     // Обработка найденного квадрата
-    orthoDegree = Square::OrthoDegree(a, b);
+    orthoDegree = Square<Rank>::OrthoDegree(a, b);
     if (orthoDegree >= MinOrthoMetric && b.IsDiagonal() && b.IsLatin() && a.IsDiagonal() && a.IsLatin())
     {
         // Запись информации о найденном квадрате
@@ -637,7 +1141,7 @@ void RakeSearch::ProcessOrthoSquare()
 }
 
 // Проверка взаимной ортогональности набора квадратов, найденного в текущем поиске
-void RakeSearch::CheckMutualOrthogonality()
+template <int RankT> void RakeSearch<RankT>::CheckMutualOrthogonality()
 {
     int orthoMetric = Rank * Rank;
     int maxSquareId;
@@ -666,7 +1170,7 @@ void RakeSearch::CheckMutualOrthogonality()
     {
         for (int j = i + 1; j <= maxSquareId; j++)
         {
-            if (Square::OrthoDegree(orthoSquares[i], orthoSquares[j]) == orthoMetric)
+            if (Square<Rank>::OrthoDegree(orthoSquares[i], orthoSquares[j]) == orthoMetric)
             {
                 if (isDebug)
                     cout << "# Square " << i << " # " << j << endl;
@@ -693,7 +1197,7 @@ void RakeSearch::CheckMutualOrthogonality()
 }
 
 // Обработка квадрата
-void RakeSearch::ProcessSquare()
+template <int RankT> void RakeSearch<RankT>::ProcessSquare()
 {
     double fraction_done; // Доля выполнения задания
 
@@ -733,7 +1237,8 @@ void RakeSearch::ProcessSquare()
                 break;
             ++pathPrefixPos;
         }
-        fraction_done = pathPrefixPos / (double)pathPrefixes.size();
+        int prefixesEnd = prefixRangeEnd < 0 ? (int)pathPrefixes.size() : prefixRangeEnd;
+        fraction_done = (pathPrefixPos - prefixRangeStart) / (double)(prefixesEnd - prefixRangeStart);
 
         boinc_fraction_done(fraction_done); // Сообщить клиенту BOINC о доле выполнения задания
 
@@ -745,14 +1250,21 @@ void RakeSearch::ProcessSquare()
             boinc_checkpoint_completed(); // BOINC знает, что контрольная точка записана
         }
 
+        // Give away the rest of workunit if requested
+        int donationParts = CheckWorkDonationRequest();
+        if (donationParts > 0)
+        {
+            DonateWork(donationParts);
+        }
+
         if (isDebug)
         {
-            Square squareToShow(squareA);
+            Square<Rank> squareToShow(squareA);
 
             cout << "# ------------------------" << endl;
             cout << "# Processed " << squaresCount << " squares." << endl;
-            cout << "# Done: " << pathPrefixPos << "/" << pathPrefixes.size() << " = " << fraction_done * 100.0 << "%"
-                 << endl;
+            cout << "# Done: " << pathPrefixPos - prefixRangeStart << "/" << prefixesEnd - prefixRangeStart << " = "
+                 << fraction_done * 100.0 << "%" << endl;
             cout << "# Last processed square:" << endl;
             cout << endl;
             cout << squareToShow;
@@ -762,7 +1274,7 @@ void RakeSearch::ProcessSquare()
 }
 
 // Вывод итогов поиска
-void RakeSearch::ShowSearchTotals()
+template <int RankT> void RakeSearch<RankT>::ShowSearchTotals()
 {
     ofstream resultFile;
 
@@ -791,13 +1303,25 @@ void RakeSearch::ShowSearchTotals()
 }
 
 // Start the squares generation
-void RakeSearch::Start()
+template <int RankT> void RakeSearch<RankT>::Start()
 {
-    // Check value of keyValue and pass result as a type to StartImpl
-    if (IsCellEmpty(keyValue))
-        StartImpl<true_type>();
-    else
-        StartImpl<false_type>();
+    // Check value of keyValue and range of path prefixes and pass result as a types to StartImpl
+    if (prefixRangeEnd < 0)
+    {
+        // Range may start after the last prefix, then there is nothing to process
+        if ((0 == prefixRangeStart) || (prefixRangeStart < (int)pathPrefixes.size()))
+        {
+            if (IsCellEmpty(keyValue))
+                StartImpl<true_type, false_type>();
+            else
+                StartImpl<false_type, false_type>();
+        }
+    }
+
+    // Search is limited by range of path prefixes from the beginning, or after work donation.
+    // Empty range has nothing to process.
+    if ((prefixRangeEnd >= 0) && (prefixRangeStart < prefixRangeEnd))
+        StartImpl<true_type, true_type>();
 
     // Вывод итогов поиска
     ShowSearchTotals();
@@ -806,20 +1330,24 @@ void RakeSearch::Start()
 // Actual implementation of the squares generation
 // Note: values on diagonal are preset in WU, so corresponding parts of code are commented out.
 // It turned out that it was quite costly to have instructions which were doing nothing.
-template <typename IsKeyValueEmpty> inline void RakeSearch::StartImpl()
+template <int RankT>
+template <typename IsKeyValueEmpty, typename IsPrefixRangeLimited, typename IsCountOnly>
+inline void RakeSearch<RankT>::StartImpl()
 {
-    int cellValue;           // New value for the cell
-    int cellValueCandidates; // Candidates for value for the cell
+    int cellValue;                    // New value for the cell
+    unsigned int cellValueCandidates; // Candidates for value for the cell, unsigned as bit 31 is used by Rank 32
 
-    // Create constant copies of used fields to speedup calculations
-    const int_fast32_t cellsInPath = this->cellsInPath;
+    // Create constant copies of used fields to speedup calculations.
+    // Counting of squares does not fill forced cells at the end of path.
+    const int_fast32_t cellsInPath = IsCountOnly::value ? this->cellsInPath - forcedCellsCount : this->cellsInPath;
     const int keyValue = this->keyValue;
     const int_fast32_t keyRowId = this->keyRowId;
     const int_fast32_t keyColumnId = this->keyColumnId;
 
     // Use registers for local variables instead of memory
-    int_fast32_t rowId, columnId;
+    int_fast32_t rowId, columnId, cellOffset;
     int_fast32_t cellId = this->cellId;
+    int* const squareCells = &squareA[0][0]; // Cells of squareA addressed by offsets of path cells
 
     // Checkpoint may be written after new ODLS is created only.
     // Class members moved to registers above are constant in checkpoint
@@ -830,8 +1358,9 @@ template <typename IsKeyValueEmpty> inline void RakeSearch::StartImpl()
 
     // Selection of the value for the next cell
     // Read coordinates of the cell
-    rowId = path[cellId][0];
-    columnId = path[cellId][1];
+    rowId = pathCells[cellId].rowId;
+    columnId = pathCells[cellId].columnId;
+    cellOffset = pathCells[cellId].offset;
 
     // Generate new value for the cell (rowId, columnId)
     // Select the value for the cell
@@ -852,17 +1381,34 @@ template <typename IsKeyValueEmpty> inline void RakeSearch::StartImpl()
             while (1)
             {
                 // Extract lowest bit set
-                int bit = (-cellValueCandidates) & cellValueCandidates;
+                unsigned int bit = cellValueCandidates & (0u - cellValueCandidates);
 
                 // Write the value into the square
-                squareA[rowId][columnId] = __builtin_ctz(bit);
+                squareCells[cellOffset] = __builtin_ctz(bit);
 
                 // Process the finish of the square generation
                 if (cellId == cellsInPath - 1)
                 {
+                    // Every candidate of the last cell gives one square, forced cells are filled in a single way
+                    if (IsCountOnly::value)
+                    {
+                        squaresCount += __builtin_popcount(cellValueCandidates);
+                        break;
+                    }
+
                     // Process the found square
                     ProcessSquare();
 
+                    // Range of path prefixes was set by work donation, continue with the limited search.
+                    // Current state is the same as in checkpoint, so search can be resumed from it.
+                    if (!IsPrefixRangeLimited::value)
+                    {
+                        if (prefixRangeEnd >= 0)
+                        {
+                            return;
+                        }
+                    }
+
                     // Check the finish condition of search
                     if (!IsKeyValueEmpty::value)
                     {
@@ -883,11 +1429,20 @@ template <typename IsKeyValueEmpty> inline void RakeSearch::StartImpl()
                     flagsRows[rowId] &= ~bit;
 
                     // Mark the value in the history of cell values
-                    flagsCellsHistory[rowId][columnId] = cellValueCandidates & ~bit;
+                    pathHistory[cellId] = cellValueCandidates & ~bit;
 
                     // Step forward
                     cellId++;
 
+                    // Check the end of path prefix range
+                    if (IsPrefixRangeLimited::value)
+                    {
+                        if ((cellId == MaxPathPrefixes) && IsPathPrefixReached(prefixRangeEnd))
+                        {
+                            return;
+                        }
+                    }
+
                     // Check the finish condition of search
                     if (!IsKeyValueEmpty::value)
                     {
@@ -900,8 +1455,9 @@ template <typename IsKeyValueEmpty> inline void RakeSearch::StartImpl()
 
                     // Selection of the value for the next cell
                     // Read coordinates of the cell
-                    rowId = path[cellId][0];
-                    columnId = path[cellId][1];
+                    rowId = pathCells[cellId].rowId;
+                    columnId = pathCells[cellId].columnId;
+                    cellOffset = pathCells[cellId].offset;
 
                     // Generate new value for the cell (rowId, columnId)
                     // Select the value for the cell
@@ -932,13 +1488,14 @@ template <typename IsKeyValueEmpty> inline void RakeSearch::StartImpl()
 
                 // Selection of the value for the next cell
                 // Read coordinates of the cell
-                rowId = path[cellId][0];
-                columnId = path[cellId][1];
+                rowId = pathCells[cellId].rowId;
+                columnId = pathCells[cellId].columnId;
+                cellOffset = pathCells[cellId].offset;
 
                 // Process the fact of not-founding a new value in the cell (rowId; columnId)
                 // Restore the previous value from the square into arrays
                 // Read the current value
-                cellValue = squareA[rowId][columnId];
+                cellValue = squareCells[cellOffset];
 
                 // Restore the value into auxilary arrays
                 // Restore the value into columns
@@ -946,7 +1503,7 @@ template <typename IsKeyValueEmpty> inline void RakeSearch::StartImpl()
                 // Restore the value into rows
                 SetFree(flagsRows[rowId], cellValue);
 
-                cellValueCandidates = flagsCellsHistory[rowId][columnId];
+                cellValueCandidates = pathHistory[cellId];
 
                 if (cellValueCandidates)
                     break;
@@ -956,8 +1513,9 @@ template <typename IsKeyValueEmpty> inline void RakeSearch::StartImpl()
 }
 
 #if defined(__ARM_NEON) && !defined(__aarch64__) && defined(HAS_SIMD)
-__attribute__((always_inline)) inline void RakeSearch::transposeMatrix4x4(int srcRow, int srcCol, int destRow,
-                                                                          int destCol)
+template <int RankT>
+__attribute__((always_inline)) inline void RakeSearch<RankT>::transposeMatrix4x4(int srcRow, int srcCol, int destRow,
+                                                                                 int destCol)
 {
     uint16x4_t v1, v2;
     v1 = vld1_u16((uint16_t*)(&squareA_Mask[srcRow + 0][srcCol + 0]));
@@ -986,13 +1544,138 @@ __attribute__((always_inline)) inline void RakeSearch::transposeMatrix4x4(int sr
 }
 #endif
 
-void RakeSearch::GenerateSquareMasks()
+#if defined(__SSE2__) && defined(HAS_SIMD)
+template <int RankT>
+__attribute__((always_inline)) inline void RakeSearch<RankT>::transposeMatrix8x8(int srcRow, int srcCol, int destRow,
+                                                                                 int destCol)
 {
-    // Generate bitmasks
-#if defined(__AVX2__) && defined(HAS_SIMD)
-    // AVX2 has "shift by vector" instruction, use it here
-    // Note: AVX512 instructions which use ZMM registers cause too big
-    // CPU frequency throttling. It does not make sense to use them in this
+    __m128i v1_1 = LoadMasks8<Rank>(&squareA_Mask[srcRow + 0][srcCol]);
+    __m128i v2_1 = LoadMasks8<Rank>(&squareA_Mask[srcRow + 1][srcCol]);
+    __m128i v3_1 = LoadMasks8<Rank>(&squareA_Mask[srcRow + 2][srcCol]);
+    __m128i v4_1 = LoadMasks8<Rank>(&squareA_Mask[srcRow + 3][srcCol]);
+    __m128i v5_1 = LoadMasks8<Rank>(&squareA_Mask[srcRow + 4][srcCol]);
+    __m128i v6_1 = LoadMasks8<Rank>(&squareA_Mask[srcRow + 5][srcCol]);
+    __m128i v7_1 = LoadMasks8<Rank>(&squareA_Mask[srcRow + 6][srcCol]);
+    __m128i v8_1 = LoadMasks8<Rank>(&squareA_Mask[srcRow + 7][srcCol]);
+
+    __m128i v1_2 = _mm_unpacklo_epi16(v1_1, v2_1);
+    __m128i v2_2 = _mm_unpackhi_epi16(v1_1, v2_1);
+    __m128i v3_2 = _mm_unpacklo_epi16(v3_1, v4_1);
+    __m128i v4_2 = _mm_unpackhi_epi16(v3_1, v4_1);
+    __m128i v5_2 = _mm_unpacklo_epi16(v5_1, v6_1);
+    __m128i v6_2 = _mm_unpackhi_epi16(v5_1, v6_1);
+    __m128i v7_2 = _mm_unpacklo_epi16(v7_1, v8_1);
+    __m128i v8_2 = _mm_unpackhi_epi16(v7_1, v8_1);
+
+    __m128i v1_3 = _mm_unpacklo_epi32(v1_2, v3_2);
+    __m128i v2_3 = _mm_unpackhi_epi32(v1_2, v3_2);
+    __m128i v3_3 = _mm_unpacklo_epi32(v2_2, v4_2);
+    __m128i v4_3 = _mm_unpackhi_epi32(v2_2, v4_2);
+    __m128i v5_3 = _mm_unpacklo_epi32(v5_2, v7_2);
+    __m128i v6_3 = _mm_unpackhi_epi32(v5_2, v7_2);
+    __m128i v7_3 = _mm_unpacklo_epi32(v6_2, v8_2);
+    __m128i v8_3 = _mm_unpackhi_epi32(v6_2, v8_2);
+
+    __m128i v1_4 = _mm_unpacklo_epi64(v1_3, v5_3);
+    __m128i v2_4 = _mm_unpackhi_epi64(v1_3, v5_3);
+    __m128i v3_4 = _mm_unpacklo_epi64(v2_3, v6_3);
+    __m128i v4_4 = _mm_unpackhi_epi64(v2_3, v6_3);
+    __m128i v5_4 = _mm_unpacklo_epi64(v3_3, v7_3);
+    __m128i v6_4 = _mm_unpackhi_epi64(v3_3, v7_3);
+    __m128i v7_4 = _mm_unpacklo_epi64(v4_3, v8_3);
+    __m128i v8_4 = _mm_unpackhi_epi64(v4_3, v8_3);
+
+    _mm_storeu_si128((__m128i*)(&squareA_MaskT[destRow + 0][destCol]), v1_4);
+    _mm_storeu_si128((__m128i*)(&squareA_MaskT[destRow + 1][destCol]), v2_4);
+    _mm_storeu_si128((__m128i*)(&squareA_MaskT[destRow + 2][destCol]), v3_4);
+    _mm_storeu_si128((__m128i*)(&squareA_MaskT[destRow + 3][destCol]), v4_4);
+    _mm_storeu_si128((__m128i*)(&squareA_MaskT[destRow + 4][destCol]), v5_4);
+    _mm_storeu_si128((__m128i*)(&squareA_MaskT[destRow + 5][destCol]), v6_4);
+    _mm_storeu_si128((__m128i*)(&squareA_MaskT[destRow + 6][destCol]), v7_4);
+    _mm_storeu_si128((__m128i*)(&squareA_MaskT[destRow + 7][destCol]), v8_4);
+}
+#elif defined(__aarch64__) && defined(HAS_SIMD)
+template <int RankT>
+__attribute__((always_inline)) inline void RakeSearch<RankT>::transposeMatrix8x8(int srcRow, int srcCol, int destRow,
+                                                                                 int destCol)
+{
+    uint16x8_t v1, v2;
+    v1 = vld1q_u16((uint16_t*)(&squareA_Mask[srcRow + 0][srcCol + 0]));
+    v2 = vld1q_u16((uint16_t*)(&squareA_Mask[srcRow + 0][srcCol + 4]));
+    uint16x8_t v1_1 = vuzp1q_u16(v1, v2);
+    v1 = vld1q_u16((uint16_t*)(&squareA_Mask[srcRow + 1][srcCol + 0]));
+    v2 = vld1q_u16((uint16_t*)(&squareA_Mask[srcRow + 1][srcCol + 4]));
+    uint16x8_t v2_1 = vuzp1q_u16(v1, v2);
+    v1 = vld1q_u16((uint16_t*)(&squareA_Mask[srcRow + 2][srcCol + 0]));
+    v2 = vld1q_u16((uint16_t*)(&squareA_Mask[srcRow + 2][srcCol + 4]));
+    uint16x8_t v3_1 = vuzp1q_u16(v1, v2);
+    v1 = vld1q_u16((uint16_t*)(&squareA_Mask[srcRow + 3][srcCol + 0]));
+    v2 = vld1q_u16((uint16_t*)(&squareA_Mask[srcRow + 3][srcCol + 4]));
+    uint16x8_t v4_1 = vuzp1q_u16(v1, v2);
+    v1 = vld1q_u16((uint16_t*)(&squareA_Mask[srcRow + 4][srcCol + 0]));
+    v2 = vld1q_u16((uint16_t*)(&squareA_Mask[srcRow + 4][srcCol + 4]));
+    uint16x8_t v5_1 = vuzp1q_u16(v1, v2);
+    v1 = vld1q_u16((uint16_t*)(&squareA_Mask[srcRow + 5][srcCol + 0]));
+    v2 = vld1q_u16((uint16_t*)(&squareA_Mask[srcRow + 5][srcCol + 4]));
+    uint16x8_t v6_1 = vuzp1q_u16(v1, v2);
+    v1 = vld1q_u16((uint16_t*)(&squareA_Mask[srcRow + 6][srcCol + 0]));
+    v2 = vld1q_u16((uint16_t*)(&squareA_Mask[srcRow + 6][srcCol + 4]));
+    uint16x8_t v7_1 = vuzp1q_u16(v1, v2);
+    v1 = vld1q_u16((uint16_t*)(&squareA_Mask[srcRow + 7][srcCol + 0]));
+    v2 = vld1q_u16((uint16_t*)(&squareA_Mask[srcRow + 7][srcCol + 4]));
+    uint16x8_t v8_1 = vuzp1q_u16(v1, v2);
+
+    uint16x8_t v1_2 = vtrn1q_u16(v1_1, v2_1);
+    uint16x8_t v2_2 = vtrn2q_u16(v1_1, v2_1);
+    uint16x8_t v3_2 = vtrn1q_u16(v3_1, v4_1);
+    uint16x8_t v4_2 = vtrn2q_u16(v3_1, v4_1);
+    uint16x8_t v5_2 = vtrn1q_u16(v5_1, v6_1);
+    uint16x8_t v6_2 = vtrn2q_u16(v5_1, v6_1);
+    uint16x8_t v7_2 = vtrn1q_u16(v7_1, v8_1);
+    uint16x8_t v8_2 = vtrn2q_u16(v7_1, v8_1);
+
+    uint32x4_t v1_3 = vtrn1q_u32(vreinterpretq_u32_u16(v1_2), vreinterpretq_u32_u16(v3_2));
+    uint32x4_t v2_3 = vtrn1q_u32(vreinterpretq_u32_u16(v2_2), vreinterpretq_u32_u16(v4_2));
+    uint32x4_t v3_3 = vtrn2q_u32(vreinterpretq_u32_u16(v1_2), vreinterpretq_u32_u16(v3_2));
+    uint32x4_t v4_3 = vtrn2q_u32(vreinterpretq_u32_u16(v2_2), vreinterpretq_u32_u16(v4_2));
+    uint32x4_t v5_3 = vtrn1q_u32(vreinterpretq_u32_u16(v5_2), vreinterpretq_u32_u16(v7_2));
+    uint32x4_t v6_3 = vtrn1q_u32(vreinterpretq_u32_u16(v6_2), vreinterpretq_u32_u16(v8_2));
+    uint32x4_t v7_3 = vtrn2q_u32(vreinterpretq_u32_u16(v5_2), vreinterpretq_u32_u16(v7_2));
+    uint32x4_t v8_3 = vtrn2q_u32(vreinterpretq_u32_u16(v6_2), vreinterpretq_u32_u16(v8_2));
+
+    uint64x2_t v1_4 = vtrn1q_u64(vreinterpretq_u64_u32(v1_3), vreinterpretq_u64_u32(v5_3));
+    uint64x2_t v2_4 = vtrn1q_u64(vreinterpretq_u64_u32(v2_3), vreinterpretq_u64_u32(v6_3));
+    uint64x2_t v3_4 = vtrn1q_u64(vreinterpretq_u64_u32(v3_3), vreinterpretq_u64_u32(v7_3));
+    uint64x2_t v4_4 = vtrn1q_u64(vreinterpretq_u64_u32(v4_3), vreinterpretq_u64_u32(v8_3));
+    uint64x2_t v5_4 = vtrn2q_u64(vreinterpretq_u64_u32(v1_3), vreinterpretq_u64_u32(v5_3));
+    uint64x2_t v6_4 = vtrn2q_u64(vreinterpretq_u64_u32(v2_3), vreinterpretq_u64_u32(v6_3));
+    uint64x2_t v7_4 = vtrn2q_u64(vreinterpretq_u64_u32(v3_3), vreinterpretq_u64_u32(v7_3));
+    uint64x2_t v8_4 = vtrn2q_u64(vreinterpretq_u64_u32(v4_3), vreinterpretq_u64_u32(v8_3));
+
+    vst1q_u64((uint64_t*)(&squareA_MaskT[destRow + 0][destCol + 0]), v1_4);
+    vst1q_u64((uint64_t*)(&squareA_MaskT[destRow + 1][destCol + 0]), v2_4);
+    vst1q_u64((uint64_t*)(&squareA_MaskT[destRow + 2][destCol + 0]), v3_4);
+    vst1q_u64((uint64_t*)(&squareA_MaskT[destRow + 3][destCol + 0]), v4_4);
+    vst1q_u64((uint64_t*)(&squareA_MaskT[destRow + 4][destCol + 0]), v5_4);
+    vst1q_u64((uint64_t*)(&squareA_MaskT[destRow + 5][destCol + 0]), v6_4);
+    vst1q_u64((uint64_t*)(&squareA_MaskT[destRow + 6][destCol + 0]), v7_4);
+    vst1q_u64((uint64_t*)(&squareA_MaskT[destRow + 7][destCol + 0]), v8_4);
+}
+#endif
+
+template <int RankT> void RakeSearch<RankT>::GenerateSquareMasks()
+{
+    if (IsWideMask)
+    {
+        GenerateSquareMasksWide();
+        return;
+    }
+
+    // Generate bitmasks
+#if defined(__AVX2__) && defined(HAS_SIMD)
+    // AVX2 has "shift by vector" instruction, use it here
+    // Note: AVX512 instructions which use ZMM registers cause too big
+    // CPU frequency throttling. It does not make sense to use them in this
     // one place only, as everything else will be slowed down too.
     int n = 0;
     for (; n < Rank * Rank - 7; n += 8)
@@ -1001,6 +1684,16 @@ void RakeSearch::GenerateSquareMasks()
         v = _mm256_sllv_epi32(_mm256_set1_epi32(1), v);
         _mm256_store_si256((__m256i*)(&squareA_Mask[0][0] + n), v);
     }
+#if defined(__AVX512F__) && defined(__AVX512VL__)
+    // Process remaining elements using masked load and store
+    if ((Rank * Rank) % 8 > 0)
+    {
+        const __mmask8 tailMask = (1u << ((Rank * Rank) % 8)) - 1;
+        __m256i v = _mm256_maskz_load_epi32(tailMask, &squareA[0][0] + n);
+        v = _mm256_sllv_epi32(_mm256_set1_epi32(1), v);
+        _mm256_mask_store_epi32(&squareA_Mask[0][0] + n, tailMask, v);
+    }
+#else
     // Use SSE instruction if possible at the end
     if ((Rank * Rank) % 8 >= 4)
     {
@@ -1016,9 +1709,10 @@ void RakeSearch::GenerateSquareMasks()
         for (; n < Rank * Rank; n++)
         {
             int x = *(&squareA[0][0] + n);
-            *((&squareA_Mask[0][0] + n)) = 1 << x;
+            *((&squareA_Mask[0][0] + n)) = 1u << x;
         }
     }
+#endif
 #elif defined(__SSSE3__) && defined(HAS_SIMD)
     // SSSE3 added shuffle instruction, which can be used to build small lookup table.
     // Maximum val needs more than 8 bits, so some extra check and shift by constant is
@@ -1063,7 +1757,7 @@ void RakeSearch::GenerateSquareMasks()
     for (; n < Rank * Rank; n++)
     {
         int x = *(&squareA[0][0] + n);
-        *((&squareA_Mask[0][0] + n)) = 1 << x;
+        *((&squareA_Mask[0][0] + n)) = 1u << x;
     }
 #else
     // Default non-SIMD code
@@ -1081,190 +1775,28 @@ void RakeSearch::GenerateSquareMasks()
 #endif
 
     // Create transposed copy of squareA_Mask if needed
-#if defined(__SSE2__) && defined(HAS_SIMD)
-    __m128i v1, v2;
-    v1 = _mm_loadu_si128((__m128i*)(&squareA_Mask[0][0]));
-    v2 = _mm_loadu_si128((__m128i*)(&squareA_Mask[0][4]));
-    __m128i v1_1 = _mm_packs_epi32(v1, v2);
-    v1 = _mm_loadu_si128((__m128i*)(&squareA_Mask[1][0]));
-    v2 = _mm_loadu_si128((__m128i*)(&squareA_Mask[1][4]));
-    __m128i v2_1 = _mm_packs_epi32(v1, v2);
-    v1 = _mm_loadu_si128((__m128i*)(&squareA_Mask[2][0]));
-    v2 = _mm_loadu_si128((__m128i*)(&squareA_Mask[2][4]));
-    __m128i v3_1 = _mm_packs_epi32(v1, v2);
-    v1 = _mm_loadu_si128((__m128i*)(&squareA_Mask[3][0]));
-    v2 = _mm_loadu_si128((__m128i*)(&squareA_Mask[3][4]));
-    __m128i v4_1 = _mm_packs_epi32(v1, v2);
-    v1 = _mm_loadu_si128((__m128i*)(&squareA_Mask[4][0]));
-    v2 = _mm_loadu_si128((__m128i*)(&squareA_Mask[4][4]));
-    __m128i v5_1 = _mm_packs_epi32(v1, v2);
-    v1 = _mm_loadu_si128((__m128i*)(&squareA_Mask[5][0]));
-    v2 = _mm_loadu_si128((__m128i*)(&squareA_Mask[5][4]));
-    __m128i v6_1 = _mm_packs_epi32(v1, v2);
-    v1 = _mm_loadu_si128((__m128i*)(&squareA_Mask[6][0]));
-    v2 = _mm_loadu_si128((__m128i*)(&squareA_Mask[6][4]));
-    __m128i v7_1 = _mm_packs_epi32(v1, v2);
-    v1 = _mm_loadu_si128((__m128i*)(&squareA_Mask[7][0]));
-    v2 = _mm_loadu_si128((__m128i*)(&squareA_Mask[7][4]));
-    __m128i v8_1 = _mm_packs_epi32(v1, v2);
-
-    __m128i v1_2 = _mm_unpacklo_epi16(v1_1, v2_1);
-    __m128i v2_2 = _mm_unpackhi_epi16(v1_1, v2_1);
-    __m128i v3_2 = _mm_unpacklo_epi16(v3_1, v4_1);
-    __m128i v4_2 = _mm_unpackhi_epi16(v3_1, v4_1);
-    __m128i v5_2 = _mm_unpacklo_epi16(v5_1, v6_1);
-    __m128i v6_2 = _mm_unpackhi_epi16(v5_1, v6_1);
-    __m128i v7_2 = _mm_unpacklo_epi16(v7_1, v8_1);
-    __m128i v8_2 = _mm_unpackhi_epi16(v7_1, v8_1);
-
-    __m128i v1_3 = _mm_unpacklo_epi32(v1_2, v3_2);
-    __m128i v2_3 = _mm_unpackhi_epi32(v1_2, v3_2);
-    __m128i v3_3 = _mm_unpacklo_epi32(v2_2, v4_2);
-    __m128i v4_3 = _mm_unpackhi_epi32(v2_2, v4_2);
-    __m128i v5_3 = _mm_unpacklo_epi32(v5_2, v7_2);
-    __m128i v6_3 = _mm_unpackhi_epi32(v5_2, v7_2);
-    __m128i v7_3 = _mm_unpacklo_epi32(v6_2, v8_2);
-    __m128i v8_3 = _mm_unpackhi_epi32(v6_2, v8_2);
-
-    __m128i v1_4 = _mm_unpacklo_epi64(v1_3, v5_3);
-    __m128i v2_4 = _mm_unpackhi_epi64(v1_3, v5_3);
-    __m128i v3_4 = _mm_unpacklo_epi64(v2_3, v6_3);
-    __m128i v4_4 = _mm_unpackhi_epi64(v2_3, v6_3);
-    __m128i v5_4 = _mm_unpacklo_epi64(v3_3, v7_3);
-    __m128i v6_4 = _mm_unpackhi_epi64(v3_3, v7_3);
-    __m128i v7_4 = _mm_unpacklo_epi64(v4_3, v8_3);
-    __m128i v8_4 = _mm_unpackhi_epi64(v4_3, v8_3);
-
-    _mm_store_si128((__m128i*)(&squareA_MaskT[0][0]), v1_4);
-    _mm_store_si128((__m128i*)(&squareA_MaskT[1][0]), v2_4);
-    _mm_store_si128((__m128i*)(&squareA_MaskT[2][0]), v3_4);
-    _mm_store_si128((__m128i*)(&squareA_MaskT[3][0]), v4_4);
-    _mm_store_si128((__m128i*)(&squareA_MaskT[4][0]), v5_4);
-    _mm_store_si128((__m128i*)(&squareA_MaskT[5][0]), v6_4);
-    _mm_store_si128((__m128i*)(&squareA_MaskT[6][0]), v7_4);
-    _mm_store_si128((__m128i*)(&squareA_MaskT[7][0]), v8_4);
-
-    // Transpose data from last columns (excluding bottom-right part)
-    for (int i = 0; i < 8; i++)
-    {
-        for (int j = 8; j < Rank; j++)
-        {
-            squareA_MaskT[j][i] = squareA_Mask[i][j];
-        }
-    }
-    // Transpose data from last rows
-    for (int i = 8; i < Rank; i++)
+#if (defined(__SSE2__) || defined(__aarch64__)) && defined(HAS_SIMD)
+    // Transpose whole matrix using 8x8 tiles. For Rank 9+ tiles at the right and bottom
+    // edges overlap with the first one, what is still faster than transposing remaining
+    // elements one by one.
+    transposeMatrix8x8(0, 0, 0, 0);
+    if (Rank > 8)
     {
-        for (int j = 0; j < Rank; j++)
-        {
-            squareA_MaskT[j][i] = squareA_Mask[i][j];
-        }
+        transposeMatrix8x8(0, Rank - 8, Rank - 8, 0);
+        transposeMatrix8x8(Rank - 8, 0, 0, Rank - 8);
+        transposeMatrix8x8(Rank - 8, Rank - 8, Rank - 8, Rank - 8);
     }
 #elif defined(__ARM_NEON) && defined(HAS_SIMD)
-#ifdef __aarch64__
-    uint16x8_t v1, v2;
-    v1 = vld1q_u16((uint16_t*)(&squareA_Mask[0][0]));
-    v2 = vld1q_u16((uint16_t*)(&squareA_Mask[0][4]));
-    uint16x8_t v1_1 = vuzp1q_u16(v1, v2);
-    v1 = vld1q_u16((uint16_t*)(&squareA_Mask[1][0]));
-    v2 = vld1q_u16((uint16_t*)(&squareA_Mask[1][4]));
-    uint16x8_t v2_1 = vuzp1q_u16(v1, v2);
-    v1 = vld1q_u16((uint16_t*)(&squareA_Mask[2][0]));
-    v2 = vld1q_u16((uint16_t*)(&squareA_Mask[2][4]));
-    uint16x8_t v3_1 = vuzp1q_u16(v1, v2);
-    v1 = vld1q_u16((uint16_t*)(&squareA_Mask[3][0]));
-    v2 = vld1q_u16((uint16_t*)(&squareA_Mask[3][4]));
-    uint16x8_t v4_1 = vuzp1q_u16(v1, v2);
-    v1 = vld1q_u16((uint16_t*)(&squareA_Mask[4][0]));
-    v2 = vld1q_u16((uint16_t*)(&squareA_Mask[4][4]));
-    uint16x8_t v5_1 = vuzp1q_u16(v1, v2);
-    v1 = vld1q_u16((uint16_t*)(&squareA_Mask[5][0]));
-    v2 = vld1q_u16((uint16_t*)(&squareA_Mask[5][4]));
-    uint16x8_t v6_1 = vuzp1q_u16(v1, v2);
-    v1 = vld1q_u16((uint16_t*)(&squareA_Mask[6][0]));
-    v2 = vld1q_u16((uint16_t*)(&squareA_Mask[6][4]));
-    uint16x8_t v7_1 = vuzp1q_u16(v1, v2);
-    v1 = vld1q_u16((uint16_t*)(&squareA_Mask[7][0]));
-    v2 = vld1q_u16((uint16_t*)(&squareA_Mask[7][4]));
-    uint16x8_t v8_1 = vuzp1q_u16(v1, v2);
-
-    uint16x8_t v1_2 = vtrn1q_u16(v1_1, v2_1);
-    uint16x8_t v2_2 = vtrn2q_u16(v1_1, v2_1);
-    uint16x8_t v3_2 = vtrn1q_u16(v3_1, v4_1);
-    uint16x8_t v4_2 = vtrn2q_u16(v3_1, v4_1);
-    uint16x8_t v5_2 = vtrn1q_u16(v5_1, v6_1);
-    uint16x8_t v6_2 = vtrn2q_u16(v5_1, v6_1);
-    uint16x8_t v7_2 = vtrn1q_u16(v7_1, v8_1);
-    uint16x8_t v8_2 = vtrn2q_u16(v7_1, v8_1);
-
-    uint32x4_t v1_3 = vtrn1q_u32(vreinterpretq_u32_u16(v1_2), vreinterpretq_u32_u16(v3_2));
-    uint32x4_t v2_3 = vtrn1q_u32(vreinterpretq_u32_u16(v2_2), vreinterpretq_u32_u16(v4_2));
-    uint32x4_t v3_3 = vtrn2q_u32(vreinterpretq_u32_u16(v1_2), vreinterpretq_u32_u16(v3_2));
-    uint32x4_t v4_3 = vtrn2q_u32(vreinterpretq_u32_u16(v2_2), vreinterpretq_u32_u16(v4_2));
-    uint32x4_t v5_3 = vtrn1q_u32(vreinterpretq_u32_u16(v5_2), vreinterpretq_u32_u16(v7_2));
-    uint32x4_t v6_3 = vtrn1q_u32(vreinterpretq_u32_u16(v6_2), vreinterpretq_u32_u16(v8_2));
-    uint32x4_t v7_3 = vtrn2q_u32(vreinterpretq_u32_u16(v5_2), vreinterpretq_u32_u16(v7_2));
-    uint32x4_t v8_3 = vtrn2q_u32(vreinterpretq_u32_u16(v6_2), vreinterpretq_u32_u16(v8_2));
-
-    uint64x2_t v1_4 = vtrn1q_u64(vreinterpretq_u64_u32(v1_3), vreinterpretq_u64_u32(v5_3));
-    uint64x2_t v2_4 = vtrn1q_u64(vreinterpretq_u64_u32(v2_3), vreinterpretq_u64_u32(v6_3));
-    uint64x2_t v3_4 = vtrn1q_u64(vreinterpretq_u64_u32(v3_3), vreinterpretq_u64_u32(v7_3));
-    uint64x2_t v4_4 = vtrn1q_u64(vreinterpretq_u64_u32(v4_3), vreinterpretq_u64_u32(v8_3));
-    uint64x2_t v5_4 = vtrn2q_u64(vreinterpretq_u64_u32(v1_3), vreinterpretq_u64_u32(v5_3));
-    uint64x2_t v6_4 = vtrn2q_u64(vreinterpretq_u64_u32(v2_3), vreinterpretq_u64_u32(v6_3));
-    uint64x2_t v7_4 = vtrn2q_u64(vreinterpretq_u64_u32(v3_3), vreinterpretq_u64_u32(v7_3));
-    uint64x2_t v8_4 = vtrn2q_u64(vreinterpretq_u64_u32(v4_3), vreinterpretq_u64_u32(v8_3));
-
-    vst1q_u64((uint64_t*)(&squareA_MaskT[0][0]), v1_4);
-    vst1q_u64((uint64_t*)(&squareA_MaskT[1][0]), v2_4);
-    vst1q_u64((uint64_t*)(&squareA_MaskT[2][0]), v3_4);
-    vst1q_u64((uint64_t*)(&squareA_MaskT[3][0]), v4_4);
-    vst1q_u64((uint64_t*)(&squareA_MaskT[4][0]), v5_4);
-    vst1q_u64((uint64_t*)(&squareA_MaskT[5][0]), v6_4);
-    vst1q_u64((uint64_t*)(&squareA_MaskT[6][0]), v7_4);
-    vst1q_u64((uint64_t*)(&squareA_MaskT[7][0]), v8_4);
-
-    // Transpose data from last columns (excluding bottom-right part)
-    for (int i = 0; i < 8; i++)
-    {
-        for (int j = 8; j < Rank; j++)
-        {
-            squareA_MaskT[j][i] = squareA_Mask[i][j];
-        }
-    }
-    // Transpose data from last rows
-    for (int i = 8; i < Rank; i++)
-    {
-        for (int j = 0; j < Rank; j++)
-        {
-            squareA_MaskT[j][i] = squareA_Mask[i][j];
-        }
-    }
-#else  // !__aarch64__
-    transposeMatrix4x4(0, 0, 0, 0);
-    transposeMatrix4x4(0, 4, 4, 0);
-    transposeMatrix4x4(4, 0, 0, 4);
-    transposeMatrix4x4(4, 4, 4, 4);
-
-    static_assert(Rank < 12, "Use transposeMatrix4x4 more times to optimize transpose for Rank 12+");
-
-    // Transpose data from last columns (excluding bottom-right part)
-    for (int i = 0; i < 8; i++)
-    {
-        for (int j = 8; j < Rank; j++)
-        {
-            squareA_MaskT[j][i] = squareA_Mask[i][j];
-        }
-    }
-    // Transpose data from last rows
-    for (int i = 8; i < Rank; i++)
+    // Transpose whole matrix using 4x4 tiles, last row and column of tiles overlap with previous ones
+    for (int i = 0; i < Rank; i += 4)
     {
-        for (int j = 0; j < Rank; j++)
+        for (int j = 0; j < Rank; j += 4)
         {
-            squareA_MaskT[j][i] = squareA_Mask[i][j];
+            const int srcRow = (i + 4 <= Rank) ? i : Rank - 4;
+            const int srcCol = (j + 4 <= Rank) ? j : Rank - 4;
+            transposeMatrix4x4(srcRow, srcCol, srcCol, srcRow);
         }
     }
-#endif // !__aarch64__
 #else
     // Non-SIMD code does not use squareA_MaskT, so nothing here
 
@@ -1283,9 +1815,13 @@ void RakeSearch::GenerateSquareMasks()
 }
 
 // Permute the rows of the given DLS, trying to find ODLS for it
-void RakeSearch::PermuteRows()
+template <int RankT> void RakeSearch<RankT>::PermuteRows()
 {
-    static_assert(Rank <= 16, "Function needs update for Rank 17+");
+    if (IsWideMask)
+    {
+        PermuteRowsWide();
+        return;
+    }
 
     // Masks for rowUsage which exclude current row for rows beside 1st one.
     // This is done to prevent generation of squares which has some rows unpermuted.
@@ -1344,7 +1880,7 @@ void RakeSearch::PermuteRows()
     const uint16x4_t vPowersOf2_1 = vld1_u16(powersOf2);
     const uint16x4_t vPowersOf2_2 = vld1_u16(powersOf2 + 4);
     const uint16x4_t vPowersOf2_3 = vld1_u16(powersOf2 + 8);
-    static_assert(Rank <= 12, "ARM NEON code needs more vector(s) for Ranks 13+");
+    const uint16x4_t vPowersOf2_4 = vld1_u16(powersOf2 + 12);
 #endif
 #endif
 
@@ -1634,6 +2170,19 @@ void RakeSearch::PermuteRows()
                 vCol1a = vorr_u16(vCol1a, vCol1b);
                 vCol1a = vorr_u16(vCol1a, vCol1c);
 
+                // Ranks 13+ need 4th vector
+                if (Rank > 12)
+                {
+                    uint16x4_t vCol1d = vld1_u16((const uint16_t*)&squareA_MaskT[currentRowId][12]);
+                    uint16x4_t vCol2d = vld1_u16((const uint16_t*)&squareA_MaskT[Rank - 1 - currentRowId][12]);
+                    vCol1d = vand_u16(vCol1d, vDiagMask1);
+                    vCol2d = vand_u16(vCol2d, vDiagMask2);
+                    vCol1d = vorr_u16(vCol1d, vCol2d);
+                    vCol1d = vceq_u16(vCol1d, vdup_n_u16(0));
+                    vCol1d = vand_u16(vCol1d, vPowersOf2_4);
+                    vCol1a = vorr_u16(vCol1a, vCol1d);
+                }
+
                 uint64x1_t v = vpaddl_u32(vpaddl_u16(vCol1a));
                 uint32_t mask = vget_lane_u32(vreinterpret_u32_u64(v), 0);
 
@@ -1670,3 +2219,220 @@ void RakeSearch::PermuteRows()
         }
     }
 }
+
+// Generate bitmasks for Ranks 17+. Everything here is done by plain loops: compiler vectorizes them,
+// and time spent here is negligible compared to PermuteRowsWide() for such big squares.
+template <int RankT> void RakeSearch<RankT>::GenerateSquareMasksWide()
+{
+    for (int i = 0; i < Rank; i++)
+    {
+        for (int j = 0; j < Rank; j++)
+        {
+            squareA_Mask[i][j] = 1u << squareA[i][j];
+        }
+    }
+
+#if (defined(__AVX2__) && defined(HAS_SIMD)) || defined(UT_BUILD)
+    // Create transposed copy of squareA_Mask, only AVX2/AVX512 code uses it for Ranks 17+
+    for (int i = 0; i < Rank; i++)
+    {
+        for (int j = 0; j < Rank; j++)
+        {
+            squareA_MaskT[j][i] = squareA_Mask[i][j];
+        }
+    }
+#endif
+}
+
+// Get bitmask of rows which can be put at position rowId without duplicates on diagonals
+template <int RankT>
+inline unsigned int RakeSearch<RankT>::GetRowCandidatesWide(int rowId, unsigned int diagonalValues1,
+                                                            unsigned int diagonalValues2)
+{
+    unsigned int mask = 0;
+
+#if defined(__AVX512F__) && defined(HAS_SIMD)
+    // Process 16 rows at once using 32-bit lanes. Unlike in GenerateSquareMasks(), ZMM registers
+    // are worth using here, for Ranks 17+ most of time is spent in this function.
+    // Lanes after Rank are zero, what gives extra candidates there, caller removes them by ANDing
+    // result with rowsUsage.
+    const __m512i vDiagMask1 = _mm512_set1_epi32(diagonalValues1);
+    const __m512i vDiagMask2 = _mm512_set1_epi32(diagonalValues2);
+
+    for (int n = 0; n < Rank; n += 16)
+    {
+        // load bitmasks for columns which will be on diagonals
+        __m512i vCol1 = _mm512_load_si512((const __m512i*)&squareA_MaskT[rowId][n]);
+        __m512i vCol2 = _mm512_load_si512((const __m512i*)&squareA_MaskT[Rank - 1 - rowId][n]);
+
+        // non-zero means that number is duplicated, zero means that it is unique
+        vCol1 = _mm512_or_si512(_mm512_and_si512(vCol1, vDiagMask1), _mm512_and_si512(vCol2, vDiagMask2));
+
+        // check if result is zero and get result as a bitmask
+        mask |= (unsigned int)_mm512_testn_epi32_mask(vCol1, vCol1) << n;
+    }
+#elif defined(__AVX2__) && defined(HAS_SIMD)
+    // Process 8 rows at once using 32-bit lanes, extra lanes after Rank are handled as above
+    const __m256i vDiagMask1 = _mm256_set1_epi32(diagonalValues1);
+    const __m256i vDiagMask2 = _mm256_set1_epi32(diagonalValues2);
+
+    for (int n = 0; n < Rank; n += 8)
+    {
+        // load bitmasks for columns which will be on diagonals
+        __m256i vCol1 = _mm256_load_si256((const __m256i*)&squareA_MaskT[rowId][n]);
+        __m256i vCol2 = _mm256_load_si256((const __m256i*)&squareA_MaskT[Rank - 1 - rowId][n]);
+
+        // non-zero means that number is duplicated, zero means that it is unique
+        vCol1 = _mm256_or_si256(_mm256_and_si256(vCol1, vDiagMask1), _mm256_and_si256(vCol2, vDiagMask2));
+
+        // check if result is zero, and get one bit per 32-bit lane
+        vCol1 = _mm256_cmpeq_epi32(vCol1, _mm256_setzero_si256());
+        mask |= (unsigned int)_mm256_movemask_ps(_mm256_castsi256_ps(vCol1)) << n;
+    }
+#else
+    // Other targets have too short vectors to gain anything here, so check rows one by one
+    for (int n = 0; n < Rank; n++)
+    {
+        if (0 == ((squareA_Mask[n][rowId] & diagonalValues1) | (squareA_Mask[n][Rank - 1 - rowId] & diagonalValues2)))
+        {
+            mask |= 1u << n;
+        }
+    }
+#endif
+
+    return mask;
+}
+
+// Permute the rows of the given DLS for Ranks 17+. This is the same algorithm as PermuteRows() uses
+// for SIMD builds: duplicates on diagonals are checked for all rows when stepping forward to the next
+// row, and remaining rows are saved as candidates.
+template <int RankT> void RakeSearch<RankT>::PermuteRowsWide()
+{
+    int currentSquareRows[Rank];
+    unsigned int rowsHistoryFlags[Rank];
+    unsigned int diagonalValuesHistory[Rank][2];
+
+    int currentRowId;
+    int gettingRowId;
+
+    unsigned int diagonalValues1, diagonalValues2;
+    unsigned int rowsUsage;     // Flags of the rows usage at the current moment, 0 means the row is already used
+    unsigned int rowCandidates; // Rows which still have to be checked
+
+    // Mark the usage of the 1st row, because it is fixed
+    rowsUsage = AllFree & ~1u;
+    currentSquareRows[0] = 0;
+
+    // Start from 0th row and mark it as the only candidate in order to perform duplicate check for 1st row
+    currentRowId = 0;
+    rowCandidates = 1;
+
+    // Set bits for diagonal values in 1st row. 1st row always has values 0,1,2,3...
+    diagonalValues1 = 1;
+    diagonalValues2 = 1u << (Rank - 1);
+
+    diagonalValuesHistory[0][0] = diagonalValues1;
+    diagonalValuesHistory[0][1] = diagonalValues2;
+
+    // 1st loop - handle case when at least one row candidate is present
+    while (1)
+    {
+        while (1)
+        {
+            gettingRowId = __builtin_ctz(rowCandidates);
+
+            // Get bits for current row
+            unsigned int bit1 = squareA_Mask[gettingRowId][currentRowId];
+            unsigned int bit2 = squareA_Mask[gettingRowId][Rank - 1 - currentRowId];
+
+            // Mark the row in the history of the used rows
+            ClearBit(rowCandidates, gettingRowId);
+
+            // Write the row into the array of the current rows
+            currentSquareRows[currentRowId] = gettingRowId;
+
+            // Step forward depending on the current position
+            if (currentRowId == Rank - 1)
+            {
+                // Write rows into the square in correct order
+                for (int n = 0; n < Rank; ++n)
+                {
+                    memcpy(&squareB[n][0], &squareA[currentSquareRows[n]][0], Rank * sizeof(squareB[n][0]));
+                }
+
+                // Process the found square
+                ProcessOrthoSquare();
+                break;
+            }
+            else
+            {
+                // Save new bitmasks for diagonal values for further use
+                diagonalValues1 |= bit1;
+                diagonalValues2 |= bit2;
+                diagonalValuesHistory[currentRowId][0] = diagonalValues1;
+                diagonalValuesHistory[currentRowId][1] = diagonalValues2;
+
+                // Save remaining candidates in row history
+                rowsHistoryFlags[currentRowId] = rowCandidates;
+
+                // Mark the row in the array of the used rows
+                ClearBit(rowsUsage, gettingRowId);
+
+                // Step forward
+                currentRowId++;
+
+                // Get new candidates, excluding current row to skip squares with unpermuted rows
+                rowCandidates = GetRowCandidatesWide(currentRowId, diagonalValues1, diagonalValues2) & rowsUsage &
+                                ~(1u << currentRowId);
+                if (!rowCandidates)
+                    break;
+            }
+        }
+
+        // 2nd loop - handle case when there are no row candidates
+        while (1)
+        {
+            // Step backward
+            currentRowId--;
+            // Check if we are done
+            if (0 == currentRowId)
+                return;
+            // Get saved values for previous row
+            diagonalValues1 = diagonalValuesHistory[currentRowId - 1][0];
+            diagonalValues2 = diagonalValuesHistory[currentRowId - 1][1];
+            // Clear the flag of row usage
+            SetBit(rowsUsage, currentSquareRows[currentRowId]);
+            // Get saved candidates
+            rowCandidates = rowsHistoryFlags[currentRowId];
+            if (rowCandidates)
+                break;
+        }
+    }
+}
+
+// Explicit instantiations for all supported ranks. Rank is selected at runtime from the workunit.
+template class RakeSearch<8>;
+template class RakeSearch<9>;
+template class RakeSearch<10>;
+template class RakeSearch<11>;
+template class RakeSearch<12>;
+template class RakeSearch<13>;
+template class RakeSearch<14>;
+template class RakeSearch<15>;
+template class RakeSearch<16>;
+template class RakeSearch<17>;
+template class RakeSearch<18>;
+template class RakeSearch<19>;
+template class RakeSearch<20>;
+template class RakeSearch<21>;
+template class RakeSearch<22>;
+template class RakeSearch<23>;
+template class RakeSearch<24>;
+template class RakeSearch<25>;
+template class RakeSearch<26>;
+template class RakeSearch<27>;
+template class RakeSearch<28>;
+template class RakeSearch<29>;
+template class RakeSearch<30>;
+template class RakeSearch<31>;
+template class RakeSearch<32>;
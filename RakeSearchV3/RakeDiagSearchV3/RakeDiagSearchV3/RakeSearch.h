@@ -7,21 +7,33 @@
 #include <string>
 #include <vector>
 #include <array>
+#include <csignal>
+#include <cstdint>
+#include <type_traits>
 #include "Helpers.h"
 #include "boinc_api.h"
 #include "Square.h"
 
 using namespace std;
 
-class RakeSearch
+// Request donation of the rest of workunit, can be called from signal handler
+void RequestWorkDonation();
+
+template <int RankT> class RakeSearch
 {
 public:
-    static const int Rank = Square::Rank; // Ранг обрабатываемых квадратов
+    static const int Rank = RankT; // Ранг обрабатываемых квадратов
+
+    static_assert((Rank >= 8) && (Rank <= 32), "Update RankAligned to match SIMD vector length used in PermuteRows()");
 
-    static_assert((Rank >= 9) && (Rank <= 16), "Update RankAligned to match SIMD vector length used in PermuteRows()");
-    static const int RankAligned = 16;
+    // Ranks 17+ do not fit into 16-bit masks, they use 32-bit ones and PermuteRowsWide()
+    static const bool IsWideMask = Rank > 16;
+    static const int RankAligned = IsWideMask ? 32 : 16;
+    typedef typename std::conditional<IsWideMask, uint32_t, uint16_t>::type TransposedMask;
+    typedef typename std::conditional<IsWideMask, uint32_t, uint16_t>::type ValueMask; // Mask of values of cell
 
-    static const int MaxPathPrefixes = 9;
+    // Larger ranks have much more values per cell, so shorter prefixes keep their number reasonable
+    static const int MaxPathPrefixes = IsWideMask ? 4 : 9;
 
     RakeSearch(); // Конструктор по умолчанию
     UT_VIRTUAL ~RakeSearch() = default;
@@ -31,6 +43,14 @@ public:
                       const string& temp); // Задание имен файлов параметров и контрольной точки
     void Initialize(const string& start, const string& result, const string& checkpoint,
                     const string& temp); // Инициализация поиска
+    void SplitWorkunit(const string& start, int parts,
+                       const string& partPrefix); // Split workunit into parts with ranges of path prefixes
+    void CountSquares(const string& start, int threads); // Count squares of workunit for every path prefix
+    void LoadWorkunit(const string& start);              // Read workunit and generate its path prefixes
+    // Check that square matches preset cells of loaded workunit and its path prefix is in range of workunit
+    bool IsSquareOfWorkunit(const Square<Rank>& square) const;
+    // Check that square a is generated before square b: values of path cells are compared in path order
+    bool IsBeforeInPath(const Square<Rank>& a, const Square<Rank>& b) const;
 
 private:
     static const int Yes = 1;                      // Флаг "Да"
@@ -39,14 +59,17 @@ private:
     static const bool isDebug = true;              // Флаг вывода отладочной информации
     static const int CheckpointInterval = 1 << 20; // Интервал создания контрольных точек
     static const int OrhoSquaresCacheSize = 128; // Размер кэша для хранения квадратов, ортогональных обрабатываемому
-    static const int MinOrthoMetric =
-        81; // Минимальное значение характеристики ортогональности при котором пара записывается в результат
+    // Минимальное значение характеристики ортогональности при котором пара записывается в результат
+    static const int MinOrthoMetric = (Rank - 1) * (Rank - 1);
+    static const int DefaultDonationParts = 4; // Number of workunits created by work donation by default
 
     string startParametersFileName; // Название файла с параметрами запуска расчёта
     string resultFileName;          // Название файла с результатами
     string checkpointFileName;      // Название файла контрольной точки
     string tempCheckpointFileName; // Временное название файла новой контрольной точки
     string workunitHeader; // Заголовок данных файла с заданиями или файла контрольной точки
+    string prefixRangeHeader; // Header of optional range of path prefixes in workunit or checkpoint file
+    string donationFileName;  // Name of file which triggers work donation, may contain number of parts
 
     int isInitialized;         // Флаг успешной инициализации поиска
     int isStartFromCheckpoint; // Флаг запуска с контрольной точки
@@ -63,12 +86,25 @@ private:
 
     unsigned int flagsPrimary; // "Массив" флагов-битов задействования значений на главной диагонали
     unsigned int flagsSecondary; // "Массив" флагов-битов задействования значений на побочной диагонали
-    unsigned int flagsColumns
+
+    // Hot state of StartImpl. Masks of rows, columns and history of path cells are placed together,
+    // history is kept in path order, so it does not depend on loading of cell coordinates.
+    struct PathCell
+    {
+        uint8_t rowId;    // Row of path cell
+        uint8_t columnId; // Column of path cell
+        uint16_t offset;  // Index of cell in squareA: rowId * Rank + columnId
+    };
+    ValueMask flagsColumns
         [Rank]; // "Матрица" значений, использовавшихся в столбцах - columns[значение][столбец] = 0|1. 0 - значение занято. 1 - свободно.
-    unsigned int flagsRows[Rank]; // "Матрица" значений, использовавшихся в строках - rows[строка][значение] = 0|1
-    unsigned int flagsCellsHistory
-        [Rank]
-        [Rank]; // "Куб" значений, которые использовались для формирования построенной части квадрата - cellsHistory[строка][столбец][значение]
+    ValueMask flagsRows[Rank]; // "Матрица" значений, использовавшихся в строках - rows[строка][значение] = 0|1
+    ValueMask pathHistory[MaxCellsInPath]; // Remaining candidates of path cells - pathHistory[номер клетки пути]
+    PathCell pathCells[MaxCellsInPath];    // Coordinates of path cells packed into bytes
+    void SetupPathCells(); // Fill pathCells from path and pathHistory from history of cells
+
+    // "Куб" значений, которые использовались для формирования построенной части квадрата - cellsHistory[строка][столбец][значение].
+    // History of path cells is kept in pathHistory, here it is stored in format of workunit and checkpoint files only.
+    unsigned int flagsCellsHistory[Rank][Rank];
 
     int pairsCount; // Число обнаруженных диагональных квадратов в перестановках строк из найденного squareA
     int totalPairsCount; // Общее число обнаруженных диагональных квадратов - в рамках всего поиска
@@ -78,11 +114,14 @@ private:
     int squareB[Rank][Rank] ALIGNED; // Второй возможный ДЛК пары, получаемый перестановкой строк
     int squareA_Mask[Rank][Rank] ALIGNED; // Bitmasks for values in squareA
 #if defined(HAS_SIMD) || defined(UT_BUILD)
-    uint16_t squareA_MaskT[Rank][RankAligned] ALIGNED; // Transposed copy of squareA_Mask
+    TransposedMask squareA_MaskT[Rank][RankAligned] ALIGNED; // Transposed copy of squareA_Mask
 #endif
-    Square orthoSquares[OrhoSquaresCacheSize]; // Кэш для хранения квадратов, ортогональных обрабатываемому
+    Square<Rank> orthoSquares[OrhoSquaresCacheSize]; // Кэш для хранения квадратов, ортогональных обрабатываемому
 
     UT_VIRTUAL void PermuteRows(); // Перетасовка строк заданного ДЛК в поиске ОДЛК к нему
+    void PermuteRowsWide();        // PermuteRows() for Ranks 17+
+    // Rows which can be put at rowId without duplicates on diagonals, for Ranks 17+
+    unsigned int GetRowCandidatesWide(int rowId, unsigned int diagonalValues1, unsigned int diagonalValues2);
     UT_VIRTUAL void ProcessSquare(); // Обработка построенного первого квадрата возможной пары
     UT_VIRTUAL void ProcessOrthoSquare(); // Обработка найденного ортогонального квадрата
     void CheckMutualOrthogonality(); // Проверка взаимной ортогональности квадратов
@@ -91,15 +130,38 @@ private:
     void Write(std::ostream& os);    // Запись состояния поиска в поток
     void ShowSearchTotals();         // Отображение общих итогов поиска
 
-#if defined(__ARM_NEON) && !defined(__aarch64__) && defined(HAS_SIMD)
+#if (defined(__SSE2__) || defined(__aarch64__)) && defined(HAS_SIMD)
+    void transposeMatrix8x8(int srcRow, int srcCol, int destRow, int destCol);
+#elif defined(__ARM_NEON) && defined(HAS_SIMD)
     void transposeMatrix4x4(int srcRow, int srcCol, int destRow, int destCol);
 #endif
 
-    template <typename IsKeyValueEmpty> void StartImpl(); // Actual implementation of the squares generation
+    template <typename IsKeyValueEmpty, typename IsPrefixRangeLimited, typename IsCountOnly = false_type>
+    void StartImpl(); // Actual implementation of the squares generation
 
     void GenerateSquareMasks();
+    void GenerateSquareMasksWide(); // GenerateSquareMasks() for Ranks 17+
 
     vector<array<int, MaxPathPrefixes>> pathPrefixes;
     int pathPrefixPos = 0;
     void GeneratePathPrefixes(array<int, MaxPathPrefixes>& tmp, int pathPos);
+
+    // Optional range [prefixRangeStart, prefixRangeEnd) of path prefixes processed by workunit.
+    // Values are indexes in pathPrefixes, prefixRangeEnd = -1 means end of the workunit.
+    int prefixRangeStart;
+    int prefixRangeEnd;
+    void SetupPathPrefixRange();         // Check range of path prefixes and move to its start if needed
+    void ApplyPathPrefix(int prefixId);  // Fill first path cells with values from given path prefix
+    bool IsPathPrefixReached(int prefixId) const; // Check if current square reached given path prefix
+    void WriteWorkunitParts(int rangeStart, int rangeEnd, int parts,
+                            const string& partPrefix); // Write workunit parts for given range of path prefixes
+
+    int CheckWorkDonationRequest(); // Get number of parts to donate, or 0 when donation was not requested
+    void DonateWork(int parts);     // Write unprocessed path prefixes into new workunits and stop before them
+
+    // Number of last path cells which are skipped by counting of squares. They lie in one row or column,
+    // so when all other cells are filled, values of these cells are forced by columns or rows.
+    int forcedCellsCount;
+    void SetupForcedCells();                          // Find forced cells at the end of path
+    unsigned long long CountPathPrefix(int prefixId); // Count squares with given path prefix
 };
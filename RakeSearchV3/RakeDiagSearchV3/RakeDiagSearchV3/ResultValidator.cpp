@@ -0,0 +1,554 @@
+// Validation of result files without repeating the search: every reported pair is rechecked
+// against workunit the result belongs to
+
+#include "ResultValidator.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+
+// Note: shift by 32 is undefined, so shift all-ones mask right instead
+#define AllBitsMask(numbits) (~0u >> (32 - (numbits)))
+
+// Read workunit which results are validated against
+template <int RankT> void ResultValidator<RankT>::LoadWorkunit(const string& start)
+{
+    workunit.LoadWorkunit(start);
+}
+
+// Check that rows, columns and both diagonals of square have no duplicates. Every line is checked by
+// bitmask of its values, so whole square takes Rank * Rank shifts and ORs which compiler vectorizes.
+template <int RankT> bool ResultValidator<RankT>::IsDiagonalLatin(const Cells& square)
+{
+    uint32_t rows[Rank] = {0};
+    uint32_t columns[Rank] = {0};
+    uint32_t primary = 0;
+    uint32_t secondary = 0;
+    uint32_t missing = 0;
+
+    for (int r = 0; r < Rank; r++)
+    {
+        for (int c = 0; c < Rank; c++)
+        {
+            uint32_t bit = 1u << square[r * Rank + c];
+            rows[r] |= bit;
+            columns[c] |= bit;
+        }
+        primary |= 1u << square[r * Rank + r];
+        secondary |= 1u << square[r * Rank + Rank - 1 - r];
+    }
+
+    // Line of Rank cells without duplicates contains all Rank values
+    for (int n = 0; n < Rank; n++)
+    {
+        missing |= (rows[n] ^ AllBitsMask(Rank)) | (columns[n] ^ AllBitsMask(Rank));
+    }
+    missing |= (primary ^ AllBitsMask(Rank)) | (secondary ^ AllBitsMask(Rank));
+
+    return 0 == missing;
+}
+
+// Degree of orthogonality: number of different pairs of values in cells of squares, the same metric as
+// Square::OrthoDegree. Pairs are collected as bitmasks of values of b for every value of a.
+template <int RankT> int ResultValidator<RankT>::OrthoDegree(const Cells& a, const Cells& b)
+{
+    uint32_t pairs[Rank] = {0};
+    int degree = 0;
+
+    for (int n = 0; n < Rank * Rank; n++)
+    {
+        pairs[a[n]] |= 1u << b[n];
+    }
+    for (int n = 0; n < Rank; n++)
+    {
+        degree += __builtin_popcount(pairs[n]);
+    }
+
+    return degree;
+}
+
+// Check that b consists of rows of Latin square a, every row is used once. Rows of Latin square differ
+// in every column, so row of a is found by its first value.
+template <int RankT> bool ResultValidator<RankT>::IsRowPermutation(const Cells& a, const Cells& b)
+{
+    int rowOfValue[Rank];
+    uint32_t usedRows = 0;
+
+    for (int r = 0; r < Rank; r++)
+    {
+        rowOfValue[a[r * Rank]] = r;
+    }
+
+    for (int r = 0; r < Rank; r++)
+    {
+        int sourceRow = rowOfValue[b[r * Rank]];
+        if (0 != memcmp(&a[sourceRow * Rank], &b[r * Rank], Rank))
+        {
+            return false;
+        }
+        usedRows |= 1u << sourceRow;
+    }
+
+    return AllBitsMask(Rank) == usedRows;
+}
+
+// Read square "{ a b c ... }". Square must have exactly Rank * Rank values from 0 to Rank - 1.
+template <int RankT> bool ResultValidator<RankT>::ParseSquare(const char*& position, const char* end, Cells& square)
+{
+    int cellsCount = 0;
+
+    // Skip opening brace
+    position++;
+
+    while ((position < end) && (*position != '}'))
+    {
+        if ((*position >= '0') && (*position <= '9'))
+        {
+            int value = 0;
+            while ((position < end) && (*position >= '0') && (*position <= '9') && (value < Rank))
+            {
+                value = value * 10 + (*position - '0');
+                position++;
+            }
+            if ((value >= Rank) || (cellsCount == Rank * Rank))
+            {
+                return false;
+            }
+            square[cellsCount++] = (uint8_t)value;
+        }
+        else if ((*position == ' ') || (*position == '\t') || (*position == '\r') || (*position == '\n'))
+        {
+            position++;
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    if (position == end)
+    {
+        return false;
+    }
+    position++;
+
+    return Rank * Rank == cellsCount;
+}
+
+// Convert compact copy of square to Square
+template <int RankT> Square<RankT> ResultValidator<RankT>::ToSquare(const Cells& cells)
+{
+    Square<Rank> square;
+
+    for (int r = 0; r < Rank; r++)
+    {
+        for (int c = 0; c < Rank; c++)
+        {
+            square.Matrix[r][c] = cells[r * Rank + c];
+        }
+    }
+
+    return square;
+}
+
+// Check square of block. The first square is square A: it must be diagonal Latin square of the workunit,
+// generated after square A of the previous block, so repeated blocks are rejected. Other squares are
+// squares B: each one must be diagonal Latin square made of rows of A, its degree of orthogonality with A
+// must be enough to get it into result, and it must differ from other squares B of the block.
+template <int RankT>
+const char* ResultValidator<RankT>::AddSquare(Block& block, const Cells& square, const Cells* previousA) const
+{
+    if (block.squares.empty())
+    {
+        if (!IsDiagonalLatin(square))
+        {
+            return "square A is not a diagonal Latin square";
+        }
+
+        Square<Rank> squareA = ToSquare(square);
+        if (!workunit.IsSquareOfWorkunit(squareA))
+        {
+            return "square A does not belong to the workunit";
+        }
+        if ((nullptr != previousA) && !workunit.IsBeforeInPath(ToSquare(*previousA), squareA))
+        {
+            return "square A does not follow square A of the previous block";
+        }
+
+        block.squares.push_back(square);
+        return nullptr;
+    }
+
+    const Cells& squareA = block.squares[0];
+
+    // Row permutation of Latin square is Latin, so only diagonals of B remain to be checked.
+    // Square A itself has degree Rank with A and is rejected by degree check.
+    if (!IsRowPermutation(squareA, square))
+    {
+        return "square B is not a row permutation of square A";
+    }
+    if (!IsDiagonalLatin(square))
+    {
+        return "square B is not a diagonal Latin square";
+    }
+
+    int degree = OrthoDegree(squareA, square);
+    if (degree < MinOrthoMetric)
+    {
+        return "degree of orthogonality of pair is too low";
+    }
+    if (!block.squaresB.insert(square).second)
+    {
+        return "square B is repeated in block";
+    }
+
+    block.pairsCount++;
+    if (1 == block.pairsCount)
+    {
+        block.firstDegree = degree;
+    }
+    if ((int)block.squares.size() < OrhoSquaresCacheSize)
+    {
+        block.squares.push_back(square);
+    }
+
+    return nullptr;
+}
+
+// Check comments of block against its squares: claimed degree of orthogonality of the first pair,
+// number of pairs, and list of fully orthogonal squares among squares cached by RakeSearch
+template <int RankT> const char* ResultValidator<RankT>::CloseBlock(const Block& block) const
+{
+    if (0 == block.pairsCount)
+    {
+        return "block without pairs";
+    }
+    if ((block.degree >= 0) && (block.degree != block.firstDegree))
+    {
+        return "claimed degree of orthogonality does not match the first pair";
+    }
+    if (block.pairsFound != block.pairsCount)
+    {
+        return "number of pairs in block does not match \"# Pairs found\"";
+    }
+
+    // RakeSearch writes pairs in order of indexes, so recomputed list must be the same
+    vector<pair<int, int>> mutualPairs;
+    for (int i = 0; i < (int)block.squares.size(); i++)
+    {
+        for (int j = i + 1; j < (int)block.squares.size(); j++)
+        {
+            if (Rank * Rank == OrthoDegree(block.squares[i], block.squares[j]))
+            {
+                mutualPairs.emplace_back(i, j);
+            }
+        }
+    }
+    if (mutualPairs != block.mutualPairs)
+    {
+        return "mutual orthogonality lines do not match the squares";
+    }
+
+    return nullptr;
+}
+
+// Read non-negative number after marker at position, returns -1 if there is no number
+static long long ParseNumber(const char* position, const char* lineEnd)
+{
+    long long value = -1;
+
+    while ((position < lineEnd) && (*position == ' '))
+    {
+        position++;
+    }
+    while ((position < lineEnd) && (*position >= '0') && (*position <= '9'))
+    {
+        value = (value < 0 ? 0 : value * 10) + (*position - '0');
+        position++;
+    }
+
+    return value;
+}
+
+// Check that line starts with marker, and move position after it
+static bool SkipMarker(const char*& position, const char* lineEnd, const char* marker)
+{
+    size_t length = strlen(marker);
+
+    if (((size_t)(lineEnd - position) < length) || (0 != memcmp(position, marker, length)))
+    {
+        return false;
+    }
+    position += length;
+
+    return true;
+}
+
+// Validate text of result. Result consists of blocks of pairs and totals:
+//   {                                         - start of block
+//   # Degree of orthogonality: D              - degree of the first pair
+//   { square A }
+//   { square B1 } { square B2 } ...           - squares B found by permutation of rows of A
+//   # Square i # j                            - fully orthogonal squares among A, B1, B2, ...
+//   # Pairs found: N
+//   }                                         - end of block
+//   # Total pairs found: N, # Total squares with pairs: N, # Processed N squares - totals
+// Totals of all totals blocks are summed, like the results aggregator does.
+template <int RankT> ResultValidation ResultValidator<RankT>::Validate(const char* data, size_t size) const
+{
+    ResultValidation validation;
+    const char* position = data;
+    const char* end = data + size;
+    const char* error = nullptr;
+    bool isInBlock = false;
+    long long totalPairs = 0;
+    long long totalSquaresWithPairs = 0;
+    int totalsCount = 0;
+    Block block;
+    Cells square;
+    Cells previousA;
+    bool hasPreviousA = false;
+
+    while ((position < end) && (nullptr == error))
+    {
+        const char* lineEnd = (const char*)memchr(position, '\n', end - position);
+        if (nullptr == lineEnd)
+        {
+            lineEnd = end;
+        }
+
+        while ((position < lineEnd) && ((*position == ' ') || (*position == '\t') || (*position == '\r')))
+        {
+            position++;
+        }
+
+        if (position == lineEnd)
+        {
+            // Empty line
+        }
+        else if ('#' == *position)
+        {
+            long long i, j;
+
+            if (SkipMarker(position, lineEnd, "# Degree of orthogonality:"))
+            {
+                block.degree = (int)ParseNumber(position, lineEnd);
+            }
+            else if (SkipMarker(position, lineEnd, "# Pairs found:"))
+            {
+                block.pairsFound = ParseNumber(position, lineEnd);
+            }
+            else if (SkipMarker(position, lineEnd, "# Square "))
+            {
+                i = ParseNumber(position, lineEnd);
+                position = (const char*)memchr(position, '#', lineEnd - position);
+                j = nullptr == position ? -1 : ParseNumber(position + 1, lineEnd);
+                if ((i < 0) || (j < 0))
+                {
+                    error = "invalid mutual orthogonality line";
+                }
+                block.mutualPairs.emplace_back((int)i, (int)j);
+            }
+            else if (SkipMarker(position, lineEnd, "# Total pairs found:"))
+            {
+                totalPairs += ParseNumber(position, lineEnd);
+                totalsCount++;
+            }
+            else if (SkipMarker(position, lineEnd, "# Total squares with pairs:"))
+            {
+                totalSquaresWithPairs += ParseNumber(position, lineEnd);
+            }
+            else if (SkipMarker(position, lineEnd, "# Processed "))
+            {
+                validation.processed += ParseNumber(position, lineEnd);
+            }
+        }
+        else if ('{' == *position)
+        {
+            if (!isInBlock)
+            {
+                isInBlock = true;
+                block = Block();
+            }
+            else
+            {
+                // Squares may share lines, so parsing continues right after the square
+                if (!ParseSquare(position, end, square))
+                {
+                    error = "invalid square";
+                }
+                else
+                {
+                    error = AddSquare(block, square, hasPreviousA ? &previousA : nullptr);
+                }
+                continue;
+            }
+        }
+        else if ('}' == *position)
+        {
+            if (!isInBlock)
+            {
+                error = "unexpected end of block";
+            }
+            else
+            {
+                isInBlock = false;
+                error = CloseBlock(block);
+                if (nullptr == error)
+                {
+                    validation.blocks++;
+                    validation.pairs += block.pairsCount;
+                    previousA = block.squares[0];
+                    hasPreviousA = true;
+                }
+            }
+        }
+        else
+        {
+            error = "unexpected text";
+        }
+
+        position = lineEnd + 1;
+    }
+
+    if ((nullptr == error) && isInBlock)
+    {
+        error = "unterminated block";
+    }
+    if ((nullptr == error) && (0 == totalsCount))
+    {
+        error = "no totals, search was not finished";
+    }
+    if ((nullptr == error) && ((totalPairs != validation.pairs) || (totalSquaresWithPairs != validation.blocks)))
+    {
+        error = "totals do not match blocks of pairs";
+    }
+
+    if (nullptr != error)
+    {
+        validation.isValid = false;
+        validation.error = error;
+    }
+
+    return validation;
+}
+
+// Validate one result file, it is read into memory at once
+template <int RankT> ResultValidation ResultValidator<RankT>::ValidateFile(const string& fileName) const
+{
+    ifstream resultFile(fileName.c_str(), std::ios_base::in | std::ios_base::binary);
+    string text;
+
+    if (!resultFile.is_open())
+    {
+        ResultValidation validation;
+        validation.isValid = false;
+        validation.error = "cannot open file";
+        return validation;
+    }
+
+    resultFile.seekg(0, std::ios_base::end);
+    text.resize((size_t)resultFile.tellg());
+    resultFile.seekg(0, std::ios_base::beg);
+    resultFile.read(&text[0], text.size());
+
+    return Validate(text.data(), text.size());
+}
+
+// Validate result files by given number of threads. Files are distributed between threads one by one,
+// report is printed in order of files. Returns number of invalid files.
+template <int RankT> int ResultValidator<RankT>::ValidateFiles(const vector<string>& fileNames, int threads)
+{
+    vector<ResultValidation> validations(fileNames.size());
+    std::atomic<int> nextFile(0);
+    auto startTime = std::chrono::steady_clock::now();
+
+    // Workunit is only read, so all threads share it
+    auto validateFiles = [&]()
+    {
+        int fileId;
+        while ((fileId = nextFile++) < (int)fileNames.size())
+        {
+            validations[fileId] = ValidateFile(fileNames[fileId]);
+        }
+    };
+
+    if (threads < 1)
+    {
+        threads = 1;
+    }
+    vector<std::thread> workers;
+    for (int i = 1; i < threads; i++)
+    {
+        workers.emplace_back(validateFiles);
+    }
+    validateFiles();
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+
+    int invalidCount = 0;
+    long long totalPairs = 0;
+    long long totalProcessed = 0;
+    for (size_t fileId = 0; fileId < fileNames.size(); fileId++)
+    {
+        const ResultValidation& validation = validations[fileId];
+
+        if (validation.isValid)
+        {
+            cout << fileNames[fileId] << ": OK, " << validation.pairs << " pairs, " << validation.processed
+                 << " squares" << endl;
+            totalPairs += validation.pairs;
+            totalProcessed += validation.processed;
+        }
+        else
+        {
+            cout << fileNames[fileId] << ": INVALID, " << validation.error << " (after " << validation.blocks
+                 << " blocks)" << endl;
+            invalidCount++;
+        }
+    }
+
+    std::chrono::duration<double> validationTime = std::chrono::steady_clock::now() - startTime;
+    cout << "# ------------------------" << endl;
+    cout << "# Valid results: " << fileNames.size() - invalidCount << " of " << fileNames.size() << endl;
+    cout << "# Pairs in valid results: " << totalPairs << endl;
+    cout << "# Squares processed by valid results: " << totalProcessed << endl;
+    cout << "# Validation time: " << fixed << setprecision(3) << validationTime.count() << " sec, threads: "
+         << threads << endl;
+    cout << "# ------------------------" << endl;
+
+    return invalidCount;
+}
+
+// Explicit instantiations for all supported ranks
+template class ResultValidator<8>;
+template class ResultValidator<9>;
+template class ResultValidator<10>;
+template class ResultValidator<11>;
+template class ResultValidator<12>;
+template class ResultValidator<13>;
+template class ResultValidator<14>;
+template class ResultValidator<15>;
+template class ResultValidator<16>;
+template class ResultValidator<17>;
+template class ResultValidator<18>;
+template class ResultValidator<19>;
+template class ResultValidator<20>;
+template class ResultValidator<21>;
+template class ResultValidator<22>;
+template class ResultValidator<23>;
+template class ResultValidator<24>;
+template class ResultValidator<25>;
+template class ResultValidator<26>;
+template class ResultValidator<27>;
+template class ResultValidator<28>;
+template class ResultValidator<29>;
+template class ResultValidator<30>;
+template class ResultValidator<31>;
+template class ResultValidator<32>;
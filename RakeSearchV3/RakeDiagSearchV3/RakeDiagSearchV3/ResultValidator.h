@@ -0,0 +1,71 @@
+// Validation of result files without repeating the search: every reported pair is rechecked
+// against workunit the result belongs to
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <set>
+#include <string>
+#include <vector>
+#include "Helpers.h"
+#include "RakeSearch.h"
+#include "Square.h"
+
+using namespace std;
+
+// Outcome of validation of one result file
+struct ResultValidation
+{
+    bool isValid = true;       // All checks passed
+    string error;              // Description of the first failed check
+    long long blocks = 0;      // Number of blocks of pairs (squares A)
+    long long pairs = 0;       // Number of checked pairs
+    long long processed = 0;   // Number of processed squares reported by result
+};
+
+template <int RankT> class ResultValidator
+{
+public:
+    static const int Rank = RankT;
+    typedef array<uint8_t, Rank * Rank> Cells; // Values of square by rows, compact copy of Square::Matrix
+
+    void LoadWorkunit(const string& start); // Read workunit which results are validated against
+    // Validate result files by given number of threads and print report, returns number of invalid files
+    int ValidateFiles(const vector<string>& fileNames, int threads);
+    ResultValidation ValidateFile(const string& fileName) const;         // Validate one result file
+    ResultValidation Validate(const char* data, size_t size) const;      // Validate text of result
+
+    // Rows, columns and both diagonals of square have no duplicates, values are checked by parser
+    static bool IsDiagonalLatin(const Cells& square);
+    static int OrthoDegree(const Cells& a, const Cells& b);      // Number of different pairs of values
+    static bool IsRowPermutation(const Cells& a, const Cells& b); // b consists of rows of a, a is Latin
+
+private:
+    // Minimal degree of orthogonality of pairs written by RakeSearch, and size of its cache of squares
+    // used by check of mutual orthogonality
+    static const int MinOrthoMetric = (Rank - 1) * (Rank - 1);
+    static const int OrhoSquaresCacheSize = 128;
+
+    // Block of pairs being parsed. Squares B are checked against square A as soon as they are read.
+    // Squares kept by RakeSearch in its cache are stored for check of mutual orthogonality, and all
+    // squares B are kept in set for check of duplicates.
+    struct Block
+    {
+        vector<Cells> squares;              // Square A followed by the first squares B
+        set<Cells> squaresB;                // All squares B, for check of duplicates
+        long long pairsCount = 0;           // Number of squares B
+        int firstDegree = -1;               // Degree of orthogonality of the first pair
+        int degree = -1;                    // "# Degree of orthogonality", -1 if absent (old results)
+        long long pairsFound = -1;          // "# Pairs found", -1 if absent
+        vector<pair<int, int>> mutualPairs; // "# Square i # j" lines
+    };
+
+    // Check square of block, returns error. Square A must follow square A of the previous block in path order.
+    const char* AddSquare(Block& block, const Cells& square, const Cells* previousA) const;
+    const char* CloseBlock(const Block& block) const;               // Check comments of block, returns error
+    static bool ParseSquare(const char*& position, const char* end, Cells& square);
+    static Square<RankT> ToSquare(const Cells& cells);
+
+    RakeSearch<Rank> workunit ALIGNED; // Loaded workunit, only read during validation
+};
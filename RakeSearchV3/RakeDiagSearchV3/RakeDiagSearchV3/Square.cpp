@@ -4,31 +4,31 @@
 using namespace std;
 
 // Конструктор по умолчанию. "Зануление" всех значений
-Square::Square()
+template <int RankT> Square<RankT>::Square()
 {
     Reset();
 }
 
 // Создание квадрата по заданной матрице
-Square::Square(int source[Rank][Rank])
+template <int RankT> Square<RankT>::Square(int source[Rank][Rank])
 {
     Initialize(source);
 }
 
 // Конструктор копирования
-Square::Square(const Square& source)
+template <int RankT> Square<RankT>::Square(const Square& source)
 {
     Initialize(source.Matrix);
 }
 
 // Инициализация внутренних структур
-void Square::Initialize(const int source[Rank][Rank])
+template <int RankT> void Square<RankT>::Initialize(const int source[Rank][Rank])
 {
     memcpy(Matrix, source, sizeof(Matrix));
 }
 
 // Сброс значений внутренних переменных
-void Square::Reset()
+template <int RankT> void Square<RankT>::Reset()
 {
     for (int rowId = 0; rowId < Rank; rowId++)
     {
@@ -40,37 +40,21 @@ void Square::Reset()
 }
 
 // Оператор сравнения
-int Square::operator==(const Square& value) const
+template <int RankT> int Square<RankT>::operator==(const Square& value) const
 {
     return 0 == memcmp(Matrix, value.Matrix, sizeof(Matrix));
 }
 
 // Оператор присвоения
-Square& Square::operator=(const Square& value)
+template <int RankT> Square<RankT>& Square<RankT>::operator=(const Square& value)
 {
     Initialize(value.Matrix);
 
     return *this;
 }
 
-// Оператор вывода данных квадрата
-std::ostream& operator<<(std::ostream& os, const Square& value)
-{
-    value.Write(os);
-
-    return os;
-}
-
-// Оператор считывания данных квадрата
-std::istream& operator>>(std::istream& is, Square& value)
-{
-    value.Read(is);
-
-    return is;
-}
-
 // Чтение квадрата из потока
-void Square::Read(std::istream& is)
+template <int RankT> void Square<RankT>::Read(std::istream& is)
 {
     char readedChar; // "Буфер", используемый для посимволного чтения
 
@@ -97,7 +81,7 @@ void Square::Read(std::istream& is)
 }
 
 // Запись квадрата в поток
-void Square::Write(std::ostream& os) const
+template <int RankT> void Square<RankT>::Write(std::ostream& os) const
 {
     // Запись символа начала блока информации
     os << HeadToken << endl;
@@ -117,7 +101,7 @@ void Square::Write(std::ostream& os) const
 }
 
 // Проверка квадрата на то, что он является диагональным латинским квадратом
-int Square::IsDiagonal() const
+template <int RankT> int Square<RankT>::IsDiagonal() const
 {
     int isDiagonal = 1;
 
@@ -151,7 +135,7 @@ int Square::IsDiagonal() const
 }
 
 // Проверка квадрата на то, что он является латинским квадратом
-int Square::IsLatin() const
+template <int RankT> int Square<RankT>::IsLatin() const
 {
     int isLatin = 1;
 
@@ -193,7 +177,7 @@ int Square::IsLatin() const
 }
 
 // Проверка ортогональности квадратов a и b
-int Square::OrthoDegree(const Square& a, const Square& b)
+template <int RankT> int Square<RankT>::OrthoDegree(const Square& a, const Square& b)
 {
     int degree = 0;           // Степерь ортогональности
     int freePair[Rank][Rank]; // Массив использования пар значений в получающемся греко-латинском квадрате
@@ -222,3 +206,30 @@ int Square::OrthoDegree(const Square& a, const Square& b)
 
     return degree;
 }
+
+// Explicit instantiations for all supported ranks
+template class Square<8>;
+template class Square<9>;
+template class Square<10>;
+template class Square<11>;
+template class Square<12>;
+template class Square<13>;
+template class Square<14>;
+template class Square<15>;
+template class Square<16>;
+template class Square<17>;
+template class Square<18>;
+template class Square<19>;
+template class Square<20>;
+template class Square<21>;
+template class Square<22>;
+template class Square<23>;
+template class Square<24>;
+template class Square<25>;
+template class Square<26>;
+template class Square<27>;
+template class Square<28>;
+template class Square<29>;
+template class Square<30>;
+template class Square<31>;
+template class Square<32>;
@@ -8,10 +8,10 @@
 
 using namespace std;
 
-class Square
+template <int RankT> class Square
 {
 public:
-    static const int Rank = 10;        // Ранг квадрата
+    static const int Rank = RankT;     // Ранг квадрата
     static const int Empty = -1;       // Пустое, не заданное значение
     static const char HeadToken = '{'; // Символ начала информации о квадрате в потоке
     static const char TailToken = '}'; // Символ окончания информации о квадрате в потоке
@@ -24,9 +24,20 @@ public:
 
     int operator==(const Square& value) const; // Перегрузка оператора сравнения - сравниваются компоненты матрицы
     Square& operator=(const Square& value);    // Перегрузка оператора присвоения
-    friend std::ostream& operator<<(std::ostream& os,
-                                    const Square& value); // Перегрузка оператора вывода данных квадрата
-    friend std::istream& operator>>(std::istream& is, Square& value); // Перегрузка оператора считывания данных квадрата
+    // Перегрузка оператора вывода данных квадрата
+    friend std::ostream& operator<<(std::ostream& os, const Square& value)
+    {
+        value.Write(os);
+
+        return os;
+    }
+    // Перегрузка оператора считывания данных квадрата
+    friend std::istream& operator>>(std::istream& is, Square& value)
+    {
+        value.Read(is);
+
+        return is;
+    }
 
     int IsDiagonal() const; // Проверка квадрата на то, что он является диагональным латинским квадратом
     int IsLatin() const; // Проверка квадрата на то, что он является латинским квадратом
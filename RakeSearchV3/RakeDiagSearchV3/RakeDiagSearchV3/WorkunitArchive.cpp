@@ -0,0 +1,560 @@
+// Packed archive of workunits created by RakeWuGeneratorV3
+
+#include "WorkunitArchive.h"
+#include <cstring>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static const char ArchiveMagic[8] = {'R', 'A', 'K', 'E', 'W', 'U', 'A', '1'};
+static const char IndexMagic[8] = {'R', 'A', 'K', 'E', 'W', 'U', 'I', 'X'};
+static const uint32_t ArchiveVersion = 1;
+static const uint64_t BlockSize = 256;   // Every BlockSize-th record is stored in full and indexed
+static const int FooterSize = 8 + 8 + 8; // Index offset, number of records, magic
+
+// Record flags
+static const int HasRange = 1;
+static const int HasEstimate = 2;
+static const int HasOrbitSize = 4;
+
+// Header flags
+static const uint32_t HeaderHasEstimates = 1;
+static const uint32_t HeaderHasOrbitSizes = 2;
+
+// All numbers are stored in little-endian byte order
+template <typename T> static void Put(string& buffer, T value)
+{
+    uint64_t v;
+    static_assert(sizeof(T) <= sizeof(v), "Unsupported type");
+    v = 0;
+    memcpy(&v, &value, sizeof(T));
+    for (size_t i = 0; i < sizeof(T); i++)
+    {
+        buffer.push_back((char)(v >> (8 * i)));
+    }
+}
+
+template <typename T> static T Get(const unsigned char* data, size_t size, size_t& pos)
+{
+    uint64_t v = 0;
+    T value;
+
+    if (pos + sizeof(T) > size)
+    {
+        throw("Workunit archive is truncated.");
+    }
+    for (size_t i = 0; i < sizeof(T); i++)
+    {
+        v |= (uint64_t)data[pos + i] << (8 * i);
+    }
+    pos += sizeof(T);
+    memcpy(&value, &v, sizeof(T));
+
+    return value;
+}
+
+WorkunitArchiveWriter::~WorkunitArchiveWriter()
+{
+    if (file.is_open())
+    {
+        Close();
+    }
+}
+
+void WorkunitArchiveWriter::Open(const string& fileName, const WorkunitArchiveHeader& archiveHeader)
+{
+    const int cellsCount = archiveHeader.rank * archiveHeader.rank;
+
+    header = archiveHeader;
+    index.clear();
+    previousValues.clear();
+    recordsCount = 0;
+    buffer.clear();
+
+    file.open(fileName.c_str(), std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+    if (!file.is_open())
+    {
+        throw("Cannot create workunit archive.");
+    }
+
+    buffer.append(ArchiveMagic, sizeof(ArchiveMagic));
+    Put<uint32_t>(buffer, ArchiveVersion);
+    Put<uint32_t>(buffer, header.rank);
+    Put<uint32_t>(buffer, header.path.size());
+    Put<uint32_t>(buffer, header.workunitPath.size());
+    Put<int32_t>(buffer, header.keyRowId);
+    Put<int32_t>(buffer, header.keyColumnId);
+    Put<uint32_t>(buffer, (header.hasEstimates ? HeaderHasEstimates : 0) | (header.hasOrbitSizes ? HeaderHasOrbitSizes : 0));
+    Put<double>(buffer, header.nodeCost);
+    Put<int64_t>(buffer, header.firstNumber);
+    for (int i = 0; i < cellsCount; i++)
+    {
+        Put<int8_t>(buffer, header.square[i]);
+    }
+    for (int i = 0; i < cellsCount; i++)
+    {
+        Put<uint32_t>(buffer, header.history[i]);
+    }
+    for (const array<int, 2>& cell : header.path)
+    {
+        Put<uint8_t>(buffer, cell[0]);
+        Put<uint8_t>(buffer, cell[1]);
+    }
+    for (const array<int, 2>& cell : header.workunitPath)
+    {
+        Put<uint8_t>(buffer, cell[0]);
+        Put<uint8_t>(buffer, cell[1]);
+    }
+
+    file.write(buffer.data(), buffer.size());
+    offset = buffer.size();
+    buffer.clear();
+}
+
+// Record: number of cells same as in previous record, number of filled generator cells, flags,
+// values of changed cells, optional path prefix range, estimated size of search tree and orbit size
+void WorkunitArchiveWriter::Add(const WorkunitArchiveRecord& record)
+{
+    size_t common = 0;
+    int flags = 0;
+
+    if (recordsCount % BlockSize == 0)
+    {
+        index.push_back(offset + buffer.size());
+    }
+    else
+    {
+        while (common < record.values.size() && common < previousValues.size() &&
+               record.values[common] == previousValues[common])
+        {
+            common++;
+        }
+    }
+
+    if (record.rangeEnd >= 0)
+    {
+        flags |= HasRange;
+    }
+    if (header.hasEstimates)
+    {
+        flags |= HasEstimate;
+    }
+    if (header.hasOrbitSizes)
+    {
+        flags |= HasOrbitSize;
+    }
+
+    Put<uint8_t>(buffer, common);
+    Put<uint8_t>(buffer, record.values.size());
+    Put<uint8_t>(buffer, flags);
+    for (size_t i = common; i < record.values.size(); i++)
+    {
+        Put<uint8_t>(buffer, record.values[i]);
+    }
+    if (flags & HasRange)
+    {
+        Put<int32_t>(buffer, record.rangeStart);
+        Put<int32_t>(buffer, record.rangeEnd);
+    }
+    if (flags & HasEstimate)
+    {
+        Put<double>(buffer, record.estimatedNodes);
+    }
+    if (flags & HasOrbitSize)
+    {
+        Put<uint32_t>(buffer, record.orbitSize);
+    }
+
+    previousValues = record.values;
+    recordsCount++;
+
+    if (buffer.size() >= (1 << 20))
+    {
+        file.write(buffer.data(), buffer.size());
+        offset += buffer.size();
+        buffer.clear();
+    }
+}
+
+void WorkunitArchiveWriter::Close()
+{
+    uint64_t indexOffset = offset + buffer.size();
+
+    for (uint64_t value : index)
+    {
+        Put<uint64_t>(buffer, value);
+    }
+    Put<uint64_t>(buffer, indexOffset);
+    Put<uint64_t>(buffer, recordsCount);
+    buffer.append(IndexMagic, sizeof(IndexMagic));
+
+    file.write(buffer.data(), buffer.size());
+    offset += buffer.size();
+    buffer.clear();
+    file.close();
+}
+
+WorkunitArchiveReader::~WorkunitArchiveReader()
+{
+    Close();
+}
+
+void WorkunitArchiveReader::Open(const string& fileName)
+{
+    Close();
+
+#ifdef _WIN32
+    HANDLE hFile = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                               FILE_ATTRIBUTE_NORMAL, NULL);
+    if (hFile == INVALID_HANDLE_VALUE)
+    {
+        throw("Cannot open workunit archive.");
+    }
+    LARGE_INTEGER fileSize;
+    GetFileSizeEx(hFile, &fileSize);
+    HANDLE hMapping = CreateFileMappingA(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+    fileHandle = hFile;
+    mappingHandle = hMapping;
+    if (hMapping == NULL)
+    {
+        Close();
+        throw("Cannot map workunit archive.");
+    }
+    size = (size_t)fileSize.QuadPart;
+    data = (const unsigned char*)MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+#else
+    int fd = open(fileName.c_str(), O_RDONLY);
+    struct stat fileStat;
+    if (fd < 0)
+    {
+        throw("Cannot open workunit archive.");
+    }
+    if (fstat(fd, &fileStat) != 0)
+    {
+        close(fd);
+        throw("Cannot open workunit archive.");
+    }
+    size = fileStat.st_size;
+    void* mapping = size > 0 ? mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    close(fd);
+    data = mapping != MAP_FAILED ? (const unsigned char*)mapping : nullptr;
+#endif
+    if (data == nullptr)
+    {
+        Close();
+        throw("Cannot map workunit archive.");
+    }
+
+    // Header
+    size_t pos = 0;
+    if ((size < sizeof(ArchiveMagic) + FooterSize) || (0 != memcmp(data, ArchiveMagic, sizeof(ArchiveMagic))) ||
+        (0 != memcmp(data + size - sizeof(IndexMagic), IndexMagic, sizeof(IndexMagic))))
+    {
+        Close();
+        throw("Invalid workunit archive.");
+    }
+    pos += sizeof(ArchiveMagic);
+
+    if (Get<uint32_t>(data, size, pos) != ArchiveVersion)
+    {
+        Close();
+        throw("Unsupported workunit archive version.");
+    }
+    header.rank = Get<uint32_t>(data, size, pos);
+    int cellsInPath = Get<uint32_t>(data, size, pos);
+    int workunitCellsInPath = Get<uint32_t>(data, size, pos);
+    header.keyRowId = Get<int32_t>(data, size, pos);
+    header.keyColumnId = Get<int32_t>(data, size, pos);
+    uint32_t headerFlags = Get<uint32_t>(data, size, pos);
+    header.hasEstimates = (headerFlags & HeaderHasEstimates) != 0;
+    header.hasOrbitSizes = (headerFlags & HeaderHasOrbitSizes) != 0;
+    header.nodeCost = Get<double>(data, size, pos);
+    header.firstNumber = Get<int64_t>(data, size, pos);
+
+    const int cellsCount = header.rank * header.rank;
+    if ((header.rank < 1) || (header.rank > 32) || (cellsInPath > cellsCount) || (workunitCellsInPath > cellsCount))
+    {
+        Close();
+        throw("Invalid workunit archive.");
+    }
+    header.square.resize(cellsCount);
+    header.history.resize(cellsCount);
+    header.path.resize(cellsInPath);
+    header.workunitPath.resize(workunitCellsInPath);
+    for (int i = 0; i < cellsCount; i++)
+    {
+        header.square[i] = Get<int8_t>(data, size, pos);
+    }
+    for (int i = 0; i < cellsCount; i++)
+    {
+        header.history[i] = Get<uint32_t>(data, size, pos);
+    }
+    for (array<int, 2>& cell : header.path)
+    {
+        cell[0] = Get<uint8_t>(data, size, pos);
+        cell[1] = Get<uint8_t>(data, size, pos);
+    }
+    for (array<int, 2>& cell : header.workunitPath)
+    {
+        cell[0] = Get<uint8_t>(data, size, pos);
+        cell[1] = Get<uint8_t>(data, size, pos);
+    }
+    recordsOffset = pos;
+
+    // Footer
+    pos = size - FooterSize;
+    indexOffset = Get<uint64_t>(data, size, pos);
+    recordsCount = Get<uint64_t>(data, size, pos);
+    if ((indexOffset < recordsOffset) ||
+        (indexOffset + (recordsCount + BlockSize - 1) / BlockSize * sizeof(uint64_t) != size - FooterSize))
+    {
+        Close();
+        throw("Invalid workunit archive.");
+    }
+}
+
+void WorkunitArchiveReader::Close()
+{
+#ifdef _WIN32
+    if (data != nullptr)
+    {
+        UnmapViewOfFile(data);
+    }
+    if (mappingHandle != nullptr)
+    {
+        CloseHandle((HANDLE)mappingHandle);
+    }
+    if (fileHandle != nullptr)
+    {
+        CloseHandle((HANDLE)fileHandle);
+    }
+    mappingHandle = nullptr;
+    fileHandle = nullptr;
+#else
+    if (data != nullptr)
+    {
+        munmap((void*)data, size);
+    }
+#endif
+    data = nullptr;
+    size = 0;
+    recordsCount = 0;
+}
+
+WorkunitArchiveRecord WorkunitArchiveReader::GetRecord(long long n) const
+{
+    WorkunitArchiveRecord record;
+
+    if ((n < 0) || ((uint64_t)n >= recordsCount))
+    {
+        throw("Workunit number is out of archive range.");
+    }
+
+    // Start from the nearest full record
+    size_t pos = indexOffset + (n / BlockSize) * sizeof(uint64_t);
+    pos = Get<uint64_t>(data, size, pos);
+
+    for (long long i = n - n % BlockSize; i <= n; i++)
+    {
+        int common = Get<uint8_t>(data, size, pos);
+        int count = Get<uint8_t>(data, size, pos);
+        int flags = Get<uint8_t>(data, size, pos);
+
+        if ((common > count) || (common > (int)record.values.size()) || (count > (int)header.path.size()))
+        {
+            throw("Invalid workunit archive record.");
+        }
+        record.values.resize(count);
+        for (int j = common; j < count; j++)
+        {
+            record.values[j] = Get<uint8_t>(data, size, pos);
+        }
+        record.rangeStart = 0;
+        record.rangeEnd = -1;
+        if (flags & HasRange)
+        {
+            record.rangeStart = Get<int32_t>(data, size, pos);
+            record.rangeEnd = Get<int32_t>(data, size, pos);
+        }
+        record.estimatedNodes = 0;
+        if (flags & HasEstimate)
+        {
+            record.estimatedNodes = Get<double>(data, size, pos);
+        }
+        record.orbitSize = 1;
+        if (flags & HasOrbitSize)
+        {
+            record.orbitSize = Get<uint32_t>(data, size, pos);
+        }
+    }
+
+    return record;
+}
+
+// Text format is the same as written by RakeWuGeneratorV3 directly. Flags of values are restored from square,
+// history of every filled generator cell holds values tried by generator: candidates not greater than cell value
+void WorkunitArchiveReader::WriteWorkunit(std::ostream& os, long long n) const
+{
+    const WorkunitArchiveRecord record = GetRecord(n);
+    const int rank = header.rank;
+    const int depth = (int)record.values.size();
+    const unsigned int allBits = rank < 32 ? (1u << rank) - 1 : ~0u;
+    vector<int> square = header.square;
+    vector<unsigned int> history = header.history;
+    vector<unsigned int> rows(rank, allBits);
+    vector<unsigned int> columns(rank, allBits);
+    unsigned int primary = allBits;
+    unsigned int secondary = allBits;
+
+    // Fill flags with values of start square
+    for (int i = 0; i < rank; i++)
+    {
+        for (int j = 0; j < rank; j++)
+        {
+            int value = square[i * rank + j];
+            if (value >= 0)
+            {
+                rows[i] &= ~(1u << value);
+                columns[j] &= ~(1u << value);
+                if (i == j)
+                {
+                    primary &= ~(1u << value);
+                }
+                if (i == rank - 1 - j)
+                {
+                    secondary &= ~(1u << value);
+                }
+            }
+        }
+    }
+
+    // Fill generator cells in the same order as generator
+    for (int k = 0; k < depth; k++)
+    {
+        int i = header.path[k][0];
+        int j = header.path[k][1];
+        int value = record.values[k];
+        unsigned int candidates = rows[i] & columns[j];
+
+        if (i == j)
+        {
+            candidates &= primary;
+            primary &= ~(1u << value);
+        }
+        if (i == rank - 1 - j)
+        {
+            candidates &= secondary;
+            secondary &= ~(1u << value);
+        }
+        square[i * rank + j] = value;
+        history[i * rank + j] &= ~(candidates & ((2u << value) - 1));
+        rows[i] &= ~(1u << value);
+        columns[j] &= ~(1u << value);
+    }
+
+    // Key cell is the first cell of workunit path
+    int keyRowId = header.keyRowId;
+    int keyColumnId = header.keyColumnId;
+    if (depth < (int)header.path.size())
+    {
+        keyRowId = header.path[depth][0];
+        keyColumnId = header.path[depth][1];
+    }
+
+    if (header.hasEstimates)
+    {
+        os << "# Estimated search nodes: " << record.estimatedNodes << endl
+           << "# Estimated runtime, s: " << record.estimatedNodes * header.nodeCost << endl
+           << endl;
+    }
+
+    if (header.hasOrbitSizes)
+    {
+        os << "# Orbit size: " << record.orbitSize << endl << endl;
+    }
+
+    os << "# RakeSearch of diagonal Latin squares" << endl << endl << rank << endl << endl;
+
+    os << "{" << endl;
+    for (int i = 0; i < rank; i++)
+    {
+        for (int j = 0; j < rank; j++)
+        {
+            os << square[i * rank + j] << " ";
+        }
+        os << endl;
+    }
+    os << "}" << endl << endl;
+
+    os << header.path.size() - depth + header.workunitPath.size() << endl << endl;
+    for (size_t k = depth; k < header.path.size(); k++)
+    {
+        os << header.path[k][0] << " " << header.path[k][1] << endl;
+    }
+    for (const array<int, 2>& cell : header.workunitPath)
+    {
+        os << cell[0] << " " << cell[1] << endl;
+    }
+    os << endl;
+
+    os << keyRowId << " " << keyColumnId << " " << square[keyRowId * rank + keyColumnId] << endl;
+    os << keyRowId << " " << keyColumnId << " " << 0 << endl;
+    os << endl;
+
+    for (int i = 0; i < rank; i++)
+    {
+        os << ((primary >> i) & 1) << " ";
+    }
+    os << endl;
+    for (int i = 0; i < rank; i++)
+    {
+        os << ((secondary >> i) & 1) << " ";
+    }
+    os << endl << endl;
+
+    for (int i = 0; i < rank; i++)
+    {
+        for (int j = 0; j < rank; j++)
+        {
+            os << ((rows[i] >> j) & 1) << " ";
+        }
+        os << endl;
+    }
+    os << endl;
+    for (int i = 0; i < rank; i++)
+    {
+        for (int j = 0; j < rank; j++)
+        {
+            os << ((columns[i] >> j) & 1) << " ";
+        }
+        os << endl;
+    }
+    os << endl;
+
+    for (int h = 0; h < rank; h++)
+    {
+        for (int i = 0; i < rank; i++)
+        {
+            for (int j = 0; j < rank; j++)
+            {
+                os << ((history[i * rank + j] >> h) & 1) << " ";
+            }
+            os << endl;
+        }
+        os << endl;
+    }
+    os << endl;
+
+    os << 0 << endl << endl;
+    os << "0 0 0 " << endl;
+
+    if (record.rangeEnd >= 0)
+    {
+        os << endl << "# Path prefix range" << endl << record.rangeStart << " " << record.rangeEnd << endl;
+    }
+}
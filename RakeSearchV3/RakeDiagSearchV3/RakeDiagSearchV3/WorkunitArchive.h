@@ -0,0 +1,92 @@
+// Packed archive of workunits created by RakeWuGeneratorV3
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Common part of all workunits in archive: start state of generator and paths
+struct WorkunitArchiveHeader
+{
+    int rank = 0;                         // Rank of squares
+    vector<int> square;                   // Start square (rank * rank values), cells of generator path are empty
+    vector<unsigned int> history;         // Start history of values of cells (rank * rank masks)
+    vector<array<int, 2>> path;           // Path of generator cells
+    vector<array<int, 2>> workunitPath;   // Path of workunit cells after generator cells
+    int keyRowId = -1;                    // Key cell of workunit with all generator cells filled
+    int keyColumnId = -1;
+    bool hasEstimates = false;            // Records contain estimated size of search tree
+    bool hasOrbitSizes = false;           // Records contain orbit sizes of canonical prefixes (symmetry reduction)
+    double nodeCost = 0;                  // Time of one search node processing in seconds
+    long long firstNumber = 0;            // Number of the first workunit in archive
+};
+
+// Single workunit: values of first generator cells and optional path prefix range
+struct WorkunitArchiveRecord
+{
+    vector<int> values;         // Values of first values.size() cells of generator path
+    int rangeStart = 0;         // Range of path prefixes, rangeEnd < 0 - whole workunit
+    int rangeEnd = -1;
+    double estimatedNodes = 0;  // Estimated size of search tree
+    int orbitSize = 1;          // Number of prefixes equivalent to this one, including itself
+};
+
+// Archive layout: header, records, index, footer. Records are delta-encoded: every record stores
+// only cells which differ from previous record. Every BlockSize-th record is stored in full and its
+// offset is written to index, so record N is decoded from nearest preceding indexed record.
+class WorkunitArchiveWriter
+{
+public:
+    WorkunitArchiveWriter() = default;
+    ~WorkunitArchiveWriter();
+
+    void Open(const string& fileName, const WorkunitArchiveHeader& header);
+    void Add(const WorkunitArchiveRecord& record);
+    void Close();
+    bool IsOpen() const { return file.is_open(); }
+
+private:
+    ofstream file;
+    WorkunitArchiveHeader header;
+    vector<uint64_t> index;
+    vector<int> previousValues;
+    uint64_t recordsCount = 0;
+    uint64_t offset = 0;
+    string buffer;
+};
+
+// Read-only access to memory-mapped archive
+class WorkunitArchiveReader
+{
+public:
+    WorkunitArchiveReader() = default;
+    ~WorkunitArchiveReader();
+
+    void Open(const string& fileName);
+    void Close();
+
+    long long GetCount() const { return (long long)recordsCount; }
+    const WorkunitArchiveHeader& GetHeader() const { return header; }
+    WorkunitArchiveRecord GetRecord(long long n) const;
+
+    // Write workunit n in text format of RakeWuGeneratorV3
+    void WriteWorkunit(std::ostream& os, long long n) const;
+
+private:
+    const unsigned char* data = nullptr;
+    size_t size = 0;
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#endif
+    WorkunitArchiveHeader header;
+    uint64_t recordsCount = 0;
+    uint64_t indexOffset = 0;
+    size_t recordsOffset = 0;
+};
@@ -2,12 +2,18 @@
 #include <fstream>
 #include <string>
 #include <iomanip>
+#include <chrono>
+#include <thread>
 #include <sys/stat.h>
 #include <time.h>
 #include <unistd.h>
+#include <csignal>
+#include <memory>
 #include "boinc_api.h"
 #include "Helpers.h"
 #include "RakeSearch.h"
+#include "ResultValidator.h"
+#include "WorkunitArchive.h"
 #if defined(__i386__) || defined(__x86_64__)
 #include <cpuid.h>
 #include <stdio.h>
@@ -28,8 +34,67 @@ inline bool file_exists(const std::string& name)
     return (stat(name.c_str(), &buffer) == 0);
 }
 
+#ifndef _WIN32
+// SIGUSR1 handler - give away the rest of workunit as new workunit files
+void DonationSignalHandler(int)
+{
+    RequestWorkDonation();
+}
+#endif
+
+// Чтение ранга квадратов из файла задания, 0 - ранг не найден
+int ReadWorkunitRank(const string& wu_filename)
+{
+    ifstream workunitFile;
+    string marker;
+    int rank = 0;
+
+    workunitFile.open(wu_filename.c_str(), std::ios_base::in);
+    while (std::getline(workunitFile, marker))
+    {
+        if (marker == "# RakeSearch of diagonal Latin squares")
+        {
+            workunitFile >> rank;
+            break;
+        }
+    }
+
+    return rank;
+}
+
+// Разбиение задания на части с диапазонами префиксов пути
+template <int Rank> int Split(string wu_filename, int parts)
+{
+    unique_ptr<RakeSearch<Rank>> search(new RakeSearch<Rank>);
+    string partPrefix = wu_filename.substr(0, wu_filename.rfind(".txt")) + "_part";
+
+    search->SplitWorkunit(wu_filename, parts, partPrefix);
+
+    return 0;
+}
+
+// Подсчёт числа квадратов задания по префиксам пути без поиска ортогональных квадратов
+template <int Rank> int Count(string wu_filename, int threads)
+{
+    unique_ptr<RakeSearch<Rank>> search(new RakeSearch<Rank>);
+
+    search->CountSquares(wu_filename, threads);
+
+    return 0;
+}
+
+// Проверка файлов результатов задания без повторного поиска, 1 - найдены неверные результаты
+template <int Rank> int Validate(const string& wu_filename, const vector<string>& resultFileNames, int threads)
+{
+    unique_ptr<ResultValidator<Rank>> validator(new ResultValidator<Rank>);
+
+    validator->LoadWorkunit(wu_filename);
+
+    return validator->ValidateFiles(resultFileNames, threads) > 0 ? 1 : 0;
+}
+
 // Выполнение вычислений
-int Compute(string wu_filename, string result_filename)
+template <int Rank> int Compute(string wu_filename, string result_filename)
 {
     string localWorkunit;
     string localResult;
@@ -41,7 +106,8 @@ int Compute(string wu_filename, string result_filename)
     string initCheckpointFileName;
     string initTmpCheckpointFileName;
 
-    RakeSearch search ALIGNED;
+    // Объект поиска размещается в куче: при больших рангах он не помещается в стек потока (1 Мб в Windows)
+    unique_ptr<RakeSearch<Rank>> search(new RakeSearch<Rank>);
 
     // Проверка наличия файла задания, контрольной точки, результата
     localWorkunit = wu_filename;
@@ -64,8 +130,8 @@ int Compute(string wu_filename, string result_filename)
             if (isDebug)
                 cout << "Start from checkpoint of workunit " << localWorkunit << endl;
 
-            search.Initialize(initStartFileName, initResultFileName, initCheckpointFileName, initTmpCheckpointFileName);
-            search.Start();
+            search->Initialize(initStartFileName, initResultFileName, initCheckpointFileName, initTmpCheckpointFileName);
+            search->Start();
         }
         else
         {
@@ -89,17 +155,114 @@ int Compute(string wu_filename, string result_filename)
         if (isDebug)
             cout << "Start from workunit file " << localWorkunit << endl;
 
-        search.Initialize(initStartFileName, initResultFileName, initCheckpointFileName, initTmpCheckpointFileName);
-        search.Start();
+        search->Initialize(initStartFileName, initResultFileName, initCheckpointFileName, initTmpCheckpointFileName);
+        search->Start();
     }
 
     return 0;
 }
 
+// Выполнение вычислений, разбиение задания (при splitParts > 0), подсчёт квадратов (при countThreads > 0)
+// или проверка результатов (при validateThreads > 0) для ранга, указанного в задании
+template <int Rank>
+int Run(const string& wu_filename, const string& result_filename, int splitParts, int countThreads,
+        int validateThreads, const vector<string>& resultFileNames)
+{
+    if (splitParts > 0)
+        return Split<Rank>(wu_filename, splitParts);
+    else if (countThreads > 0)
+        return Count<Rank>(wu_filename, countThreads);
+    else if (validateThreads > 0)
+        return Validate<Rank>(wu_filename, resultFileNames, validateThreads);
+    else
+        return Compute<Rank>(wu_filename, result_filename);
+}
+
+int Run(const string& wu_filename, const string& result_filename, int splitParts, int countThreads = 0,
+        int validateThreads = 0, const vector<string>& resultFileNames = vector<string>())
+{
+    int rank = ReadWorkunitRank(wu_filename);
+
+    switch (rank)
+    {
+    case 8:
+        return Run<8>(wu_filename, result_filename, splitParts, countThreads, validateThreads, resultFileNames);
+    case 9:
+        return Run<9>(wu_filename, result_filename, splitParts, countThreads, validateThreads, resultFileNames);
+    case 10:
+        return Run<10>(wu_filename, result_filename, splitParts, countThreads, validateThreads, resultFileNames);
+    case 11:
+        return Run<11>(wu_filename, result_filename, splitParts, countThreads, validateThreads, resultFileNames);
+    case 12:
+        return Run<12>(wu_filename, result_filename, splitParts, countThreads, validateThreads, resultFileNames);
+    case 13:
+        return Run<13>(wu_filename, result_filename, splitParts, countThreads, validateThreads, resultFileNames);
+    case 14:
+        return Run<14>(wu_filename, result_filename, splitParts, countThreads, validateThreads, resultFileNames);
+    case 15:
+        return Run<15>(wu_filename, result_filename, splitParts, countThreads, validateThreads, resultFileNames);
+    case 16:
+        return Run<16>(wu_filename, result_filename, splitParts, countThreads, validateThreads, resultFileNames);
+    case 17:
+        return Run<17>(wu_filename, result_filename, splitParts, countThreads, validateThreads, resultFileNames);
+    case 18:
+        return Run<18>(wu_filename, result_filename, splitParts, countThreads, validateThreads, resultFileNames);
+    case 19:
+        return Run<19>(wu_filename, result_filename, splitParts, countThreads, validateThreads, resultFileNames);
+    case 20:
+        return Run<20>(wu_filename, result_filename, splitParts, countThreads, validateThreads, resultFileNames);
+    case 21:
+        return Run<21>(wu_filename, result_filename, splitParts, countThreads, validateThreads, resultFileNames);
+    case 22:
+        return Run<22>(wu_filename, result_filename, splitParts, countThreads, validateThreads, resultFileNames);
+    case 23:
+        return Run<23>(wu_filename, result_filename, splitParts, countThreads, validateThreads, resultFileNames);
+    case 24:
+        return Run<24>(wu_filename, result_filename, splitParts, countThreads, validateThreads, resultFileNames);
+    case 25:
+        return Run<25>(wu_filename, result_filename, splitParts, countThreads, validateThreads, resultFileNames);
+    case 26:
+        return Run<26>(wu_filename, result_filename, splitParts, countThreads, validateThreads, resultFileNames);
+    case 27:
+        return Run<27>(wu_filename, result_filename, splitParts, countThreads, validateThreads, resultFileNames);
+    case 28:
+        return Run<28>(wu_filename, result_filename, splitParts, countThreads, validateThreads, resultFileNames);
+    case 29:
+        return Run<29>(wu_filename, result_filename, splitParts, countThreads, validateThreads, resultFileNames);
+    case 30:
+        return Run<30>(wu_filename, result_filename, splitParts, countThreads, validateThreads, resultFileNames);
+    case 31:
+        return Run<31>(wu_filename, result_filename, splitParts, countThreads, validateThreads, resultFileNames);
+    case 32:
+        return Run<32>(wu_filename, result_filename, splitParts, countThreads, validateThreads, resultFileNames);
+    default:
+        cerr << "Error: unsupported rank " << rank << " in workunit file " << wu_filename << endl;
+        return -1;
+    }
+}
+
+// Извлечение задания с номером number из архива заданий в текстовый файл
+void ExtractWorkunit(const string& archiveFileName, long long number, const string& wu_filename)
+{
+    WorkunitArchiveReader archive;
+    ofstream workunitFile;
+
+    archive.Open(archiveFileName);
+    workunitFile.open(wu_filename.c_str(), std::ios_base::out);
+    if (!workunitFile.is_open())
+    {
+        throw("Cannot create workunit file.");
+    }
+    archive.WriteWorkunit(workunitFile, number - archive.GetHeader().firstNumber);
+}
+
 int main(int argumentsCount, char* argumentsValues[])
 {
     string wu_filename = "workunit.txt";
     string result_filename = "result.txt";
+    string archive_filename;                             // Архив заданий (--archive=<file>)
+    string archive_wu_filename = "archive_workunit.txt"; // Задание, извлечённое из архива
+    long long archive_number = -1;                       // Номер задания в архиве (--number=<n>)
     string resolved_in_name;  // Переменные для работы с логическими
     string resolved_out_name; // и физическими именами файлов в BOINC
 
@@ -107,10 +270,120 @@ int main(int argumentsCount, char* argumentsValues[])
 
     clock_t runtime = clock();
 
+    // Offline mode: split workunit into parts with ranges of path prefixes and exit.
+    // Usage: rakesearch10 --split=<parts> [workunit file]
+    if ((argumentsCount > 1) && (0 == string(argumentsValues[1]).compare(0, 8, "--split=")))
+    {
+        int parts = atoi(argumentsValues[1] + 8);
+        string splitFileName = argumentsCount > 2 ? argumentsValues[2] : wu_filename;
+
+        if (parts < 1)
+        {
+            cerr << "Invalid number of workunit parts!" << endl;
+            return 1;
+        }
+
+        try
+        {
+            retval = Run(splitFileName, result_filename, parts);
+        }
+        catch (const char* str)
+        {
+            cerr << "Split error!\n" << str << endl;
+            return 1;
+        }
+        return retval ? 1 : 0;
+    }
+
+    // Offline mode: count squares of workunit for every path prefix and exit.
+    // Usage: rakesearch10 --count[=<threads>] [workunit file], by default all CPU cores are used
+    if ((argumentsCount > 1) && (0 == string(argumentsValues[1]).compare(0, 7, "--count")))
+    {
+        int threads = (int)std::thread::hardware_concurrency();
+        string countFileName = argumentsCount > 2 ? argumentsValues[2] : wu_filename;
+
+        if ('=' == argumentsValues[1][7])
+        {
+            threads = atoi(argumentsValues[1] + 8);
+        }
+        if (threads < 1)
+        {
+            threads = 1;
+        }
+
+        auto countStart = std::chrono::steady_clock::now();
+        try
+        {
+            retval = Run(countFileName, result_filename, 0, threads);
+        }
+        catch (const char* str)
+        {
+            cerr << "Count error!\n" << str << endl;
+            return 1;
+        }
+        std::chrono::duration<double> countTime = std::chrono::steady_clock::now() - countStart;
+        cout << "# Counting time: " << fixed << setprecision(3) << countTime.count() << " sec, threads: " << threads
+             << endl;
+        return retval ? 1 : 0;
+    }
+
+    // Offline mode: validate result files of workunit without repeating the search and exit.
+    // Usage: rakesearch10 --validate[=<threads>] <workunit file> <result files...>, by default all CPU cores
+    // are used. Exit code is 1 if any result is invalid.
+    if ((argumentsCount > 1) && (0 == string(argumentsValues[1]).compare(0, 10, "--validate")))
+    {
+        int threads = (int)std::thread::hardware_concurrency();
+
+        if ('=' == argumentsValues[1][10])
+        {
+            threads = atoi(argumentsValues[1] + 11);
+        }
+        if (threads < 1)
+        {
+            threads = 1;
+        }
+        if (argumentsCount < 4)
+        {
+            cerr << "Workunit file and result files are required!" << endl;
+            return 1;
+        }
+
+        vector<string> resultFileNames(argumentsValues + 3, argumentsValues + argumentsCount);
+        try
+        {
+            retval = Run(argumentsValues[2], result_filename, 0, 0, threads, resultFileNames);
+        }
+        catch (const char* str)
+        {
+            cerr << "Validation error!\n" << str << endl;
+            return 1;
+        }
+        return retval ? 1 : 0;
+    }
+
+    // Workunit may be taken from archive of workunits: --archive=<file> --number=<workunit number>
+    for (int i = 1; i < argumentsCount; i++)
+    {
+        string argument = argumentsValues[i];
+        if (0 == argument.compare(0, 10, "--archive="))
+        {
+            archive_filename = argument.substr(10);
+        }
+        if (0 == argument.compare(0, 9, "--number="))
+        {
+            archive_number = atoll(argument.c_str() + 9);
+        }
+    }
+
     boinc_init(); // Инициализировать BOINC API для однопоточного приложения
     // Установить минимальное число секунд между записью контрольных точек
     boinc_set_min_checkpoint_period(60);
 
+#ifndef _WIN32
+    // Work donation may be requested by SIGUSR1 or by creating donate.txt file with number of parts
+    signal(SIGUSR1, DonationSignalHandler);
+#endif
+
     // Преобразовать логическое имя файла в физическое.
     // Мы делаем это на верхнем уровне, передавая дальше уже преобразованные имена.
     retval = boinc_resolve_filename_s(wu_filename.c_str(), resolved_in_name);
@@ -121,6 +394,29 @@ int main(int argumentsCount, char* argumentsValues[])
         boinc_finish(retval);
         return 0;
     }
+    if (!archive_filename.empty())
+    {
+        // Задание извлекается из архива при каждом запуске, контрольная точка ссылается на извлечённый файл
+        retval = boinc_resolve_filename_s(archive_filename.c_str(), resolved_in_name);
+        if (!retval)
+        {
+            try
+            {
+                ExtractWorkunit(resolved_in_name, archive_number, archive_wu_filename);
+                resolved_in_name = archive_wu_filename;
+            }
+            catch (const char* str)
+            {
+                cerr << "Archive error!\n" << str << endl;
+                retval = 1;
+            }
+        }
+        if (retval)
+        {
+            boinc_finish(retval);
+            return 0;
+        }
+    }
     retval = boinc_resolve_filename_s(result_filename.c_str(), resolved_out_name);
     if (retval)
     {
@@ -134,7 +430,7 @@ int main(int argumentsCount, char* argumentsValues[])
     // Запустить расчет
     try
     {
-        retval = Compute(resolved_in_name, resolved_out_name);
+        retval = Run(resolved_in_name, resolved_out_name, 0);
     }
     catch (const std::exception& e)
     {
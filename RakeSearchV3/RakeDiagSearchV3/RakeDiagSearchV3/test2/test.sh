@@ -6,3 +6,17 @@ time ./rakesearch10 > /dev/null
 #time ../tests/sde-external-8.12.0-2017-10-23-win/sde -skx -- ./rakesearch10
 
 diff -sq result.txt result.txt.ref
+
+./rakesearch10 --validate workunit.txt result.txt
+
+# Corrupted results, every one has to be rejected by validation
+for f in invalid_*.txt; do
+    if ./rakesearch10 --validate workunit.txt $f > /dev/null; then
+        echo "Not detected: $f"
+    fi
+done
+
+# Correct result does not belong to the first part of the workunit
+if ./rakesearch10 --validate workunit_part_1.txt result.txt.ref > /dev/null; then
+    echo "Not detected: result of other part of workunit"
+fi
@@ -0,0 +1,110 @@
+// Throughput benchmark: processes squares of bench/workunit_rN.txt for every rank from 9 to 16
+// and reports number of squares processed per second. Workunit is restarted if it ends too early.
+// With "generator" argument squares are only generated, so speed of StartImpl is measured.
+// Workunits were created by RakeWuGeneratorV3 (make RANK=N, --init, --count=...). Rank 8 is not
+// included, generator creates too small workunits for it.
+
+#include "../RakeSearch.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iomanip>
+
+class EndBenchmark
+{};
+
+template <int Rank> class BenchmarkRakeSearch : public RakeSearch<Rank>
+{
+public:
+    void ProcessSquare() override
+    {
+        if (isGeneratorOnly)
+        {
+            // Squares are generated much faster than processed, so time is checked less often
+            squares++;
+            if ((0 == squares % 4096) && (std::chrono::steady_clock::now() >= deadline))
+                throw EndBenchmark();
+            return;
+        }
+
+        RakeSearch<Rank>::ProcessSquare();
+
+        squares++;
+        if (std::chrono::steady_clock::now() >= deadline)
+            throw EndBenchmark();
+    }
+
+    long long squares = 0;
+    bool isGeneratorOnly = false;
+    std::chrono::steady_clock::time_point deadline;
+};
+
+template <int Rank> void RunBenchmark(double seconds, bool isGeneratorOnly)
+{
+    const string wuFileName = "bench/workunit_r" + to_string(Rank) + ".txt";
+    const char* resultFileName = "bench_result.txt";
+    const char* checkpointFileName = "bench_checkpoint.txt";
+    const char* tmpCheckpointFileName = "bench_tmp_checkpoint.txt";
+
+    BenchmarkRakeSearch<Rank> search;
+    search.isGeneratorOnly = isGeneratorOnly;
+
+    auto start = std::chrono::steady_clock::now();
+    search.deadline =
+        start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(seconds));
+
+    // Found pairs are printed to stdout, hide them
+    std::streambuf* coutBuf = std::cout.rdbuf(nullptr);
+    try
+    {
+        do
+        {
+            remove(checkpointFileName);
+            search.Reset();
+            search.Initialize(wuFileName, resultFileName, checkpointFileName, tmpCheckpointFileName);
+            if (search.isInitialized != search.Yes)
+                break;
+            search.Start();
+        } while (std::chrono::steady_clock::now() < search.deadline);
+    }
+    catch (const EndBenchmark&)
+    {}
+    std::cout.rdbuf(coutBuf);
+    std::cout.clear();
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    std::cout << "Rank " << std::setw(2) << Rank << ": " << std::setw(10) << search.squares << " squares in "
+              << std::fixed << std::setprecision(2) << elapsed.count() << " s, " << std::setw(10)
+              << (long long)(search.squares / elapsed.count()) << " squares/s" << std::endl;
+
+    remove(resultFileName);
+    remove(checkpointFileName);
+}
+
+int main(int argc, char* argv[])
+{
+    // Time in seconds spent for each rank, "generator" measures generation of squares only
+    double seconds = 5.0;
+    bool isGeneratorOnly = false;
+    for (int i = 1; i < argc; i++)
+    {
+        if (0 == strcmp(argv[i], "generator"))
+            isGeneratorOnly = true;
+        else
+            seconds = atof(argv[i]);
+    }
+
+    RunBenchmark<9>(seconds, isGeneratorOnly);
+    RunBenchmark<10>(seconds, isGeneratorOnly);
+    RunBenchmark<11>(seconds, isGeneratorOnly);
+    RunBenchmark<12>(seconds, isGeneratorOnly);
+    RunBenchmark<13>(seconds, isGeneratorOnly);
+    RunBenchmark<14>(seconds, isGeneratorOnly);
+    RunBenchmark<15>(seconds, isGeneratorOnly);
+    RunBenchmark<16>(seconds, isGeneratorOnly);
+
+    return 0;
+}
+
+#include "../RakeSearch.cpp"
@@ -0,0 +1,207 @@
+// Regression check of SIMD code: GenerateSquareMasks() and PermuteRows() (or their Wide variants for
+// ranks 17+) are run for linear DLS of given rank, and squares passed to ProcessOrthoSquare() are
+// counted and hashed. Squares generated by StartImpl() are checked the same way, so candidates up to
+// Rank - 1 (bit 31 for rank 32) pass through the generator. Output has to be the same for SIMD and
+// NO_SIMD builds, so both are compared with the same file simd/expected_rN.txt by "make simdcheck".
+// Linear DLS have a lot of row permutations with both diagonals Latin, so only the first MaxSquares
+// of them are checked. Rows are enumerated in the same order by all code paths, so this prefix of
+// search is the same too.
+
+#include "../RakeSearch.h"
+#include <cstdio>
+#include <cstdlib>
+
+class EndCheck
+{};
+
+template <int Rank> class SimdCheckRakeSearch : public RakeSearch<Rank>
+{
+public:
+    static const long long MaxSquares = 100000; // Number of squares B checked for every rank
+
+    void ProcessOrthoSquare() override
+    {
+        Square<Rank> a(this->squareA);
+        Square<Rank> b(this->squareB);
+        if (Square<Rank>::OrthoDegree(a, b) >= this->MinOrthoMetric)
+            pairs++;
+
+        // FNV-1a hash of squares in order they are generated
+        for (int n = 0; n < Rank; ++n)
+        {
+            for (int k = 0; k < Rank; ++k)
+            {
+                hash = (hash ^ (unsigned long long)this->squareB[n][k]) * 1099511628211ull;
+            }
+        }
+
+        if (MaxSquares == ++squares)
+            throw EndCheck();
+    }
+
+    // Squares generated by StartImpl() are hashed instead of search of their pairs
+    void ProcessSquare() override
+    {
+        for (int n = 0; n < this->cellsInPath; ++n)
+        {
+            int value = this->squareA[this->path[n][0]][this->path[n][1]];
+            if (value > maxPathValue)
+                maxPathValue = value;
+        }
+        for (int n = 0; n < Rank; ++n)
+        {
+            for (int k = 0; k < Rank; ++k)
+            {
+                generatedHash = (generatedHash ^ (unsigned long long)this->squareA[n][k]) * 1099511628211ull;
+            }
+        }
+
+        if (MaxSquares == ++generated)
+            throw EndCheck();
+    }
+
+    // Generate squares from squareA with two last rows cleared, except cells of diagonals which are
+    // preset in workunits. Path goes through cleared cells by rows.
+    void RunGenerator()
+    {
+        const unsigned int allFree = ~0u >> (32 - Rank);
+
+        this->cellsInPath = 0;
+        for (int n = 0; n < Rank; ++n)
+        {
+            this->flagsRows[n] = allFree;
+            this->flagsColumns[n] = allFree;
+        }
+        for (int n = 0; n < Rank; ++n)
+        {
+            for (int k = 0; k < Rank; ++k)
+            {
+                this->flagsCellsHistory[n][k] = allFree;
+                if ((n >= Rank - 2) && (k != n) && (k != Rank - 1 - n))
+                {
+                    this->squareA[n][k] = -1;
+                    this->path[this->cellsInPath][0] = n;
+                    this->path[this->cellsInPath][1] = k;
+                    this->cellsInPath++;
+                }
+                else
+                {
+                    this->flagsRows[n] &= ~(1u << this->squareA[n][k]);
+                    this->flagsColumns[k] &= ~(1u << this->squareA[n][k]);
+                }
+            }
+        }
+        this->SetupPathCells();
+
+        this->keyRowId = 0;
+        this->keyColumnId = 0;
+        this->keyValue = -1;
+        this->cellId = 0;
+        this->prefixRangeEnd = -1;
+        this->isInitialized = this->Yes;
+
+        try
+        {
+            this->template StartImpl<true_type, false_type>();
+        }
+        catch (const EndCheck&)
+        {}
+    }
+
+    // Check masks of squareA created by GenerateSquareMasks(), returns number of wrong masks
+    int CheckMasks() const
+    {
+        int errors = 0;
+        for (int n = 0; n < Rank; ++n)
+        {
+            for (int k = 0; k < Rank; ++k)
+            {
+                unsigned int mask = 1u << this->squareA[n][k];
+                if ((unsigned int)this->squareA_Mask[n][k] != mask)
+                    errors++;
+                if ((unsigned int)this->squareA_MaskT[k][n] != mask)
+                    errors++;
+            }
+        }
+        return errors;
+    }
+
+    long long squares = 0;
+    long long pairs = 0;
+    unsigned long long hash = 14695981039346656037ull;
+    long long generated = 0;
+    int maxPathValue = -1;
+    unsigned long long generatedHash = 14695981039346656037ull;
+};
+
+// Fill linear DLS with identity first row. For odd ranks not divisible by 3 it is A[i][j] = 2i + j mod Rank,
+// for powers of 2 it is A[i][j] = x*i xor j in GF(Rank), poly is irreducible polynomial of the field.
+template <int Rank> void CreateLinearSquare(int square[Rank][Rank], int poly)
+{
+    for (int i = 0; i < Rank; ++i)
+    {
+        int xi = i << 1;
+        if (xi & Rank)
+            xi ^= poly;
+
+        for (int j = 0; j < Rank; ++j)
+        {
+            square[i][j] = poly ? (xi ^ j) : (2 * i + j) % Rank;
+        }
+    }
+}
+
+template <int Rank> int RunCheck(int poly)
+{
+    SimdCheckRakeSearch<Rank> search;
+
+    CreateLinearSquare<Rank>(search.squareA, poly);
+    Square<Rank> a(search.squareA);
+    if (!a.IsDiagonal() || !a.IsLatin())
+    {
+        std::cout << "Rank " << Rank << ": test square is not DLS" << std::endl;
+        return 1;
+    }
+
+    search.GenerateSquareMasks();
+    int maskErrors = search.CheckMasks();
+
+    try
+    {
+        search.PermuteRows();
+    }
+    catch (const EndCheck&)
+    {}
+
+    search.RunGenerator();
+
+    std::cout << "Rank " << Rank << std::endl;
+    std::cout << "Mask errors: " << maskErrors << std::endl;
+    std::cout << "Squares: " << search.squares << std::endl;
+    std::cout << "Pairs: " << search.pairs << std::endl;
+    std::cout << "Hash: " << std::hex << search.hash << std::dec << std::endl;
+    std::cout << "Generated squares: " << search.generated << std::endl;
+    std::cout << "Max path value: " << search.maxPathValue << std::endl;
+    std::cout << "Generated hash: " << std::hex << search.generatedHash << std::dec << std::endl;
+
+    return maskErrors > 0 ? 1 : 0;
+}
+
+int main(int argc, char* argv[])
+{
+    int rank = argc > 1 ? atoi(argv[1]) : 0;
+
+    switch (rank)
+    {
+    case 11: return RunCheck<11>(0);
+    case 13: return RunCheck<13>(0);
+    case 16: return RunCheck<16>(0x13); // x^4 + x + 1
+    case 17: return RunCheck<17>(0);
+    case 32: return RunCheck<32>(0x25); // x^5 + x^2 + 1
+    default:
+        std::cout << "Usage: simdcheck_simd <11|13|16|17|32>" << std::endl;
+        return 1;
+    }
+}
+
+#include "../RakeSearch.cpp"
@@ -57,9 +57,9 @@ void TestRakeSearch::ProcessOrthoSquare()
 {
     if (TestNum::Test3 == testNum)
     {
-        Square a(squareA);
-        Square b(squareB);
-        int orthoDegree = Square::OrthoDegree(a, b);
+        Square<Rank> a(squareA);
+        Square<Rank> b(squareB);
+        int orthoDegree = Square<Rank>::OrthoDegree(a, b);
         
         std::cout << "{PermSquare Degree " << orthoDegree << "\n";
         for (int n = 0; n < Rank; ++n)
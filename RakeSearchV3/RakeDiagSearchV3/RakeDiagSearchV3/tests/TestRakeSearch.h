@@ -14,7 +14,7 @@ enum class TestNum
     Test3 = 3,
 };
 
-class TestRakeSearch : public RakeSearch
+class TestRakeSearch : public RakeSearch<10>
 {
 public:
     void PermuteRows() override;
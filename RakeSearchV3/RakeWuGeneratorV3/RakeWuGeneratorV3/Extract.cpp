@@ -0,0 +1,81 @@
+// Извлечение заданий из архива, созданного генератором с параметром --archive
+
+# include <stdlib.h>
+# include <iostream>
+# include <fstream>
+# include <sstream>
+# include <iomanip>
+# include <string>
+# include "../../RakeDiagSearchV3/RakeDiagSearchV3/WorkunitArchive.h"
+
+using namespace std;
+
+int main(int argsCount, char* argsValues[])
+{
+	WorkunitArchiveReader archive;
+	ofstream workunitFile;
+	string workunitFileName;
+	long long workunitNumber;
+
+	if (argsCount < 3)
+	{
+		cout << "Usage: RakeWuExtract <archive> <workunit number> [workunit file]" << endl;
+		cout << "       RakeWuExtract <archive> --list" << endl;
+		return 1;
+	}
+
+	try
+	{
+		archive.Open(argsValues[1]);
+
+		// Вывод числа и диапазона номеров заданий в архиве
+		if (string(argsValues[2]) == "--list")
+		{
+			cout << "Rank: " << archive.GetHeader().rank << endl;
+			cout << "Workunits: " << archive.GetCount() << endl;
+			if (archive.GetCount() > 0)
+			{
+				cout << "Numbers: " << archive.GetHeader().firstNumber << " - "
+					<< archive.GetHeader().firstNumber + archive.GetCount() - 1 << endl;
+			}
+			return 0;
+		}
+
+		// Номер задания проверяется до создания файла, чтобы при ошибке не оставался пустой файл
+		workunitNumber = atoll(argsValues[2]);
+		if (workunitNumber < archive.GetHeader().firstNumber || workunitNumber - archive.GetHeader().firstNumber >= archive.GetCount())
+		{
+			throw("Workunit number is out of archive range.");
+		}
+
+		// Название файла по умолчанию - такое же, как у отдельных файлов заданий генератора
+		if (argsCount > 3)
+		{
+			workunitFileName = argsValues[3];
+		}
+		else
+		{
+			std::stringstream wuNameBuilder;
+			wuNameBuilder << "rake_wu_r" << archive.GetHeader().rank << "_" << std::setw(16) << std::setfill('0') << workunitNumber << ".txt";
+			workunitFileName = wuNameBuilder.str();
+		}
+
+		workunitFile.open(workunitFileName.c_str(), std::ios_base::out);
+		if (!workunitFile.is_open())
+		{
+			cerr << "Cannot create workunit file " << workunitFileName << endl;
+			return 1;
+		}
+		archive.WriteWorkunit(workunitFile, workunitNumber - archive.GetHeader().firstNumber);
+		workunitFile.close();
+
+		cout << "Workunit " << workunitNumber << " written to " << workunitFileName << endl;
+	}
+	catch (const char* str)
+	{
+		cerr << str << endl;
+		return 1;
+	}
+
+	return 0;
+}
@@ -4,6 +4,10 @@
 
 using namespace std;
 
+// Время работы RakeSearch (AVX2) в наносекундах на один узел дерева поиска задания, включая обработку квадратов.
+// Замерено для 9 и 10 рангов, для остальных рангов берётся ближайшее значение - его стоит уточнить через --node-cost
+static const double NodeCostByRank[] = { 75, 75, 75, 75, 75, 75, 75, 75, 75, 75, 130 };
+
 // Конструктор по умолчанию
 Generator::Generator()
 {
@@ -12,6 +16,14 @@ Generator::Generator()
 
 	// Задание текстовых констант
 	generatorStateHeader = "# Workunits generator for RakeSearch status";
+	workunitsPrefix.clear();
+
+	// Оценка трудоёмкости и балансировка заданий по умолчанию отключены
+	SetCostBalancing(0, 0, 0);
+	randomGenerator.seed(1);
+
+	// По умолчанию задания пишутся в формате RakeSearch V3
+	SetLegacyFormat(No);
 }
 
 
@@ -32,13 +44,388 @@ void Generator::GenerateWorkunits(string start, string directory, string checkpo
 	Initialize(start, directory, checkpoint, temp, workunits);
 
 	// Генерация пакета заданий
+	if (isInitialized == Yes && !archiveFileName.empty())
+	{
+		OpenArchive();
+	}
 	Start();
+	if (archive.IsOpen())
+	{
+		archive.Close();
+	}
 
 	// Создание контрольной точки после завершения генерации
 	CreateCheckpoint();
 }
 
 
+// Замер скорости генерации: генерация workunits заданий (или всех оставшихся) от файла параметров запуска без
+// записи файлов заданий и контрольной точки
+void Generator::Benchmark(string start, int workunits)
+{
+	Reset();
+	Initialize(start, "", "", "", workunits);
+	if (isInitialized != Yes)
+	{
+		cout << "Error reading start parameters from " << start << "!" << endl;
+		return;
+	}
+	isBenchmark = Yes;
+
+	auto startTime = std::chrono::steady_clock::now();
+	Start();
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - startTime;
+
+	cout << "Benchmark: " << workunitsCount << " workunits in " << std::fixed << std::setprecision(2) << elapsed.count()
+		<< " s, " << (long long)(workunitsCount / elapsed.count()) << " workunits/s" << endl;
+}
+
+
+// Параллельная генерация заданий. Дерево генератора делится на шарды по значениям первых shardCells клеток пути,
+// каждый шард обрабатывается одним потоком: у шарда своя контрольная точка (checkpoint_shard_NNNN.txt) и свой
+// сегмент файлов заданий (префикс shard_NNNN_, нумерация внутри шарда). За прогон каждый шард генерирует до
+// workunits заданий. После прогона задания шардов получают глобальные номера - те же, что при последовательной
+// генерации, - и переименовываются. Номера известны только для шардов, все предыдущие шарды которых завершены
+void Generator::GenerateWorkunitsSharded(string start, string directory, int workunits, int threads, int shardCells)
+{
+	int shardsCount;
+	std::atomic<int> nextShard(0);
+	vector<std::thread> workers;
+	long long number;
+	int isComplete = Yes;
+
+	// Инициализация по файлу параметров запуска
+	Reset();
+	Initialize(start, directory, "", "", workunits);
+	if (isInitialized != Yes)
+	{
+		cout << "Error reading start parameters from " << start << "!" << endl;
+		return;
+	}
+	if (IsRootState() == No)
+	{
+		cout << "Start parameters must have empty generator path for sharded generation!" << endl;
+		return;
+	}
+	if (shardCells < 1 || shardCells >= minRootDepth)
+	{
+		cout << "Number of shard cells must be from 1 to " << minRootDepth - 1 << "!" << endl;
+		return;
+	}
+
+	// Контрольные точки шардов создаются при первом запуске, дальше генерация продолжается с них
+	shardsCount = CreateShards(0, shardCells, 0);
+	cout << "Shards: " << shardsCount << ", threads: " << threads << endl;
+
+	// Обработка шардов: каждый поток берёт следующий необработанный шард
+	for (int i = 0; i < threads; i++)
+	{
+		workers.push_back(std::thread([this, &nextShard, shardsCount, directory, workunits]()
+		{
+			for (int shard = nextShard++; shard < shardsCount; shard = nextShard++)
+			{
+				Generator shardGenerator(*this);
+				string checkpoint = GetShardName("checkpoint_shard_%04d.txt", shard);
+
+				shardGenerator.randomGenerator.seed(shard + 1);
+				shardGenerator.workunitsPrefix = GetShardName("shard_%04d_", shard);
+				shardGenerator.GenerateWorkunits(checkpoint, directory, checkpoint, GetShardName("checkpoint_shard_%04d_new.txt", shard), workunits);
+			}
+		}));
+	}
+	for (std::thread& worker : workers)
+	{
+		worker.join();
+	}
+
+	// Слияние: номер задания - номер задания в шарде плюс число заданий во всех предыдущих шардах.
+	// Уже переименованные при прошлых прогонах задания пропускаются
+	number = snapshotNumber;
+	for (int shard = 0; shard < shardsCount && isComplete == Yes; shard++)
+	{
+		Generator shardGenerator;
+		string checkpoint = GetShardName("checkpoint_shard_%04d.txt", shard);
+		string prefix = GetShardName("shard_%04d_", shard);
+
+		shardGenerator.Initialize(checkpoint, directory, checkpoint, "", 0);
+		for (long long i = 1; i <= shardGenerator.snapshotNumber; i++)
+		{
+			rename(GetWorkunitFileName(prefix, i).c_str(), GetWorkunitFileName("", number + i).c_str());
+		}
+		number += shardGenerator.snapshotNumber;
+
+		if (shardGenerator.cellId >= shardGenerator.shardDepth)
+		{
+			isComplete = No;
+			cout << "Shard " << shard << " is not complete, workunits of the next shards are kept in their segments" << endl;
+		}
+	}
+	cout << "Workunits with global numbers: " << snapshotNumber + 1 << " - " << number << endl;
+}
+
+
+// Название файла шарда по шаблону с номером шарда
+string Generator::GetShardName(const char* format, int shard)
+{
+	char name[64];
+
+	snprintf(name, sizeof(name), format, shard);
+
+	return name;
+}
+
+
+// Создание контрольных точек шардов: обход значений первых shardCells клеток пути в порядке генератора.
+// Состояние шарда - то, в котором последовательный генератор начинает клетку shardCells; генерация в шарде
+// заканчивается уходом из этой клетки. Существующие контрольные точки не перезаписываются
+int Generator::CreateShards(int depth, int shardCells, int shardsCount)
+{
+	if (depth == shardCells)
+	{
+		string checkpoint = GetShardName("checkpoint_shard_%04d.txt", shardsCount);
+		fstream checkpointFile;
+
+		checkpointFile.open(checkpoint.c_str(), std::ios_base::in);
+		if (!checkpointFile.is_open())
+		{
+			Generator shardGenerator(*this);
+
+			shardGenerator.cellId = depth;
+			shardGenerator.rowId = path[depth][0];
+			shardGenerator.columnId = path[depth][1];
+			shardGenerator.keyRowId = path[depth][0];
+			shardGenerator.keyColumnId = path[depth][1];
+			shardGenerator.keyValue = Square<Rank>::Empty;
+			shardGenerator.shardDepth = depth;
+			shardGenerator.snapshotNumber = 0;
+
+			checkpointFile.open(checkpoint.c_str(), std::ios_base::out);
+			shardGenerator.Write(checkpointFile);
+		}
+		checkpointFile.close();
+
+		return shardsCount + 1;
+	}
+
+	int r = path[depth][0];
+	int c = path[depth][1];
+	unsigned int candidates = GetFreeValues(depth);
+	unsigned int history = flagsCellsHistory[r][c];
+
+	for (unsigned int mask = candidates; mask; mask &= mask - 1)
+	{
+		int value = __builtin_ctz(mask);
+
+		// История клетки - кандидаты, которые генератор ещё не перебрал.
+		// Префиксы, отсекаемые симметрийной редукцией, шардов не образуют
+		SetCellValue(r, c, value);
+		if (!IsPrunedBySymmetry(depth + 1))
+		{
+			flagsCellsHistory[r][c] = candidates & ~((2u << value) - 1);
+			shardsCount = CreateShards(depth + 1, shardCells, shardsCount);
+			flagsCellsHistory[r][c] = history;
+		}
+		ClearCellValue(r, c);
+	}
+
+	return shardsCount;
+}
+
+
+// Формирование файла параметров запуска: первая строка 0 1 ... Rank-1, путь - диагонали, вторая строка и 2 клетки третьей
+int Generator::CreateStartParameters(string start, int symmetry)
+{
+	fstream startFile;
+	int pathLength = 0;
+
+	// Сброс состояния генератора
+	Reset();
+
+	// Заполняем первую строку квадрата
+	for (int j = 0; j < Rank; j++)
+	{
+		newSquare.Matrix[0][j] = j;
+		flagsColumns[j] &= ~(1u << j);
+		flagsCellsHistory[0][j] &= ~(1u << j);
+	}
+	flagsRows[0] = 0;
+	flagsPrimary &= ~1u;
+	flagsSecondary &= ~(1u << (Rank - 1));
+
+	// Формируем путь обхода клеток
+		// Главная диагональ
+		for (int i = 1; i < Rank; i++)
+		{
+			path[pathLength][0] = i;
+			path[pathLength][1] = i;
+			pathLength++;
+		}
+
+		// Побочная диагональ снизу вверх (без центральной клетки для нечётных рангов)
+		for (int i = Rank - 1; i > 0; i--)
+		{
+			if (i != Rank - 1 - i)
+			{
+				path[pathLength][0] = i;
+				path[pathLength][1] = Rank - 1 - i;
+				pathLength++;
+			}
+		}
+
+		// Вторая строка без клеток диагоналей
+		for (int j = 0; j < Rank; j++)
+		{
+			if (j != 1 && j != Rank - 2)
+			{
+				path[pathLength][0] = 1;
+				path[pathLength][1] = j;
+				pathLength++;
+			}
+		}
+
+		// Первые 2 клетки третьей строки
+		path[pathLength][0] = 2;
+		path[pathLength][1] = 0;
+		path[pathLength + 1][0] = 2;
+		path[pathLength + 1][1] = 1;
+
+	// Генерация заканчивается при уходе из первой клетки пути
+	keyRowId = path[0][0];
+	keyColumnId = path[0][1];
+	keyValue = Square<Rank>::Empty;
+	rowId = path[0][0];
+	columnId = path[0][1];
+	cellId = 0;
+
+	// Ключевая клетка заданий - первая клетка третьей строки, не заполняемая генератором
+	workunitKeyRowId = 2;
+	workunitKeyColumnId = 3;
+	while (workunitKeyColumnId == 2 || workunitKeyColumnId == Rank - 3)
+	{
+		workunitKeyColumnId++;
+	}
+
+	// Генерация только канонических представителей орбит префиксов задаётся при создании параметров запуска:
+	// от неё зависит нумерация заданий, поэтому флаг сохраняется в контрольных точках
+	symmetryReduction = symmetry;
+
+	// Заданный порядок обхода клеток в заданиях проверяется по клеткам, оставшимся после пути генератора
+	isInitialized = Yes;
+	if (!workunitPathFileName.empty())
+	{
+		if (ReadWorkunitPath() == No)
+		{
+			isInitialized = No;
+		}
+		else
+		{
+			BuildWorkunitPath();
+		}
+	}
+	if (isInitialized == No)
+	{
+		return No;
+	}
+
+	// Записываем параметры в файл
+	startFile.open(start.c_str(), std::ios_base::out);
+	if (!startFile.is_open())
+	{
+		return No;
+	}
+	Write(startFile);
+	startFile.close();
+
+	return Yes;
+}
+
+
+// Настройка оценки трудоёмкости заданий и их балансировки. При target > 0 поддеревья, оценка времени обработки
+// которых не превышает target секунд, оформляются одним заданием, а более трудоёмкие задания делятся по диапазонам
+// префиксов пути. При probes > 0 оценки записываются в заголовок каждого задания. nodeCost - время обработки
+// одного узла дерева поиска в наносекундах (0 - значение по умолчанию для ранга)
+void Generator::SetCostBalancing(double target, int probes, double nodeCost)
+{
+	targetCost = target;
+	probesCount = probes;
+
+	if (nodeCost > 0)
+	{
+		this->nodeCost = nodeCost * 1e-9;
+	}
+	else
+	{
+		this->nodeCost = NodeCostByRank[Rank < 10 ? Rank : 10] * 1e-9;
+	}
+}
+
+
+// Задание названия файла архива заданий. Архив создаётся заново при каждом прогоне генератора
+void Generator::SetArchive(string archive)
+{
+	archiveFileName = archive;
+}
+
+
+// Включение записи заданий в формате RakeSearch V1/V2 (приложение RakeDiagSearchV2). Формат есть только
+// для 8 и 9 рангов, задания в нём пишутся целиком: без архива, оценки трудоёмкости и деления по префиксам
+int Generator::SetLegacyFormat(int legacy)
+{
+	if (legacy == Yes && Rank != 8 && Rank != 9)
+	{
+		isLegacyFormat = No;
+		return No;
+	}
+
+	isLegacyFormat = legacy;
+
+	return Yes;
+}
+
+
+// Задание файла с порядком обхода клеток в заданиях. Порядок сохраняется в контрольной точке и действует
+// для всех следующих заданий; клетки в файле должны совпадать с клетками, которые перебираются заданиями
+void Generator::SetWorkunitPath(string workunitPath)
+{
+	workunitPathFileName = workunitPath;
+}
+
+
+// Создание архива: в заголовок пишутся квадрат и история значений без клеток пути генератора, пути и ключевая клетка
+void Generator::OpenArchive()
+{
+	WorkunitArchiveHeader header;
+
+	header.rank = Rank;
+	for (int i = 0; i < Rank; i++)
+	{
+		for (int j = 0; j < Rank; j++)
+		{
+			header.square.push_back(newSquare.Matrix[i][j]);
+			header.history.push_back(flagsCellsHistory[i][j]);
+		}
+	}
+	for (int i = 0; i < CellsInPath; i++)
+	{
+		header.square[path[i][0] * Rank + path[i][1]] = Square<Rank>::Empty;
+		header.history[path[i][0] * Rank + path[i][1]] = AllValues;
+		header.path.push_back({ path[i][0], path[i][1] });
+	}
+	for (int i = 0; i < workunitCellsInPath; i++)
+	{
+		header.workunitPath.push_back({ workunitPath[i][0], workunitPath[i][1] });
+	}
+	header.keyRowId = workunitKeyRowId;
+	header.keyColumnId = workunitKeyColumnId;
+	header.hasEstimates = probesCount > 0;
+	header.hasOrbitSizes = symmetryReduction == Yes;
+	header.nodeCost = nodeCost;
+	header.firstNumber = snapshotNumber + 1;
+
+	archive.Open(archiveFileName, header);
+}
+
+
 // Сброс всех значений внутренних структур
 void Generator::Reset()
 {
@@ -47,26 +434,29 @@ void Generator::Reset()
 
 	// Сброс значений структур генерации квадратов
 		// Сброс значений, соответствующих ключевой клетке
-		keyRowId = Square::Empty;
-		keyColumnId = Square::Empty;
-		keyValue = Square::Empty;
+		keyRowId = Square<Rank>::Empty;
+		keyColumnId = Square<Rank>::Empty;
+		keyValue = Square<Rank>::Empty;
 
 		// Сброс значений, связанных с путём заполнения клеток
 		for (int i = 0; i < CellsInPath; i++)
 		{
-			path[i][0] = Square::Empty;
-			path[i][1] = Square::Empty;
+			path[i][0] = Square<Rank>::Empty;
+			path[i][1] = Square<Rank>::Empty;
 		}
 
+		// Сброс пути обхода клеток в заданиях
+		workunitCellsInPath = 0;
+
 		// Сброс значений в векторах использования элементов на диагонали
-		flagsPrimary = (1u << Rank) - 1;
-		flagsSecondary = (1u << Rank) - 1;
+		flagsPrimary = AllValues;
+		flagsSecondary = AllValues;
 
 		// Сброс значений в матрицах использования элементов в столбцах и строках
 		for (int i = 0; i < Rank; i++)
 		{
-			flagsColumns[i] = (1u << Rank) - 1;
-			flagsRows[i] = (1u << Rank) - 1;
+			flagsColumns[i] = AllValues;
+			flagsRows[i] = AllValues;
 		}
 
 		// Сброс значений в кубе истории использования значений в клетках
@@ -74,13 +464,13 @@ void Generator::Reset()
 		{
 			for (int j = 0; j < Rank; j++)
 			{
-				flagsCellsHistory[i][j] = (1u << Rank) - 1;
+				flagsCellsHistory[i][j] = AllValues;
 			}
 		}
 
 		// Сброс координат обрабатываемой клетки
-		rowId = Square::Empty;
-		columnId = Square::Empty;
+		rowId = Square<Rank>::Empty;
+		columnId = Square<Rank>::Empty;
 
 		// Сброс названий файлов
 		checkpointFileName.clear();
@@ -96,8 +486,26 @@ void Generator::Reset()
 		workunitKeyRowId = 0;
 		workunitKeyColumnId = 0;
 
+		// Сброс числа фиксированных клеток шарда
+		shardDepth = 0;
+
+		// Сброс симметрийной редукции
+		symmetryReduction = No;
+		symmetries.clear();
+		symmetriesInverse.clear();
+		orbitSize = 1;
+
+		// Сброс заданного порядка обхода клеток в заданиях
+		customWorkunitPath.clear();
+
+		// Сброс оценок трудоёмкости
+		minRootDepth = CellsInPath;
+		estimatedNodes = 0;
+		estimatedCost = 0;
+
 		// Сброс флага инициализированности
 		isInitialized = No;
+		isBenchmark = No;
 }
 
 
@@ -137,6 +545,32 @@ void Generator::Initialize(string start, string directory, string checkpoint, st
 
 	startFile.close();
 	checkpointFile.close();
+
+	// Порядок обхода клеток в заданиях из файла заменяет сохранённый в контрольной точке
+	if (isInitialized == Yes && !workunitPathFileName.empty() && ReadWorkunitPath() == No)
+	{
+		isInitialized = No;
+	}
+
+	// Строим путь обхода клеток для заданий
+	if (isInitialized == Yes)
+	{
+		BuildWorkunitPath();
+
+		// Задание может начинаться только после заполнения всех клеток диагоналей пути генератора
+		minRootDepth = CellsInPath;
+		while (minRootDepth > 0 && path[minRootDepth - 1][0] != path[minRootDepth - 1][1]
+			&& path[minRootDepth - 1][0] != Rank - 1 - path[minRootDepth - 1][1])
+		{
+			minRootDepth--;
+		}
+
+		// Строим группу преобразований для отбора канонических префиксов
+		if (symmetryReduction == Yes)
+		{
+			BuildSymmetries();
+		}
+	}
 }
 
 // Оператор записи состояния генератора
@@ -179,7 +613,7 @@ void Generator::Read(std::istream& is)
 	is >> rankToVerify;
 
 	// Считывание данных поиска нужного нам ранга
-	if (rankToVerify == Square::Rank)
+	if (rankToVerify == Rank)
 	{
 		// Считывание из потока квадрата
 		is >> newSquare;
@@ -291,6 +725,34 @@ void Generator::Read(std::istream& is)
 		is >> workunitKeyRowId;
 		is >> workunitKeyColumnId;
 
+		// Считывание числа фиксированных клеток шарда (в контрольных точках без шардов его может не быть)
+		if (!(is >> shardDepth))
+		{
+			shardDepth = 0;
+		}
+
+		// Считывание флага симметрийной редукции (в старых файлах его нет)
+		if (!(is >> symmetryReduction))
+		{
+			symmetryReduction = No;
+		}
+
+		// Считывание заданного порядка обхода клеток в заданиях (0 клеток - порядок по строкам)
+		int customCells = 0;
+		if (!(is >> customCells))
+		{
+			customCells = 0;
+		}
+		customWorkunitPath.resize(customCells > 0 && customCells <= MaxWorkunitCells ? customCells : 0);
+		for (size_t i = 0; i < customWorkunitPath.size(); i++)
+		{
+			is >> customWorkunitPath[i][0];
+			is >> customWorkunitPath[i][1];
+		}
+
+		// История заполненных клеток пути хранится в виде оставшихся кандидатов
+		ConvertHistoryToCandidates();
+
 		// Выставляем флаг инициализированности
 		isInitialized = Yes;
 	}
@@ -300,11 +762,15 @@ void Generator::Read(std::istream& is)
 // Запись состояния генератора в поток
 void Generator::Write(std::ostream& os)
 {
+	unsigned int history[Rank][Rank];	// История значений в клетках в формате файлов
+
+	GetCellsHistory(history);
+
 	// Запись заголовка
 	os << generatorStateHeader << endl << endl;
 
 	// Запись в поток ранга квадрата
-	os << Square::Rank << endl;
+	os << Rank << endl;
 
 	// Запись в поток квадрата
 	os << newSquare;
@@ -374,7 +840,7 @@ void Generator::Write(std::ostream& os)
 			{
 				for (int j = 0; j < Rank; j++)
 				{
-					os << ((flagsCellsHistory[i][j] & (1u << h)) > 0 ? 1 : 0) << " ";
+					os << ((history[i][j] & (1u << h)) > 0 ? 1 : 0) << " ";
 				}
 				os << endl;
 			}
@@ -389,6 +855,22 @@ void Generator::Write(std::ostream& os)
 	// Запись строки и столбца ключевой клетки для задания
 	os << workunitKeyRowId << " " << workunitKeyColumnId << endl;
 	os << endl;
+
+	// Запись числа фиксированных клеток шарда
+	os << shardDepth << endl;
+	os << endl;
+
+	// Запись флага симметрийной редукции
+	os << symmetryReduction << endl;
+	os << endl;
+
+	// Запись заданного порядка обхода клеток в заданиях
+	os << customWorkunitPath.size() << endl;
+	for (size_t i = 0; i < customWorkunitPath.size(); i++)
+	{
+		os << customWorkunitPath[i][0] << " " << customWorkunitPath[i][1] << endl;
+	}
+	os << endl;
 }
 
 
@@ -404,6 +886,9 @@ Generator& Generator::operator = (Generator& value)
 // Копирование состояния с заданного объекта
 void Generator::CopyState(Generator& source)
 {
+	// Копируем квадрат
+	newSquare = source.newSquare;
+
 	// Копируем переменные связанные с путём заполнения ячеек
 	for (int i = 0; i < CellsInPath; i++)
 	{
@@ -411,6 +896,13 @@ void Generator::CopyState(Generator& source)
 		path[i][1] = source.path[i][1];
 	}
 
+	workunitCellsInPath = source.workunitCellsInPath;
+	for (int i = 0; i < workunitCellsInPath; i++)
+	{
+		workunitPath[i][0] = source.workunitPath[i][0];
+		workunitPath[i][1] = source.workunitPath[i][1];
+	}
+
 	keyRowId = source.keyRowId;
 	keyColumnId = source.keyColumnId;
 	keyValue = source.keyValue;
@@ -445,6 +937,29 @@ void Generator::CopyState(Generator& source)
 	rowId = source.rowId;
 	columnId = source.columnId;
 	cellId = source.cellId;
+	workunitKeyRowId = source.workunitKeyRowId;
+	workunitKeyColumnId = source.workunitKeyColumnId;
+	shardDepth = source.shardDepth;
+	workunitsPrefix = source.workunitsPrefix;
+
+	// Копирование группы преобразований симметрийной редукции
+	symmetryReduction = source.symmetryReduction;
+	symmetries = source.symmetries;
+	symmetriesInverse = source.symmetriesInverse;
+	orbitSize = source.orbitSize;
+
+	// Копирование порядка обхода клеток в заданиях
+	workunitPathFileName = source.workunitPathFileName;
+	customWorkunitPath = source.customWorkunitPath;
+
+	// Копирование формата заданий
+	isLegacyFormat = source.isLegacyFormat;
+
+	// Копирование настроек балансировки заданий
+	targetCost = source.targetCost;
+	probesCount = source.probesCount;
+	nodeCost = source.nodeCost;
+	minRootDepth = source.minRootDepth;
 
 	// Копирование адресов текстовых констант
 	generatorStateHeader = source.generatorStateHeader;
@@ -469,514 +984,845 @@ void Generator::CreateCheckpoint()
 }
 
 
-// Запуск генерации заданий
-void Generator::Start()
+// Название файла задания с номером number. Задания шарда называются так же, но с префиксом prefix
+string Generator::GetWorkunitFileName(string prefix, long long number)
 {
-	unsigned long bitIndex;      // Позиция выставленного бита в "массиве" флагов
-	unsigned int freeValuesMask; // Итоговая маска из битов - флагов занятости значений
-	unsigned int isGet;          // Флаг получения нового значения для клетки
-	int cellValue;               // Новое значение для клетки
-	int oldCellValue;            // Старое значение, стоявшее в клетке
-
-	int stop = 0;                // Флаг достижения окончания расчёта
+	std::stringstream wuNameBuilder;
 
-	if (isInitialized == Yes)
+	if (!workunitsDirectory.empty())
 	{
-		// Подбор значений клеток квадрата
-		do
-		{
-			// Подбор значения для очередной клетки квадрата
-				// Считываем координаты клетки
-				rowId = path[cellId][0];
-				columnId = path[cellId][1];
+		wuNameBuilder << workunitsDirectory << "/" << prefix << "r" << Rank << "_wu_" << std::setw(16) << std::setfill('0') << number << ".txt";
+	}
+	else
+	{
+		wuNameBuilder << prefix << "rake_wu_r" << Rank << "_" << std::setw(16) << std::setfill('0') << number << ".txt";
+	}
 
-				// Генерируем новое значение для клетки (rowId, columnId)
-					// Сбрасываем значения переменных
-					cellValue = Square::Empty;
-					freeValuesMask = (1u << Rank) - 1;
-
-					// Подбираем значение для клетки
-						// Применяем маску главной диагонали
-						if (rowId == columnId)
-						{
-							freeValuesMask &= flagsPrimary;
-						}
-						// Применяем маску побочной диагонали
-						if (Rank - rowId - 1 == columnId)
-						{
-							freeValuesMask &= flagsSecondary;
-						}
-
-						// Применяем маску строк, столбцов и истории значений
-						freeValuesMask &= flagsColumns[columnId] & flagsRows[rowId] & flagsCellsHistory[rowId][columnId];
-
-						// Определяем минимально возможное для использования в клетке значение
-						# ifdef _MSC_VER
-						isGet = _BitScanForward(&bitIndex, freeValuesMask);
-						cellValue = bitIndex;
-						# else
-						bitIndex = __builtin_ffs(freeValuesMask);
-						if (bitIndex > 0)
-						{
-							isGet = 1;
-							cellValue = bitIndex - 1;
-						}
-						else
-						{
-							isGet = 0;
-						}
-						# endif
-
-				// Обработка результата поиска
-				if (isGet)
-				{
-					// Обработка найденного нового значения
-						// Считывание текущего значения
-						oldCellValue = newSquare.Matrix[rowId][columnId];
-
-						// Запись нового значения
-							// Записываем значение в квадрат
-							newSquare.Matrix[rowId][columnId] = cellValue;
-							// Отмечаем значение в столбцах
-							flagsColumns[columnId] ^= 1u << cellValue;
-							// Отмечаем значение в строках
-							flagsRows[rowId] ^= 1u << cellValue;
-							// Отмечаем значение в диагоналях
-							if (rowId == columnId)
-							{
-							 	flagsPrimary ^= 1u << cellValue;
-							}
-							if (rowId == Rank - 1 - columnId)
-							{
-								flagsSecondary ^= 1u << cellValue;
-							}
-							// Отмечаем значение в истории значений клетки
-							flagsCellsHistory[rowId][columnId] ^= 1u << cellValue;
-
-						// Возвращение предыдущего значения без зачистки истории 
-						// (так как мы работаем с этой клеткой)
-						if (oldCellValue != Square::Empty)
-						{
-							// Возвращаем значение в столбцы
-							flagsColumns[columnId] |= 1u << oldCellValue;
-							// Возвращаем значение в строки
-							flagsRows[rowId] |= 1u << oldCellValue;
-							// Возвращаем значение в диагонали
-							if (rowId == columnId)
-							{
-								flagsPrimary |= 1u << oldCellValue;
-							}
-							if (rowId == Rank - 1 - columnId)
-							{
-								flagsSecondary |= 1u << oldCellValue;
-							}
-						}
-
-						// Обработка окончания формирования квадрата
-						if (cellId == CellsInPath - 1)
-						{
-							// Генерируем задание
-							ProcessWorkunit();
-						}
-						else
-						{
-							// Делаем шаг вперёд
-							cellId++;
-						}
-				}
-				else
-				{
-					// Обработка факта ненахождения нового значения в клетке (rowId; columnId)
-						// Возвращаем текущее значение из квадрата в массивы
-						// Считываем текущее значение
-						cellValue = newSquare.Matrix[rowId][columnId];
-						// Возвращаем значение в служебные массивы
-						if (cellValue != Square::Empty)
-						{
-							// Возвращаем значение в столбцы
-							flagsColumns[columnId] |= 1u << cellValue;
-							// Возвращаем значение в строки
-							flagsRows[rowId] |= 1u << cellValue;
-							// Возвращаем значение в диагонали
-							if (rowId == columnId)
-							{
-								flagsPrimary |= 1u << cellValue;
-							}
-							if (rowId == Rank - 1 - columnId)
-							{
-								flagsSecondary |= 1u << cellValue;
-							}
-							// Сбрасываем клетку квадрата
-							newSquare.Matrix[rowId][columnId] = Square::Empty;
-							// Зачищаем историю клетки (rowId, columnId)
-							flagsCellsHistory[rowId][columnId] = (1u << Rank) - 1;
-						}
-
-						// Делаем шаг назад
-						cellId--;
-				}
+	return wuNameBuilder.str();
+}
 
-				// Проверяем условия окончания поиска
-				if (keyValue == Square::Empty)
-				{
-					// Выставление флага при завершаеющем значении "-1" при котором производится уход из клетки
-					if (newSquare.Matrix[keyRowId][keyColumnId] == keyValue && cellId < 0)
-					{
-						stop = Yes;
-					}
-				}
-				else
-				{
-					// Выставление флага при обычном завершаеющем значении
-					if (newSquare.Matrix[keyRowId][keyColumnId] == keyValue)
-					{
-						stop = Yes;
-					}
-				}
 
-				// Проверяем условие окончания генерации заданий
-				if (workunitsCount == workunitsToGenerate)
-				{
-					stop = Yes;
-				}
-		}
-		while (!stop);
+// Проверка, что генерация начинается от корня дерева: клетки пути генератора пусты, первая клетка не перебиралась
+int Generator::IsRootState()
+{
+	if (cellId != 0)
+	{
+		return No;
+	}
 
-		cout << "Number of combinations: " << workunitsCount << endl;
+	for (int i = 0; i < CellsInPath; i++)
+	{
+		if (newSquare.Matrix[path[i][0]][path[i][1]] != Square<Rank>::Empty)
+		{
+			return No;
+		}
 	}
+
+	// Кандидаты первой клетки - все свободные значения
+	return flagsCellsHistory[path[0][0]][path[0][1]] == GetFreeValues(0) ? Yes : No;
 }
 
 
-// Обработка квадрата
-void Generator::ProcessWorkunit()
+// Запуск генерации заданий
+void Generator::Start()
 {
-	switch (Rank)
+	// Генерация уже завершена - генератор ушёл из первой клетки пути (или из клеток шарда)
+	if (isInitialized != Yes || cellId < shardDepth)
 	{
-		case 8:
-			ProcessWorkunitR8();
-		break;
+		return;
+	}
 
-		case 9:
-			ProcessWorkunitR9();
-		break;
+	// Вид проверки ключевой клетки выбирается при компиляции, как в RakeSearch::StartImpl
+	if (keyValue == Square<Rank>::Empty)
+	{
+		StartImpl<true_type>();
+	}
+	else
+	{
+		StartImpl<false_type>();
+	}
 
-		case 10:
-			ProcessWorkunitR10();
-		break;
-  }
+	if (shardDepth == 0)
+	{
+		cout << "Number of combinations: " << workunitsCount << endl;
+	}
 }
 
 
-// Формирование очередного задания для квадратов 8-го ранга
-void Generator::ProcessWorkunitR8()
+// Обход клеток пути генератора. История заполненной клетки - кандидаты в её значения, ещё не перебранные:
+// при входе в клетку кандидаты вычисляются по флагам один раз, затем берутся из истории, поэтому при шаге
+// назад ни пересчёт маски, ни зачистка истории не нужны. Состояния, в которых обход останавливается, такие же,
+// как у прежнего обхода: заполненные клетки отмечены во флагах, текущая клетка - cellId
+template <typename IsKeyValueEmpty>
+void Generator::StartImpl()
 {
-	fstream workunitFile;
-	string workunitFileName;
-	std::stringstream wuNameBuilder;
-	int workunitNumber;
-	int workunitKeyCellValue;
-
-	// Увеличиваем счётчик номера снимка
-	snapshotNumber++;
-
-	// Формируем задание
-		// Определение номера задания и стопорного значения ключевой клетки
-		workunitNumber = snapshotNumber;
-		workunitKeyCellValue = newSquare.Matrix[workunitKeyRowId][workunitKeyColumnId];
-
-		// Формируем название файла
-		if (!workunitsDirectory.empty())
+	unsigned int cellValueCandidates;	// Кандидаты в значения клетки
+	unsigned int bit;					// Бит выбранного значения
+	int cellValue;						// Значение клетки
+
+	// Продолжение с клетки cellId: её значение возвращается во флаги, кандидаты - из истории
+	rowId = path[cellId][0];
+	columnId = path[cellId][1];
+	cellValue = newSquare.Matrix[rowId][columnId];
+	if (cellValue != Square<Rank>::Empty)
+	{
+		bit = 1u << cellValue;
+		flagsColumns[columnId] |= bit;
+		flagsRows[rowId] |= bit;
+		if (rowId == columnId)
 		{
-			wuNameBuilder << workunitsDirectory << "wu_" << std::setw(6) << std::setfill('0') << workunitNumber << ".txt";
+			flagsPrimary |= bit;
 		}
-		else
+		if (rowId == Rank - 1 - columnId)
 		{
-			wuNameBuilder << "wu_" << std::setw(6) << std::setfill('0') << workunitNumber << ".txt";
+			flagsSecondary |= bit;
 		}
-		workunitFileName = wuNameBuilder.str();
-
-		// Формируем файл с заданием
-		cout << "Workunit " << workunitFileName << ":" << endl;
-		cout << newSquare << endl;
-
-		// Открываем файл
-		workunitFile.open(workunitFileName.c_str(), std::ios_base::out);
-
-		// Записываем заголовки и квадрат, с которого надо начинать генерацию
-		workunitFile << "# Move search of pairs OLDS status" << endl
-			<< endl
-			<< "# Generation of DLS status" << endl
-			<< endl
-			<< Rank << endl
-			<< endl
-			<< newSquare
-			<< endl;
-
-		// Записываем число клеток в пути
-		workunitFile << (Rank - 1)*Rank - CellsInPath << endl
-			<< endl;
-
-		// Записываем путь переходов по клеткам
-		workunitFile << "7 0" << endl << "6 1" << endl << "5 2" << endl << "4 3" << endl << "3 4" << endl << "2 5" << endl << "1 6" << endl
-			<< "1 0" << endl << "1 2" << endl << "1 3" << endl << "1 4" << endl << "1 5" << endl << "1 7" << endl
-			<< "2 0" << endl << "2 1" << endl << "2 3" << endl << "2 4" << endl << "2 6" << endl << "2 7" << endl
-			<< "3 0" << endl << "3 1" << endl << "3 2" << endl << "3 5" << endl << "3 6" << endl << "3 7" << endl
-			<< "4 0" << endl << "4 1" << endl << "4 2" << endl << "4 5" << endl << "4 6" << endl << "4 7" << endl
-			<< "5 0" << endl << "5 1" << endl << "5 3" << endl << "5 4" << endl << "5 6" << endl << "5 7" << endl
-			<< "6 0" << endl << "6 2" << endl << "6 3" << endl << "6 4" << endl << "6 5" << endl << "6 7" << endl
-			<< "7 1" << endl << "7 2" << endl << "7 3" << endl << "7 4" << endl << "7 5" << endl << "7 6" << endl << endl;
-
-		// Запись координаты ключевой клетки и её значение
-		workunitFile << workunitKeyRowId << " " << workunitKeyColumnId << " " << workunitKeyCellValue << endl;
-		// Запись координат текущей клетки и идентификатора текущей клетки в пути
-		workunitFile << workunitKeyRowId << " " << workunitKeyColumnId << " " << 0 << endl;
-		workunitFile << endl;
+		newSquare.Matrix[rowId][columnId] = Square<Rank>::Empty;
+	}
+	cellValueCandidates = flagsCellsHistory[rowId][columnId];
 
-		// Запись состояний диагоналей, строк, столбцов и истории использования значений (копия из Write!)
-			// Запись информации о значениях на главной диагонали
-			for (int i = 0; i < Rank; i++)
+	while (1)
+	{
+		if (cellValueCandidates)
+		{
+			// Берём минимальное значение, остальные кандидаты остаются в истории клетки
+			bit = cellValueCandidates & (0u - cellValueCandidates);
+			cellValue = __builtin_ctz(bit);
+			flagsCellsHistory[rowId][columnId] = cellValueCandidates & ~bit;
+
+			// Записываем значение в квадрат и отмечаем его в столбце, строке и диагоналях
+			newSquare.Matrix[rowId][columnId] = cellValue;
+			flagsColumns[columnId] &= ~bit;
+			flagsRows[rowId] &= ~bit;
+			if (rowId == columnId)
 			{
-				workunitFile << ((flagsPrimary & (1u << i)) > 0 ? 1 : 0) << " ";
+				flagsPrimary &= ~bit;
 			}
-			workunitFile << endl;
-
-			// Запись информации о значениях на побочной диагонали
-			for (int i = 0; i < Rank; i++)
+			if (rowId == Rank - 1 - columnId)
 			{
-				workunitFile << ((flagsSecondary & (1u << i)) > 0 ? 1 : 0) << " ";
+				flagsSecondary &= ~bit;
 			}
-			workunitFile << endl;
 
-			// Дополнительная пустая строка
-			workunitFile << endl;
-
-			// Запись информации о значениях в строках
-			for (int i = 0; i < Rank; i++)
+			if (cellId == CellsInPath - 1)
 			{
-				for (int j = 0; j < Rank; j++)
-				{
-					workunitFile << ((flagsRows[i] & (1u << j)) > 0 ? 1 : 0) << " ";
-				}
-				workunitFile << endl;
+				// Квадрат сформирован - генерируем задание
+				ProcessWorkunit(CellsInPath);
 			}
-			workunitFile << endl;
-
-			// Запись информации о значениях в столбцах
-			for (int i = 0; i < Rank; i++)
+			else if (targetCost > 0 && IsCheapSubtree(cellId + 1))
 			{
-				for (int j = 0; j < Rank; j++)
+				// Поддерево укладывается в целевую трудоёмкость - генерируем по нему одно задание
+				ProcessWorkunit(cellId + 1);
+			}
+			else if (IsPrunedBySymmetry(cellId + 1))
+			{
+				// Заполненные диагонали уже дают меньший эквивалентный префикс - поддерево пропускается
+			}
+			else
+			{
+				// Шаг вперёд: кандидаты новой клетки - значения, свободные в её столбце, строке и диагоналях
+				cellId++;
+				rowId = path[cellId][0];
+				columnId = path[cellId][1];
+				cellValueCandidates = flagsColumns[columnId] & flagsRows[rowId];
+				if (rowId == columnId)
 				{
-					workunitFile << ((flagsColumns[j] & (1u << i)) > 0 ? 1 : 0) << " ";
+					cellValueCandidates &= flagsPrimary;
+				}
+				if (rowId == Rank - 1 - columnId)
+				{
+					cellValueCandidates &= flagsSecondary;
 				}
-				workunitFile << endl;
-			}
-			workunitFile << endl;
 
-			// Запись информации об истории значений в клетках квадрата
-			for (int h = 0; h < Rank; h++)
-			{
-				for (int i = 0; i < Rank; i++)
+				// Проверяем достижение ключевого значения
+				if (!IsKeyValueEmpty::value && newSquare.Matrix[keyRowId][keyColumnId] == keyValue)
 				{
-					for (int j = 0; j < Rank; j++)
-					{
-						workunitFile << ((flagsCellsHistory[i][j] & (1u << h)) > 0 ? 1 : 0) << " ";
-					}
-					workunitFile << endl;
+					flagsCellsHistory[rowId][columnId] = cellValueCandidates;
+					break;
 				}
-				workunitFile << endl;
+
+				continue;
 			}
-			workunitFile << endl;
 
-			// Запись информации о числе сгенерированных WU
-			workunitFile << 0 << endl
-				<< endl;
+			// Проверяем условия окончания генерации после записи задания
+			if (!IsKeyValueEmpty::value && newSquare.Matrix[keyRowId][keyColumnId] == keyValue)
+			{
+				break;
+			}
+			if (workunitsCount >= workunitsToGenerate)
+			{
+				break;
+			}
+		}
+		else
+		{
+			// Кандидатов нет - шаг назад. Уход из первой клетки пути (или из клеток шарда) завершает генерацию
+			cellId--;
+			if (cellId < shardDepth)
+			{
+				break;
+			}
+			rowId = path[cellId][0];
+			columnId = path[cellId][1];
 
-			// Запись данных компоненты перетасовки строк
-			workunitFile << "# Move search component status" << endl
-				<< endl
-				<< "0 0 0" << endl
-				<< "0 0" << endl;
+			// Проверяем достижение ключевого значения
+			if (!IsKeyValueEmpty::value && newSquare.Matrix[keyRowId][keyColumnId] == keyValue)
+			{
+				break;
+			}
 
-			// Закрываем файл
-			workunitFile.close();
+			bit = 1u << newSquare.Matrix[rowId][columnId];
+		}
 
-	// Увеличиваем счётчик сгенерированных заданий 
-	workunitsCount++;
+		// Возвращаем значение клетки во флаги, следующий кандидат - из истории клетки
+		flagsColumns[columnId] |= bit;
+		flagsRows[rowId] |= bit;
+		if (rowId == columnId)
+		{
+			flagsPrimary |= bit;
+		}
+		if (rowId == Rank - 1 - columnId)
+		{
+			flagsSecondary |= bit;
+		}
+		newSquare.Matrix[rowId][columnId] = Square<Rank>::Empty;
+		cellValueCandidates = flagsCellsHistory[rowId][columnId];
+	}
 }
 
 
-// Формирование очередного задания для квадратов 9-го ранга
-void Generator::ProcessWorkunitR9()
+// Перевод истории клеток пути, считанной из файла (перебранные значения сброшены), в оставшиеся кандидаты:
+// кандидаты клетки - значения, свободные при входе в неё (флаги без значений этой и следующих клеток пути),
+// кроме уже перебранных. Для пустой текущей клетки это кандидаты, с которых начнётся её перебор
+void Generator::ConvertHistoryToCandidates()
 {
-	fstream workunitFile;
-	string workunitFileName;
-	std::stringstream wuNameBuilder;
-	int workunitNumber;
-	int workunitKeyCellValue;
+	unsigned int rows[Rank];
+	unsigned int columns[Rank];
+	unsigned int primary = flagsPrimary;
+	unsigned int secondary = flagsSecondary;
 
-	// Увеличиваем счётчик номера снимка
-	snapshotNumber++;
+	for (int i = 0; i < Rank; i++)
+	{
+		rows[i] = flagsRows[i];
+		columns[i] = flagsColumns[i];
+	}
 
-	// Формируем задание
-		// Определение номера задания и стопорного значения ключевой клетки
-		workunitNumber = snapshotNumber;
-		workunitKeyCellValue = newSquare.Matrix[workunitKeyRowId][workunitKeyColumnId];
+	for (int i = CellsInPath - 1; i >= 0; i--)
+	{
+		int r = path[i][0];
+		int c = path[i][1];
+		int value = newSquare.Matrix[r][c];
 
-		// Формируем название файла
-		if (!workunitsDirectory.empty())
+		if (value == Square<Rank>::Empty && i != cellId)
 		{
-			wuNameBuilder << workunitsDirectory << "/wu_" << std::setw(9) << std::setfill('0') << workunitNumber << ".txt";
+			continue;
 		}
-		else
+
+		if (value != Square<Rank>::Empty)
 		{
-			wuNameBuilder << "wu_" << std::setw(9) << std::setfill('0') << workunitNumber << ".txt";
+			rows[r] |= 1u << value;
+			columns[c] |= 1u << value;
+			if (r == c)
+			{
+				primary |= 1u << value;
+			}
+			if (r == Rank - 1 - c)
+			{
+				secondary |= 1u << value;
+			}
 		}
-		workunitFileName = wuNameBuilder.str();
 
-		// Формируем файл с заданием
-		cout << "Workunit " << workunitFileName << ":" << endl;
-		cout << newSquare << endl;
+		flagsCellsHistory[r][c] &= rows[r] & columns[c] & (r == c ? primary : ~0u) & (r == Rank - 1 - c ? secondary : ~0u);
+	}
+}
 
-		// Открываем файл
-		workunitFile.open(workunitFileName.c_str(), std::ios_base::out);
 
-		// Записываем заголовки и квадрат, с которого надо начинать генерацию
-		workunitFile << "# Move search of pairs OLDS status" << endl
-			<< endl
-			<< "# Generation of DLS status" << endl
-			<< endl
-			<< Rank << endl
-			<< endl
-			<< newSquare
-			<< endl;
+// История клеток в формате файлов: у заполненных клеток пути сброшены перебранные значения (свободные при
+// входе в клетку, но не оставшиеся в кандидатах), у пустых клеток пути история полная
+void Generator::GetCellsHistory(unsigned int history[Rank][Rank])
+{
+	unsigned int rows[Rank];
+	unsigned int columns[Rank];
+	unsigned int primary = flagsPrimary;
+	unsigned int secondary = flagsSecondary;
 
-		// Записываем число клеток в пути
-		workunitFile << (Rank - 1)*Rank - CellsInPath << endl
-			<< endl;
+	for (int i = 0; i < Rank; i++)
+	{
+		rows[i] = flagsRows[i];
+		columns[i] = flagsColumns[i];
+		for (int j = 0; j < Rank; j++)
+		{
+			history[i][j] = flagsCellsHistory[i][j];
+		}
+	}
 
-		// Записываем путь переходов по клеткам
-		workunitFile << "1 2" << endl << "1 3" << endl << "1 4" << endl << "1 5" << endl << "1 6" << endl << "1 8" << endl
-			<< "2 0" << endl << "2 1" << endl << "2 3" << endl << "2 4" << endl << "2 5" << endl << "2 7" << endl << "2 8" << endl
-			<< "3 0" << endl << "3 1" << endl << "3 2" << endl << "3 4" << endl << "3 6" << endl << "3 7" << endl << "3 8" << endl
-			<< "4 0" << endl << "4 1" << endl << "4 2" << endl << "4 3" << endl << "4 5" << endl << "4 6" << endl << "4 7" << endl << "4 8" << endl
-			<< "5 0" << endl << "5 1" << endl << "5 2" << endl << "5 4" << endl << "5 6" << endl << "5 7" << endl << "5 8" << endl
-			<< "6 0" << endl << "6 1" << endl << "6 3" << endl << "6 4" << endl << "6 5" << endl << "6 7" << endl << "6 8" << endl
-			<< "7 0" << endl << "7 2" << endl << "7 3" << endl << "7 4" << endl << "7 5" << endl << "7 6" << endl << "7 8" << endl
-			<< "8 1" << endl << "8 2" << endl << "8 3" << endl << "8 4" << endl << "8 5" << endl << "8 6" << endl << "8 7" << endl << endl;
+	for (int i = CellsInPath - 1; i >= 0; i--)
+	{
+		int r = path[i][0];
+		int c = path[i][1];
+		int value = newSquare.Matrix[r][c];
 
-		// Запись координаты ключевой клетки и её значение
-		workunitFile << workunitKeyRowId << " " << workunitKeyColumnId << " " << workunitKeyCellValue << endl;
-		// Запись координат текущей клетки и идентификатора текущей клетки в пути
-		workunitFile << workunitKeyRowId << " " << workunitKeyColumnId << " " << 0 << endl;
-		workunitFile << endl;
+		if (value == Square<Rank>::Empty)
+		{
+			history[r][c] = AllValues;
+			continue;
+		}
 
-		// Запись состояний диагоналей, строк, столбцов и истории использования значений (копия из Write!)
-			// Запись информации о значениях на главной диагонали
-			for (int i = 0; i < Rank; i++)
-			{
-				workunitFile << ((flagsPrimary & (1u << i)) > 0 ? 1 : 0) << " ";
-			}
-			workunitFile << endl;
+		rows[r] |= 1u << value;
+		columns[c] |= 1u << value;
+		if (r == c)
+		{
+			primary |= 1u << value;
+		}
+		if (r == Rank - 1 - c)
+		{
+			secondary |= 1u << value;
+		}
 
-			// Запись информации о значениях на побочной диагонали
-			for (int i = 0; i < Rank; i++)
-			{
-				workunitFile << ((flagsSecondary & (1u << i)) > 0 ? 1 : 0) << " ";
-			}
-			workunitFile << endl;
+		unsigned int entryValues = rows[r] & columns[c] & (r == c ? primary : ~0u) & (r == Rank - 1 - c ? secondary : ~0u);
+		history[r][c] = AllValues & ~(entryValues & ~flagsCellsHistory[r][c]);
+	}
+}
 
-			// Дополнительная пустая строка
-			workunitFile << endl;
 
-			// Запись информации о значениях в строках
-			for (int i = 0; i < Rank; i++)
+// Построение пути обхода клеток для заданий: все пустые клетки вне диагоналей, не заполняемые генератором, по строкам
+void Generator::BuildWorkunitPath()
+{
+	int isInGeneratorPath;	// Флаг вхождения клетки в путь обхода генератора
+
+	workunitCellsInPath = 0;
+
+	for (int i = 0; i < Rank; i++)
+	{
+		for (int j = 0; j < Rank; j++)
+		{
+			// Проверяем, заполняется ли клетка генератором
+			isInGeneratorPath = No;
+			for (int k = 0; k < CellsInPath; k++)
 			{
-				for (int j = 0; j < Rank; j++)
+				if (path[k][0] == i && path[k][1] == j)
 				{
-					workunitFile << ((flagsRows[i] & (1u << j)) > 0 ? 1 : 0) << " ";
+					isInGeneratorPath = Yes;
 				}
-				workunitFile << endl;
 			}
-			workunitFile << endl;
 
-			// Запись информации о значениях в столбцах
-			for (int i = 0; i < Rank; i++)
+			if (isInGeneratorPath == No && newSquare.Matrix[i][j] == Square<Rank>::Empty)
 			{
-				for (int j = 0; j < Rank; j++)
+				if (i == j || i == Rank - 1 - j)
 				{
-					workunitFile << ((flagsColumns[j] & (1u << i)) > 0 ? 1 : 0) << " ";
+					// Клетки диагоналей поиском в задании не перебираются - их должен заполнить генератор
+					cout << "Diagonal cell (" << i << ", " << j << ") is not filled by the generator path!" << endl;
+					isInitialized = No;
 				}
-				workunitFile << endl;
-			}
-			workunitFile << endl;
-
-			// Запись информации об истории значений в клетках квадрата
-			for (int h = 0; h < Rank; h++)
-			{
-				for (int i = 0; i < Rank; i++)
+				else
 				{
-					for (int j = 0; j < Rank; j++)
-					{
-						workunitFile << ((flagsCellsHistory[i][j] & (1u << h)) > 0 ? 1 : 0) << " ";
-					}
-					workunitFile << endl;
+					workunitPath[workunitCellsInPath][0] = i;
+					workunitPath[workunitCellsInPath][1] = j;
+					workunitCellsInPath++;
 				}
-				workunitFile << endl;
 			}
-			workunitFile << endl;
+		}
+	}
 
-			// Запись информации о числе сгенерированных WU
-			workunitFile << 0 << endl
-				<< endl;
+	// Заданный порядок обхода должен быть перестановкой тех же клеток. Ключевая клетка заданий - первая клетка пути
+	if (!customWorkunitPath.empty())
+	{
+		int isCellInPath[Rank][Rank] = {};
+		int isMatched = (int)customWorkunitPath.size() == workunitCellsInPath ? Yes : No;
 
-			// Запись данных компоненты перетасовки строк
-			workunitFile << "# Move search component status" << endl
-				<< endl
-				<< "0 0 0" << endl
-				<< "0 0" << endl;
+		for (int k = 0; k < workunitCellsInPath; k++)
+		{
+			isCellInPath[workunitPath[k][0]][workunitPath[k][1]] = Yes;
+		}
+		for (size_t k = 0; k < customWorkunitPath.size() && isMatched == Yes; k++)
+		{
+			int r = customWorkunitPath[k][0];
+			int c = customWorkunitPath[k][1];
 
-		// Закрываем файл
-		workunitFile.close();
+			if (r < 0 || r >= Rank || c < 0 || c >= Rank || isCellInPath[r][c] == No)
+			{
+				isMatched = No;
+			}
+			else
+			{
+				isCellInPath[r][c] = No;
+			}
+		}
 
-	// Увеличиваем счётчик сгенерированных заданий 
-	workunitsCount++;
+		if (isMatched == No)
+		{
+			cout << "Workunit path does not match cells of workunits!" << endl;
+			isInitialized = No;
+			return;
+		}
+
+		for (int k = 0; k < workunitCellsInPath; k++)
+		{
+			workunitPath[k][0] = customWorkunitPath[k][0];
+			workunitPath[k][1] = customWorkunitPath[k][1];
+		}
+		workunitKeyRowId = workunitPath[0][0];
+		workunitKeyColumnId = workunitPath[0][1];
+	}
 }
 
 
-// Формирование очередного задания для квадратов 10-го ранга
-void Generator::ProcessWorkunitR10()
+// Считывание порядка обхода клеток в заданиях из файла, записанного RakePathOptimizer: после заголовка
+// идут число клеток и координаты клеток (строка, столбец) в порядке обхода
+int Generator::ReadWorkunitPath()
+{
+	fstream pathFile;
+	string marker;
+	int cellsCount = 0;
+
+	pathFile.open(workunitPathFileName.c_str(), std::ios_base::in);
+	do
+	{
+		std::getline(pathFile, marker);
+	}
+	while (pathFile && marker != "# Workunit path for RakeSearch");
+
+	if (!(pathFile >> cellsCount) || cellsCount <= 0 || cellsCount > MaxWorkunitCells)
+	{
+		cout << "Error reading workunit path from " << workunitPathFileName << "!" << endl;
+		return No;
+	}
+
+	customWorkunitPath.resize(cellsCount);
+	for (int i = 0; i < cellsCount; i++)
+	{
+		if (!(pathFile >> customWorkunitPath[i][0] >> customWorkunitPath[i][1]))
+		{
+			cout << "Error reading workunit path from " << workunitPathFileName << "!" << endl;
+			customWorkunitPath.clear();
+			return No;
+		}
+	}
+
+	return Yes;
+}
+
+
+// Проверка, укладывается ли поддерево с depth заполненными клетками пути генератора в целевую трудоёмкость задания
+int Generator::IsCheapSubtree(int depth)
+{
+	// При симметрийной редукции канонические префиксы отбираются только в листьях дерева генератора,
+	// поэтому поддеревья одним заданием не оформляются
+	if (targetCost <= 0 || depth < minRootDepth || symmetryReduction == Yes)
+	{
+		return No;
+	}
+
+	EstimateSubtree(depth, 0);
+
+	return estimatedCost <= targetCost ? Yes : No;
+}
+
+
+// Оценка трудоёмкости поддерева случайными спусками по пути будущего задания (оценка Кнута): каждый спуск
+// выбирает в клетке случайное допустимое значение, а произведение числа вариантов на пройденных уровнях даёт
+// несмещённую оценку числа узлов соответствующего уровня поддерева. Путь задания - клетки пути генератора, начиная
+// с depth, затем путь обхода заданий; первые fixedCells клеток пути задания уже заполнены (учтены во флагах)
+void Generator::EstimateSubtree(int depth, int fixedCells)
+{
+	const int generatorCells = CellsInPath - depth;
+	const int cellsCount = generatorCells + workunitCellsInPath;
+	unsigned int rows[Rank];
+	unsigned int columns[Rank];
+
+	estimatedNodes = 0;
+	estimatedCost = 0;
+
+	if (probesCount <= 0)
+	{
+		return;
+	}
+
+	for (int probe = 0; probe < probesCount; probe++)
+	{
+		double weight = 1;
+
+		for (int i = 0; i < Rank; i++)
+		{
+			rows[i] = flagsRows[i];
+			columns[i] = flagsColumns[i];
+		}
+
+		estimatedNodes += 1;
+
+		for (int k = fixedCells; k < cellsCount; k++)
+		{
+			int r = k < generatorCells ? path[depth + k][0] : workunitPath[k - generatorCells][0];
+			int c = k < generatorCells ? path[depth + k][1] : workunitPath[k - generatorCells][1];
+			unsigned int freeValuesMask = rows[r] & columns[c];
+			int count = __builtin_popcount(freeValuesMask);
+
+			if (count == 0)
+			{
+				break;
+			}
+
+			// Выбираем случайное значение из допустимых
+			for (int n = randomGenerator() % count; n > 0; n--)
+			{
+				freeValuesMask &= freeValuesMask - 1;
+			}
+			int value = __builtin_ctz(freeValuesMask);
+			rows[r] &= ~(1u << value);
+			columns[c] &= ~(1u << value);
+
+			weight *= count;
+			estimatedNodes += weight;
+		}
+	}
+
+	estimatedNodes /= probesCount;
+	estimatedCost = estimatedNodes * nodeCost;
+}
+
+
+// Подсчёт числа префиксов пути задания при заполненных pathPos первых клетках пути обхода заданий
+int Generator::CountPathPrefixes(int pathPos)
+{
+	int count = 0;
+
+	if (pathPos == PathPrefixCells)
+	{
+		return 1;
+	}
+
+	int r = workunitPath[pathPos][0];
+	int c = workunitPath[pathPos][1];
+	unsigned int freeValuesMask = flagsRows[r] & flagsColumns[c] & flagsCellsHistory[r][c];
+
+	for (int n = 0; n < Rank; n++)
+	{
+		if (freeValuesMask & (1u << n))
+		{
+			flagsRows[r] &= ~(1u << n);
+			flagsColumns[c] &= ~(1u << n);
+
+			count += CountPathPrefixes(pathPos + 1);
+
+			flagsRows[r] |= 1u << n;
+			flagsColumns[c] |= 1u << n;
+		}
+	}
+
+	return count;
+}
+
+
+// Деление задания по диапазонам префиксов пути: обход префиксов в порядке RakeSearch::GeneratePathPrefixes,
+// слишком трудоёмкие поддеревья делятся дальше, а подряд идущие "дешёвые" поддеревья собираются в один диапазон
+void Generator::SplitWorkunit(int pathPos)
+{
+	EstimateSubtree(CellsInPath, pathPos);
+
+	if (pathPos == PathPrefixCells || estimatedCost <= targetCost)
+	{
+		int count = CountPathPrefixes(pathPos);
+
+		if (count > 0)
+		{
+			// Начинаем новый диапазон, если поддерево в текущий не помещается
+			if (ranges.empty() || (ranges.back().end > ranges.back().start && ranges.back().cost + estimatedCost > targetCost))
+			{
+				ranges.push_back({ rangePosition, rangePosition, 0, 0 });
+			}
+
+			rangePosition += count;
+			ranges.back().end = rangePosition;
+			ranges.back().nodes += estimatedNodes;
+			ranges.back().cost += estimatedCost;
+		}
+	}
+	else
+	{
+		int r = workunitPath[pathPos][0];
+		int c = workunitPath[pathPos][1];
+		unsigned int freeValuesMask = flagsRows[r] & flagsColumns[c] & flagsCellsHistory[r][c];
+
+		for (int n = 0; n < Rank; n++)
+		{
+			if (freeValuesMask & (1u << n))
+			{
+				flagsRows[r] &= ~(1u << n);
+				flagsColumns[c] &= ~(1u << n);
+
+				SplitWorkunit(pathPos + 1);
+
+				flagsRows[r] |= 1u << n;
+				flagsColumns[c] |= 1u << n;
+			}
+		}
+	}
+}
+
+
+// Построение группы преобразований, переводящих префиксы пути генератора в префиксы. Перестановка p применяется
+// к строкам, столбцам и значениям: B[p(i)][p(j)] = p(A[i][j]). Диагонали сохраняются, если p(Rank-1-i) = Rank-1-p(i),
+// первая строка остаётся нормализованной, если p(0) = 0. Вторая строка и клетки (2, 0), (2, 1) остаются на месте
+// при p(1) = 1 и p(2) = 2, поэтому строки 0, 1, 2 и симметричные им неподвижны, а остальные пары строк
+// (i, Rank-1-i) переставляются между собой и внутри пары: 2^k * k! преобразований для k пар
+void Generator::BuildSymmetries()
+{
+	vector<int> pairs;
+	vector<int> order;
+	array<int, Rank> p;
+	array<int, Rank> q;
+	long long groupSize = 1;
+
+	for (int i = 3; i < Rank - 1 - i; i++)
+	{
+		pairs.push_back(i);
+		order.push_back((int)order.size());
+		groupSize *= 2 * (long long)pairs.size();
+	}
+
+	if (groupSize > MaxSymmetries)
+	{
+		throw("Symmetry reduction is not supported for this rank.");
+	}
+
+	symmetries.clear();
+	symmetriesInverse.clear();
+
+	do
+	{
+		for (int flips = 0; flips < (1 << pairs.size()); flips++)
+		{
+			for (int i = 0; i < Rank; i++)
+			{
+				p[i] = i;
+			}
+			for (size_t k = 0; k < pairs.size(); k++)
+			{
+				int image = (flips & (1 << k)) ? Rank - 1 - pairs[order[k]] : pairs[order[k]];
+				p[pairs[k]] = image;
+				p[Rank - 1 - pairs[k]] = Rank - 1 - image;
+			}
+
+			// Тождественное преобразование не хранится
+			if (flips == 0 && is_sorted(order.begin(), order.end()))
+			{
+				continue;
+			}
+
+			for (int i = 0; i < Rank; i++)
+			{
+				q[p[i]] = i;
+			}
+			symmetries.push_back(p);
+			symmetriesInverse.push_back(q);
+		}
+	}
+	while (next_permutation(order.begin(), order.end()));
+}
+
+
+// Проверка, что префикс из depth заполненных клеток пути генератора может быть лексикографически минимальным
+// (в порядке пути) префиксом своей орбиты. Образ сравнивается с префиксом до первой клетки, значение которой
+// в образе ещё не определено; если образ меньше уже на определённой части, неканоничны все продолжения префикса.
+// Для заполненного пути вычисляется размер орбиты: размер группы, делённый на размер стабилизатора префикса
+int Generator::IsCanonicalPrefix(int depth)
+{
+	int stabilizerSize = 1;
+
+	for (size_t s = 0; s < symmetries.size(); s++)
+	{
+		const array<int, Rank>& p = symmetries[s];
+		const array<int, Rank>& q = symmetriesInverse[s];
+		int difference = 0;
+		int i;
+
+		for (i = 0; i < depth && difference == 0; i++)
+		{
+			int source = newSquare.Matrix[q[path[i][0]]][q[path[i][1]]];
+
+			if (source == Square<Rank>::Empty)
+			{
+				break;
+			}
+			difference = p[source] - newSquare.Matrix[path[i][0]][path[i][1]];
+		}
+
+		if (difference < 0)
+		{
+			return No;
+		}
+		if (difference == 0 && i == CellsInPath)
+		{
+			stabilizerSize++;
+		}
+	}
+
+	orbitSize = ((int)symmetries.size() + 1) / stabilizerSize;
+
+	return Yes;
+}
+
+
+// Отсечение поддерева с depth заполненными клетками пути генератора симметрийной редукцией. Проверка выполняется
+// после заполнения главной диагонали и после заполнения обеих диагоналей: образы их клеток уже определены
+int Generator::IsPrunedBySymmetry(int depth)
+{
+	if (symmetryReduction == No || (depth != Rank - 1 && depth != minRootDepth))
+	{
+		return No;
+	}
+
+	return IsCanonicalPrefix(depth) == Yes ? No : Yes;
+}
+
+
+// Формирование задания по поддереву с depth заполненными клетками пути генератора.
+// Слишком трудоёмкое задание делится на несколько заданий по диапазонам префиксов пути
+void Generator::ProcessWorkunit(int depth)
+{
+	// Префиксы, эквивалентные меньшему префиксу, пропускаются: их результат получается преобразованием
+	if (symmetryReduction == Yes && depth == CellsInPath && IsCanonicalPrefix(CellsInPath) == No)
+	{
+		return;
+	}
+
+	// Задания формата V1/V2 пишутся прежними функциями
+	if (isLegacyFormat == Yes)
+	{
+		switch (Rank)
+		{
+			case 8:
+				ProcessWorkunitR8();
+			break;
+
+			case 9:
+				ProcessWorkunitR9();
+			break;
+		}
+
+		return;
+	}
+
+	// Оценка неполных поддеревьев уже выполнена при проверке их трудоёмкости
+	if (depth == CellsInPath)
+	{
+		EstimateSubtree(depth, 0);
+	}
+
+	if (targetCost > 0 && depth == CellsInPath && estimatedCost > targetCost && workunitCellsInPath > PathPrefixCells)
+	{
+		double nodes = estimatedNodes;
+
+		ranges.clear();
+		rangePosition = 0;
+
+		SplitWorkunit(0);
+
+		// Задания записываются после обхода, когда флаги снова соответствуют квадрату.
+		// Если деления не произошло - задание записывается целиком
+		if (ranges.size() > 1)
+		{
+			for (const PrefixRange& range : ranges)
+			{
+				WriteWorkunit(depth, range.start, range.end, range.nodes);
+			}
+		}
+		else
+		{
+			WriteWorkunit(depth, 0, -1, nodes);
+		}
+	}
+	else
+	{
+		WriteWorkunit(depth, 0, -1, estimatedNodes);
+	}
+}
+
+
+// Запись файла задания по поддереву с depth заполненными клетками пути генератора. Путь задания - оставшиеся
+// клетки пути генератора и путь обхода заданий. При rangeEnd >= 0 задание ограничивается диапазоном префиксов пути
+void Generator::WriteWorkunit(int depth, int rangeStart, int rangeEnd, double nodes)
 {
-	fstream workunitFile;
 	string workunitFileName;
-	std::stringstream wuNameBuilder;
 	long long workunitNumber;
+	unsigned int history[Rank][Rank];
 	int workunitKeyCellValue;
+	int keyRow;
+	int keyColumn;
 
 	// Увеличиваем счётчик номера снимка
 	snapshotNumber++;
 
+	// При замере скорости задания только подсчитываются
+	if (isBenchmark == Yes)
+	{
+		workunitsCount++;
+		return;
+	}
+
+	// Запись задания в архив: значения заполненных клеток пути генератора и диапазон префиксов
+	if (archive.IsOpen())
+	{
+		WorkunitArchiveRecord record;
+
+		for (int i = 0; i < depth; i++)
+		{
+			record.values.push_back(newSquare.Matrix[path[i][0]][path[i][1]]);
+		}
+		record.rangeStart = rangeStart;
+		record.rangeEnd = rangeEnd;
+		record.estimatedNodes = nodes;
+		record.orbitSize = orbitSize;
+		archive.Add(record);
+
+		workunitsCount++;
+
+		return;
+	}
+
 	// Формируем задание
 		// Определение номера задания и стопорного значения ключевой клетки
 		workunitNumber = snapshotNumber;
-		workunitKeyCellValue = newSquare.Matrix[workunitKeyRowId][workunitKeyColumnId];
 
-		// Формируем название файла
-		if (!workunitsDirectory.empty())
+		// Ключевая клетка - первая клетка пути задания
+		if (depth < CellsInPath)
 		{
-			wuNameBuilder << workunitsDirectory << "/r10_wu_" << std::setw(16) << std::setfill('0') << workunitNumber << ".txt";
+			keyRow = path[depth][0];
+			keyColumn = path[depth][1];
 		}
 		else
 		{
-			wuNameBuilder << "rake_wu_r10_" << std::setw(16) << std::setfill('0') << workunitNumber << ".txt";
+			keyRow = workunitKeyRowId;
+			keyColumn = workunitKeyColumnId;
 		}
-		workunitFileName = wuNameBuilder.str();
+		workunitKeyCellValue = newSquare.Matrix[keyRow][keyColumn];
 
-		// Формируем файл с заданием 
-		cout << "Workunit " << workunitFileName << ":" << endl;
-		cout << newSquare << endl;
+		// Формируем название файла
+		workunitFileName = GetWorkunitFileName(workunitsPrefix, workunitNumber);
 
-		// Открываем файл
-		workunitFile.open(workunitFileName.c_str(), std::ios_base::out);
+		// Формируем файл с заданием (шарды работают параллельно и задания не выводят)
+		if (shardDepth == 0)
+		{
+			cout << "Workunit " << workunitFileName << ":" << endl;
+			cout << newSquare << endl;
+		}
+
+		// Открываем файл (поток создаётся только здесь: при замере скорости и записи в архив он не нужен)
+		fstream workunitFile(workunitFileName.c_str(), std::ios_base::out);
+
+		// Записываем оценки трудоёмкости задания (до заголовка, приложение их пропускает)
+		if (probesCount > 0)
+		{
+			workunitFile << "# Estimated search nodes: " << nodes << endl
+				<< "# Estimated runtime, s: " << nodes * nodeCost << endl
+				<< endl;
+		}
+
+		// Записываем размер орбиты префикса - число эквивалентных ему префиксов, включая его самого
+		if (symmetryReduction == Yes)
+		{
+			workunitFile << "# Orbit size: " << orbitSize << endl
+				<< endl;
+		}
 
 		// Записываем заголовки и квадрат, с которого надо начинать генерацию
 		workunitFile << "# RakeSearch of diagonal Latin squares" << endl
@@ -987,26 +1833,25 @@ void Generator::ProcessWorkunitR10()
 			<< endl;
 
 		// Записываем число клеток в пути
-		workunitFile << (Rank - 1)*Rank - CellsInPath << endl
+		workunitFile << CellsInPath - depth + workunitCellsInPath << endl
 		<< endl;
 
-		// Записываем путь переходов по клеткам
-		workunitFile
-			<< "2 3" << endl << "2 4" << endl << "2 5" << endl << "2 6" << endl << "2 8" << endl << "2 9" << endl
-			<< "3 0" << endl << "3 1" << endl << "3 2" << endl << "3 4" << endl << "3 5" << endl << "3 7" << endl << "3 8" << endl << "3 9" << endl
-			<< "4 0" << endl << "4 1" << endl << "4 2" << endl << "4 3" << endl << "4 6" << endl << "4 7" << endl << "4 8" << endl << "4 9" << endl
-			<< "5 0" << endl << "5 1" << endl << "5 2" << endl << "5 3" << endl << "5 6" << endl << "5 7" << endl << "5 8" << endl << "5 9" << endl
-			<< "6 0" << endl << "6 1" << endl << "6 2" << endl << "6 4" << endl << "6 5" << endl << "6 7" << endl << "6 8" << endl << "6 9" << endl
-			<< "7 0" << endl << "7 1" << endl << "7 3" << endl << "7 4" << endl << "7 5" << endl << "7 6" << endl << "7 8" << endl << "7 9" << endl
-			<< "8 0" << endl << "8 2" << endl << "8 3" << endl << "8 4" << endl << "8 5" << endl << "8 6" << endl << "8 7" << endl << "8 9" << endl
-			<< "9 1" << endl << "9 2" << endl << "9 3" << endl << "9 4" << endl << "9 5" << endl << "9 6" << endl << "9 7" << endl << "9 8" << endl << endl;
+		// Записываем путь переходов по клеткам: незаполненные клетки пути генератора, затем путь обхода заданий
+		for (int i = depth; i < CellsInPath; i++)
+		{
+			workunitFile << path[i][0] << " " << path[i][1] << endl;
+		}
+		for (int i = 0; i < workunitCellsInPath; i++)
+		{
+			workunitFile << workunitPath[i][0] << " " << workunitPath[i][1] << endl;
+		}
+		workunitFile << endl;
 
 		// Запись координаты ключевой клетки и её значение
-		workunitFile << workunitKeyRowId << " " << workunitKeyColumnId << " " << workunitKeyCellValue << endl;
+		workunitFile << keyRow << " " << keyColumn << " " << workunitKeyCellValue << endl;
 		// Запись координат текущей клетки и идентификатора текущей клетки в пути
-		workunitFile << workunitKeyRowId << " " << workunitKeyColumnId << " " << 0 << endl;
+		workunitFile << keyRow << " " << keyColumn << " " << 0 << endl;
 		workunitFile << endl;
-
 		// Запись состояний диагоналей, строк, столбцов и истории использования значений (копия из Write!)
 			// Запись информации о значениях на главной диагонали
 			for (int i = 0; i < Rank; i++)
@@ -1048,13 +1893,14 @@ void Generator::ProcessWorkunitR10()
 			workunitFile << endl;
 
 			// Запись информации об истории значений в клетках квадрата
+			GetCellsHistory(history);
 			for (int h = 0; h < Rank; h++)
 			{
 				for (int i = 0; i < Rank; i++)
 				{
 					for (int j = 0; j < Rank; j++)
 					{
-						workunitFile << ((flagsCellsHistory[i][j] & (1u << h)) > 0 ? 1 : 0) << " ";
+						workunitFile << ((history[i][j] & (1u << h)) > 0 ? 1 : 0) << " ";
 					}
 					workunitFile << endl;
 				}
@@ -1069,9 +1915,814 @@ void Generator::ProcessWorkunitR10()
 			// Запись данных компоненты перетасовки строк - число найденных пар для текущего квадрата, общее число пар и число квадратов с парами
 			workunitFile << "0 0 0 " << endl;
 
+			// Запись диапазона префиксов пути, если задание ограничено им
+			if (rangeEnd >= 0)
+			{
+				workunitFile << endl
+					<< "# Path prefix range" << endl
+					<< rangeStart << " " << rangeEnd << endl;
+			}
+
 		// Закрываем файл
 		workunitFile.close();
 
 	// Увеличиваем счётчик сгенерированных заданий 
 	workunitsCount++;
 }
+
+
+// Формирование очередного задания для квадратов 8-го ранга
+void Generator::ProcessWorkunitR8()
+{
+	std::stringstream wuNameBuilder;
+
+	// Увеличиваем счётчик номера снимка
+	snapshotNumber++;
+
+	// Формируем название файла
+	if (!workunitsDirectory.empty())
+	{
+		wuNameBuilder << workunitsDirectory << "/wu_" << std::setw(6) << std::setfill('0') << snapshotNumber << ".txt";
+	}
+	else
+	{
+		wuNameBuilder << "wu_" << std::setw(6) << std::setfill('0') << snapshotNumber << ".txt";
+	}
+
+	WriteLegacyWorkunit(wuNameBuilder.str());
+}
+
+
+// Формирование очередного задания для квадратов 9-го ранга
+void Generator::ProcessWorkunitR9()
+{
+	std::stringstream wuNameBuilder;
+
+	// Увеличиваем счётчик номера снимка
+	snapshotNumber++;
+
+	// Формируем название файла
+	if (!workunitsDirectory.empty())
+	{
+		wuNameBuilder << workunitsDirectory << "/wu_" << std::setw(9) << std::setfill('0') << snapshotNumber << ".txt";
+	}
+	else
+	{
+		wuNameBuilder << "wu_" << std::setw(9) << std::setfill('0') << snapshotNumber << ".txt";
+	}
+
+	WriteLegacyWorkunit(wuNameBuilder.str());
+}
+
+
+// Запись файла задания в формате RakeSearch V1/V2: путь генератора заполнен целиком, в задание пишется путь обхода
+// заданий. Столбцы записываются по значениям, а после состояния генератора идёт состояние компоненты поиска пар
+void Generator::WriteLegacyWorkunit(string workunitFileName)
+{
+	fstream workunitFile;
+	unsigned int history[Rank][Rank];
+	int workunitKeyCellValue;
+
+	// При замере скорости задания только подсчитываются
+	if (isBenchmark == Yes)
+	{
+		workunitsCount++;
+		return;
+	}
+
+	// Формируем задание
+		// Определение стопорного значения ключевой клетки
+		workunitKeyCellValue = newSquare.Matrix[workunitKeyRowId][workunitKeyColumnId];
+
+		// Формируем файл с заданием
+		cout << "Workunit " << workunitFileName << ":" << endl;
+		cout << newSquare << endl;
+
+		// Открываем файл
+		workunitFile.open(workunitFileName.c_str(), std::ios_base::out);
+
+		// Записываем заголовки и квадрат, с которого надо начинать генерацию
+		workunitFile << "# Move search of pairs OLDS status" << endl
+			<< endl
+			<< "# Generation of DLS status" << endl
+			<< endl
+			<< Rank << endl
+			<< endl
+			<< newSquare
+			<< endl;
+
+		// Записываем число клеток в пути
+		workunitFile << workunitCellsInPath << endl
+			<< endl;
+
+		// Записываем путь переходов по клеткам
+		for (int i = 0; i < workunitCellsInPath; i++)
+		{
+			workunitFile << workunitPath[i][0] << " " << workunitPath[i][1] << endl;
+		}
+		workunitFile << endl;
+
+		// Запись координаты ключевой клетки и её значение
+		workunitFile << workunitKeyRowId << " " << workunitKeyColumnId << " " << workunitKeyCellValue << endl;
+		// Запись координат текущей клетки и идентификатора текущей клетки в пути
+		workunitFile << workunitKeyRowId << " " << workunitKeyColumnId << " " << 0 << endl;
+		workunitFile << endl;
+
+		// Запись состояний диагоналей, строк, столбцов и истории использования значений (копия из Write!)
+			// Запись информации о значениях на главной диагонали
+			for (int i = 0; i < Rank; i++)
+			{
+				workunitFile << ((flagsPrimary & (1u << i)) > 0 ? 1 : 0) << " ";
+			}
+			workunitFile << endl;
+
+			// Запись информации о значениях на побочной диагонали
+			for (int i = 0; i < Rank; i++)
+			{
+				workunitFile << ((flagsSecondary & (1u << i)) > 0 ? 1 : 0) << " ";
+			}
+			workunitFile << endl;
+
+			// Дополнительная пустая строка
+			workunitFile << endl;
+
+			// Запись информации о значениях в строках
+			for (int i = 0; i < Rank; i++)
+			{
+				for (int j = 0; j < Rank; j++)
+				{
+					workunitFile << ((flagsRows[i] & (1u << j)) > 0 ? 1 : 0) << " ";
+				}
+				workunitFile << endl;
+			}
+			workunitFile << endl;
+
+			// Запись информации о значениях в столбцах
+			for (int i = 0; i < Rank; i++)
+			{
+				for (int j = 0; j < Rank; j++)
+				{
+					workunitFile << ((flagsColumns[j] & (1u << i)) > 0 ? 1 : 0) << " ";
+				}
+				workunitFile << endl;
+			}
+			workunitFile << endl;
+
+			// Запись информации об истории значений в клетках квадрата
+			GetCellsHistory(history);
+			for (int h = 0; h < Rank; h++)
+			{
+				for (int i = 0; i < Rank; i++)
+				{
+					for (int j = 0; j < Rank; j++)
+					{
+						workunitFile << ((history[i][j] & (1u << h)) > 0 ? 1 : 0) << " ";
+					}
+					workunitFile << endl;
+				}
+				workunitFile << endl;
+			}
+			workunitFile << endl;
+
+			// Запись информации о числе сгенерированных WU
+			workunitFile << 0 << endl
+				<< endl;
+
+			// Запись данных компоненты перетасовки строк
+			workunitFile << "# Move search component status" << endl
+				<< endl
+				<< "0 0 0" << endl
+				<< "0 0" << endl;
+
+		// Закрываем файл
+		workunitFile.close();
+
+	// Увеличиваем счётчик сгенерированных заданий 
+	workunitsCount++;
+}
+
+
+// Маска допустимых значений пустой клетки пути генератора с номером cellNumber (история пустых клеток не используется)
+unsigned int Generator::GetFreeValues(int cellNumber)
+{
+	int r = path[cellNumber][0];
+	int c = path[cellNumber][1];
+	unsigned int freeValuesMask = flagsRows[r] & flagsColumns[c];
+
+	if (r == c)
+	{
+		freeValuesMask &= flagsPrimary;
+	}
+	if (r == Rank - 1 - c)
+	{
+		freeValuesMask &= flagsSecondary;
+	}
+
+	return freeValuesMask;
+}
+
+
+// Запись значения в клетку с отметкой во флагах строк, столбцов и диагоналей (история не меняется)
+void Generator::SetCellValue(int rowId, int columnId, int value)
+{
+	newSquare.Matrix[rowId][columnId] = value;
+	flagsRows[rowId] &= ~(1u << value);
+	flagsColumns[columnId] &= ~(1u << value);
+	if (rowId == columnId)
+	{
+		flagsPrimary &= ~(1u << value);
+	}
+	if (rowId == Rank - 1 - columnId)
+	{
+		flagsSecondary &= ~(1u << value);
+	}
+}
+
+
+// Удаление значения из клетки с возвратом его во флаги строк, столбцов и диагоналей
+void Generator::ClearCellValue(int rowId, int columnId)
+{
+	int value = newSquare.Matrix[rowId][columnId];
+
+	newSquare.Matrix[rowId][columnId] = Square<Rank>::Empty;
+	flagsRows[rowId] |= 1u << value;
+	flagsColumns[columnId] |= 1u << value;
+	if (rowId == columnId)
+	{
+		flagsPrimary |= 1u << value;
+	}
+	if (rowId == Rank - 1 - columnId)
+	{
+		flagsSecondary |= 1u << value;
+	}
+}
+
+
+// Подсчёт числа заданий (листьев дерева генератора) в поддереве с depth заполненными клетками пути.
+// Клетки диагоналей перебираются, а клетки вне диагоналей считаются по строкам без перебора всех вариантов
+long long Generator::CountSubtree(int depth)
+{
+	long long count = 0;
+
+	if (depth == CellsInPath)
+	{
+		return 1;
+	}
+
+	if (depth >= minRootDepth)
+	{
+		int cells[CellsInPath];
+
+		for (int i = depth; i < CellsInPath; i++)
+		{
+			cells[i - depth] = i;
+		}
+
+		return CountRowAssignments(cells, CellsInPath - depth);
+	}
+
+	unsigned int freeValuesMask = GetFreeValues(depth);
+
+	while (freeValuesMask)
+	{
+		int value = __builtin_ctz(freeValuesMask);
+		freeValuesMask &= freeValuesMask - 1;
+
+		SetCellValue(path[depth][0], path[depth][1], value);
+		count += CountSubtree(depth + 1);
+		ClearCellValue(path[depth][0], path[depth][1]);
+	}
+
+	return count;
+}
+
+
+// Сжатие маски mask до битов, выставленных в base: i-й бит результата - i-й выставленный бит base
+static unsigned int CompressMask(unsigned int mask, unsigned int base)
+{
+	unsigned int result = 0;
+
+	for (int i = 0; base; i++)
+	{
+		unsigned int bit = base & (0u - base);
+		if (mask & bit)
+		{
+			result |= 1u << i;
+		}
+		base ^= bit;
+	}
+
+	return result;
+}
+
+
+// Подсчёт числа заполнений клеток cells (номера клеток пути генератора) вне диагоналей. Берётся строка первой
+// клетки: клетки строки, столбцы которых встречаются в других строках (связанные), перебираются, а число
+// заполнений остальных клеток строки зависит только от оставшихся в строке значений и считается один раз
+// динамическим программированием по подмножествам значений строки
+long long Generator::CountRowAssignments(int* cells, int cellsCount)
+{
+	int linked[CellsInPath];
+	int unlinked[CellsInPath];
+	int other[CellsInPath];
+	int linkedCount = 0;
+	int unlinkedCount = 0;
+	int otherCount = 0;
+	int rowId;
+	unsigned int rowValues;
+	int valuesCount;
+	vector<long long> ways;
+
+	if (cellsCount == 0)
+	{
+		return 1;
+	}
+
+	// Делим клетки на клетки строки и остальные
+	rowId = path[cells[0]][0];
+	for (int i = 0; i < cellsCount; i++)
+	{
+		if (path[cells[i]][0] != rowId)
+		{
+			other[otherCount++] = cells[i];
+		}
+	}
+	for (int i = 0; i < cellsCount; i++)
+	{
+		if (path[cells[i]][0] == rowId)
+		{
+			int isLinked = No;
+			for (int j = 0; j < otherCount; j++)
+			{
+				if (path[other[j]][1] == path[cells[i]][1])
+				{
+					isLinked = Yes;
+				}
+			}
+
+			if (isLinked == Yes)
+			{
+				linked[linkedCount++] = cells[i];
+			}
+			else
+			{
+				unlinked[unlinkedCount++] = cells[i];
+			}
+		}
+	}
+
+	// ways[m] - число заполнений несвязанных клеток строки значениями из подмножества m значений строки
+	rowValues = flagsRows[rowId];
+	valuesCount = __builtin_popcount(rowValues);
+	if (unlinkedCount > 3 && valuesCount <= 16)
+	{
+		unsigned int allowed[CellsInPath];
+
+		for (int i = 0; i < unlinkedCount; i++)
+		{
+			int c = path[unlinked[i]][1];
+			allowed[i] = CompressMask(flagsColumns[c], rowValues);
+		}
+
+		ways.assign(1u << valuesCount, 0);
+		ways[0] = 1;
+		for (unsigned int mask = 1; mask < ways.size(); mask++)
+		{
+			int k = __builtin_popcount(mask) - 1;
+			if (k < unlinkedCount)
+			{
+				for (unsigned int bits = mask & allowed[k]; bits; bits &= bits - 1)
+				{
+					ways[mask] += ways[mask ^ (bits & (0u - bits))];
+				}
+			}
+		}
+	}
+
+	return CountLinkedAssignments(linked, linkedCount, unlinked, unlinkedCount, other, otherCount, rowValues, ways);
+}
+
+
+// Перебор значений связанных клеток строки. После заполнения всех связанных клеток число вариантов равно
+// произведению числа заполнений несвязанных клеток строки на число заполнений клеток других строк
+long long Generator::CountLinkedAssignments(int* linked, int linkedCount, int* unlinked, int unlinkedCount,
+	int* other, int otherCount, unsigned int rowValues, vector<long long>& ways)
+{
+	long long count = 0;
+
+	if (linkedCount == 0)
+	{
+		long long rowWays = 0;
+
+		if (ways.empty())
+		{
+			rowWays = CountCellsDirect(unlinked, unlinkedCount);
+		}
+		else
+		{
+			// Несвязанные клетки занимают unlinkedCount значений из оставшихся в строке (обычно - все оставшиеся)
+			unsigned int rest = CompressMask(flagsRows[path[unlinked[0]][0]], rowValues);
+			if (__builtin_popcount(rest) == unlinkedCount)
+			{
+				rowWays = ways[rest];
+			}
+			else
+			{
+				for (unsigned int subset = rest; subset; subset = (subset - 1) & rest)
+				{
+					if (__builtin_popcount(subset) == unlinkedCount)
+					{
+						rowWays += ways[subset];
+					}
+				}
+			}
+		}
+
+		if (rowWays == 0)
+		{
+			return 0;
+		}
+
+		return rowWays * CountRowAssignments(other, otherCount);
+	}
+
+	int r = path[linked[0]][0];
+	int c = path[linked[0]][1];
+	unsigned int freeValuesMask = flagsRows[r] & flagsColumns[c];
+
+	while (freeValuesMask)
+	{
+		int value = __builtin_ctz(freeValuesMask);
+		freeValuesMask &= freeValuesMask - 1;
+
+		SetCellValue(r, c, value);
+		count += CountLinkedAssignments(linked + 1, linkedCount - 1, unlinked, unlinkedCount, other, otherCount, rowValues, ways);
+		ClearCellValue(r, c);
+	}
+
+	return count;
+}
+
+
+// Подсчёт числа заполнений клеток cells перебором (для небольшого числа клеток)
+long long Generator::CountCellsDirect(int* cells, int cellsCount)
+{
+	long long count = 0;
+
+	if (cellsCount == 0)
+	{
+		return 1;
+	}
+
+	unsigned int freeValuesMask = GetFreeValues(cells[0]);
+
+	if (cellsCount == 1)
+	{
+		return __builtin_popcount(freeValuesMask);
+	}
+
+	while (freeValuesMask)
+	{
+		int value = __builtin_ctz(freeValuesMask);
+		freeValuesMask &= freeValuesMask - 1;
+
+		SetCellValue(path[cells[0]][0], path[cells[0]][1], value);
+		count += CountCellsDirect(cells + 1, cellsCount - 1);
+		ClearCellValue(path[cells[0]][0], path[cells[0]][1]);
+	}
+
+	return count;
+}
+
+
+// Построение индекса для узла дерева генератора с depth заполненными клетками пути. Узлы каждого уровня
+// записываются в порядке обхода генератора, потомки узла - все допустимые значения клетки по возрастанию
+long long Generator::BuildIndex(int depth)
+{
+	long long count = 0;
+
+	if (depth == IndexDepth)
+	{
+		count = CountSubtree(depth);
+		indexCounts[depth].push_back(count);
+
+		return count;
+	}
+
+	size_t position = indexCounts[depth].size();
+	unsigned int freeValuesMask = GetFreeValues(depth);
+
+	indexCounts[depth].push_back(0);
+	indexChildren[depth].push_back((int)indexCounts[depth + 1].size());
+
+	while (freeValuesMask)
+	{
+		int value = __builtin_ctz(freeValuesMask);
+		freeValuesMask &= freeValuesMask - 1;
+
+		SetCellValue(path[depth][0], path[depth][1], value);
+		count += BuildIndex(depth + 1);
+		ClearCellValue(path[depth][0], path[depth][1]);
+
+		if (depth == 0)
+		{
+			cout << "Index: value " << value << " of cell (" << path[0][0] << ", " << path[0][1] << ") done, "
+				<< count << " workunits" << endl;
+		}
+	}
+
+	indexCounts[depth][position] = count;
+
+	return count;
+}
+
+
+// Запись индекса заданий: ранг, число уровней, путь генератора, номер первого задания, затем уровни индекса
+void Generator::WriteIndex(string index)
+{
+	fstream indexFile;
+
+	indexFile.open(index.c_str(), std::ios_base::out);
+	if (!indexFile.is_open())
+	{
+		cout << "Error opening file " << index << "!" << endl;
+		return;
+	}
+
+	indexFile << "# Workunits index for RakeSearch" << endl << endl;
+	indexFile << Rank << " " << IndexDepth << endl << endl;
+	for (int i = 0; i < CellsInPath; i++)
+	{
+		indexFile << path[i][0] << " " << path[i][1] << endl;
+	}
+	indexFile << endl << snapshotNumber + 1 << endl << endl;
+
+	for (int d = 0; d <= IndexDepth; d++)
+	{
+		indexFile << indexCounts[d].size() << endl;
+		for (size_t i = 0; i < indexCounts[d].size(); i++)
+		{
+			indexFile << indexCounts[d][i];
+			if (d < IndexDepth)
+			{
+				indexFile << " " << indexChildren[d][i];
+			}
+			indexFile << endl;
+		}
+		indexFile << endl;
+	}
+
+	indexFile.close();
+}
+
+
+// Считывание индекса заданий. Индекс подходит, только если он построен для того же пути и первого задания
+int Generator::ReadIndex(string index)
+{
+	fstream indexFile;
+	string marker;
+	int rank = 0;
+	int depth = 0;
+	long long firstNumber = 0;
+	size_t nodesCount = 0;
+
+	indexFile.open(index.c_str(), std::ios_base::in);
+	if (!indexFile.is_open())
+	{
+		return No;
+	}
+
+	std::getline(indexFile, marker);
+	indexFile >> rank >> depth;
+	if (marker != "# Workunits index for RakeSearch" || rank != Rank || depth != IndexDepth)
+	{
+		cout << "Index " << index << " is created for another rank!" << endl;
+		return No;
+	}
+	for (int i = 0; i < CellsInPath; i++)
+	{
+		int r = -1;
+		int c = -1;
+		indexFile >> r >> c;
+		if (r != path[i][0] || c != path[i][1])
+		{
+			cout << "Index " << index << " is created for another generator path!" << endl;
+			return No;
+		}
+	}
+	indexFile >> firstNumber;
+	if (firstNumber != snapshotNumber + 1)
+	{
+		cout << "Index " << index << " is created for another start parameters!" << endl;
+		return No;
+	}
+
+	for (int d = 0; d <= IndexDepth; d++)
+	{
+		indexFile >> nodesCount;
+		indexCounts[d].resize(nodesCount);
+		if (d < IndexDepth)
+		{
+			indexChildren[d].resize(nodesCount);
+		}
+		for (size_t i = 0; i < nodesCount; i++)
+		{
+			indexFile >> indexCounts[d][i];
+			if (d < IndexDepth)
+			{
+				indexFile >> indexChildren[d][i];
+			}
+		}
+	}
+
+	if (!indexFile || indexCounts[0].size() != 1)
+	{
+		cout << "Index " << index << " is damaged!" << endl;
+		return No;
+	}
+
+	return Yes;
+}
+
+
+// Подготовка к работе с индексом: генератор читает файл параметров запуска (не контрольную точку - номера заданий
+// отсчитываются от начала генерации), затем индекс считывается или строится заново и записывается в файл index
+int Generator::InitializeIndex(string start, string index)
+{
+	// Инициализация по файлу параметров запуска
+	Initialize(start, "", "", "", 0);
+	if (isInitialized != Yes)
+	{
+		cout << "Error reading start parameters from " << start << "!" << endl;
+		return No;
+	}
+
+	// Индекс строится для генерации от начала дерева: клетки пути генератора должны быть пустыми
+	if (IsRootState() == No)
+	{
+		cout << "Start parameters must have empty generator path to use the workunits index!" << endl;
+		return No;
+	}
+
+	// Индекс считает все префиксы, канонические префиксы им не нумеруются
+	if (symmetryReduction == Yes)
+	{
+		cout << "Workunits index is not supported with symmetry reduction!" << endl;
+		return No;
+	}
+
+	if (ReadIndex(index) == No)
+	{
+		cout << "Building workunits index " << index << endl;
+		for (int d = 0; d <= IndexDepth; d++)
+		{
+			indexCounts[d].clear();
+			if (d < IndexDepth)
+			{
+				indexChildren[d].clear();
+			}
+		}
+		BuildIndex(0);
+		WriteIndex(index);
+	}
+
+	cout << "Workunits in index: " << indexCounts[0][0] << " (numbers " << snapshotNumber + 1 << " - "
+		<< snapshotNumber + indexCounts[0][0] << ")" << endl;
+
+	return Yes;
+}
+
+
+// Запись задания с номером number, как его записал бы генератор без балансировки заданий, без генерации предыдущих
+// заданий: спуск по дереву генератора, на каждом уровне пропускаются поддеревья с меньшими номерами
+void Generator::WriteWorkunitByNumber(string start, string directory, string index, long long number)
+{
+	long long rest;
+	int node = 0;
+
+	if (InitializeIndex(start, index) == No)
+	{
+		return;
+	}
+
+	rest = number - snapshotNumber - 1;
+	if (rest < 0 || rest >= indexCounts[0][0])
+	{
+		cout << "Workunit " << number << " is out of range!" << endl;
+		return;
+	}
+	snapshotNumber = number - 1;
+	workunitsDirectory = directory;
+
+	for (int depth = 0; depth < CellsInPath; depth++)
+	{
+		int r = path[depth][0];
+		int c = path[depth][1];
+		unsigned int candidates = GetFreeValues(depth);
+		int child = depth < IndexDepth ? indexChildren[depth][node] : 0;
+		long long count = 0;
+
+		for (unsigned int mask = candidates; mask; mask &= mask - 1, child++)
+		{
+			int value = __builtin_ctz(mask);
+
+			SetCellValue(r, c, value);
+			count = depth < IndexDepth ? indexCounts[depth + 1][child] : CountSubtree(depth + 1);
+			if (rest < count)
+			{
+				// История клетки - кандидаты, которые генератор ещё не перебрал
+				flagsCellsHistory[r][c] = candidates & ~((2u << value) - 1);
+				break;
+			}
+			rest -= count;
+			ClearCellValue(r, c);
+		}
+		node = child;
+	}
+
+	WriteWorkunit(CellsInPath, 0, -1, 0);
+}
+
+
+// Определение номера задания по его файлу: номер - число листьев дерева генератора перед заданием
+long long Generator::FindWorkunitNumber(string start, string index, string workunit)
+{
+	fstream workunitFile;
+	string marker;
+	int rank = 0;
+	Square<Rank> workunitSquare;
+	long long number;
+	int node = 0;
+
+	if (InitializeIndex(start, index) == No)
+	{
+		return 0;
+	}
+
+	// Считывание квадрата из файла задания
+	workunitFile.open(workunit.c_str(), std::ios_base::in);
+	do
+	{
+		std::getline(workunitFile, marker);
+	}
+	while (workunitFile && marker != "# RakeSearch of diagonal Latin squares");
+	workunitFile >> rank;
+	if (!workunitFile || rank != Rank)
+	{
+		cout << "Error reading workunit " << workunit << "!" << endl;
+		return 0;
+	}
+	workunitFile >> workunitSquare;
+	workunitFile.close();
+
+	// Клетки вне пути генератора должны совпадать с квадратом параметров запуска
+	for (int i = 0; i < Rank; i++)
+	{
+		for (int j = 0; j < Rank; j++)
+		{
+			if (newSquare.Matrix[i][j] != Square<Rank>::Empty && newSquare.Matrix[i][j] != workunitSquare.Matrix[i][j])
+			{
+				cout << "Workunit " << workunit << " does not match start parameters!" << endl;
+				return 0;
+			}
+		}
+	}
+
+	number = snapshotNumber + 1;
+	for (int depth = 0; depth < CellsInPath; depth++)
+	{
+		int r = path[depth][0];
+		int c = path[depth][1];
+		int workunitValue = workunitSquare.Matrix[r][c];
+		unsigned int candidates = GetFreeValues(depth);
+		int child = depth < IndexDepth ? indexChildren[depth][node] : 0;
+
+		if (workunitValue < 0 || workunitValue >= Rank || !(candidates & (1u << workunitValue)))
+		{
+			cout << "Workunit " << workunit << " is not created by the generator!" << endl;
+			return 0;
+		}
+
+		// Пропускаем поддеревья меньших значений клетки
+		for (unsigned int mask = candidates & ((1u << workunitValue) - 1); mask; mask &= mask - 1, child++)
+		{
+			int value = __builtin_ctz(mask);
+
+			if (depth < IndexDepth)
+			{
+				number += indexCounts[depth + 1][child];
+			}
+			else
+			{
+				SetCellValue(r, c, value);
+				number += CountSubtree(depth + 1);
+				ClearCellValue(r, c);
+			}
+		}
+
+		SetCellValue(r, c, workunitValue);
+		node = child;
+	}
+
+	return number;
+}
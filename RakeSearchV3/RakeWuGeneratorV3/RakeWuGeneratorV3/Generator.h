@@ -8,9 +8,26 @@
 # include <iomanip>
 # include <string>
 # include <sstream>
+# include <vector>
+# include <array>
+# include <algorithm>
+# include <random>
+# include <thread>
+# include <atomic>
+# include <chrono>
+# include <type_traits>
 # include <immintrin.h>
 
-# include "Square.h"
+# include "../../RakeDiagSearchV3/RakeDiagSearchV3/Square.h"
+# include "../../RakeDiagSearchV3/RakeDiagSearchV3/WorkunitArchive.h"
+
+// Ранг квадрата задаётся при сборке (make RANK=...)
+# if !defined RANK
+# define RANK 10
+# endif
+
+// Классы квадратов инстанцированы только для рангов 8..32
+static_assert(RANK >= 8 && RANK <= 32, "RANK must be in range 8..32");
 
 using namespace std;
 
@@ -20,30 +37,59 @@ public:
 	Generator();							// Конструктор по умолчанию
 	Generator(Generator& source);			// Конструктор копировния
 	void GenerateWorkunits(string start, string directory, string checkpoint, string temp, int workunits);  // Выполнение генерации заданий
+	void GenerateWorkunitsSharded(string start, string directory, int workunits, int threads, int shardCells);	// Параллельная генерация заданий по шардам
+	void Benchmark(string start, int workunits);	// Замер скорости генерации заданий (задания не записываются)
+	int CreateStartParameters(string start, int symmetry);	// Формирование файла параметров запуска для ранга, с которым собран генератор
+	void SetArchive(string archive);		// Запись заданий в архив вместо отдельных текстовых файлов
+	int SetLegacyFormat(int legacy);		// Запись заданий в формате RakeSearch V1/V2 (только для 8 и 9 рангов)
+	void SetWorkunitPath(string workunitPath);	// Порядок обхода клеток в заданиях из файла (результат RakePathOptimizer)
+	void SetCostBalancing(double target, int probes, double nodeCost);	// Настройка оценки трудоёмкости заданий (время в секундах) и их балансировки
+	void WriteWorkunitByNumber(string start, string directory, string index, long long number);	// Запись задания с заданным номером без генерации предыдущих
+	long long FindWorkunitNumber(string start, string index, string workunit);	// Определение номера задания по файлу задания
 
 	Generator& operator = (Generator&  value);								// Оператор копирования
 	friend std::ostream& operator << (std::ostream& os, Generator& value);	// Оператор записи состояние генератора
 	friend std::istream& operator >> (std::istream& is, Generator& value);	// Оператор считывания состояния генератора
 
 private:
-	static const int Rank = Square::Rank;	// Ранг квадрата (для удобства)
+	static const int Rank = RANK;			// Ранг квадрата
 	static const int Free = 1;				// Флаг свободного для использования значения
 	static const int Used = 0;				// Флаг задействования значения в какой-либо клетке диагонали | строки | столбца
-	static const int CellsInPath = 28;		// Число обрабатываемых клеток. Для диагоналей квадрата 10 ранга + 1 клетка в первой строке - 18 клеток
+	static const unsigned int AllValues = Rank < 32 ? (1u << Rank) - 1 : ~0u;	// Маска всех значений клетки (сдвиг на 32 бита не определён)
+	static const int CellsInPath = (2 * Rank - 2 - Rank % 2) + (Rank - 2) + 2;	// Число обрабатываемых клеток: диагонали без первой строки, вторая строка и 2 клетки третьей. Для 10 ранга - 28 клеток
+	static const int MaxWorkunitCells = Rank * Rank;	// Максимальное число клеток в пути обхода задания
 	static const int Yes = 1;				// Флаг "Да"
 	static const int No = 0;				// Флаг "Нет"
+	static const int PathPrefixCells = Rank > 16 ? 4 : 9;	// Число клеток префикса пути задания (должно совпадать с RakeSearch::MaxPathPrefixes)
+	static const int IndexDepth = Rank - 1 < CellsInPath ? Rank - 1 : CellsInPath;	// Число уровней дерева индекса заданий (клетки главной диагонали)
+	static const int MaxSymmetries = 46080;	// Максимальный размер группы преобразований пути генератора (6 пар строк, до 19 ранга)
+
+	// Диапазон префиксов пути [start; end) при делении задания и оценки его трудоёмкости
+	struct PrefixRange
+	{
+		int start;
+		int end;
+		double nodes;
+		double cost;
+	};
 
 	void Initialize(string start, string directory, string checkpoint, string temp, int workunits);	// Инициализация поиска
 	void Start();							// Функция генерации заданий обходом клеток
+	template <typename IsKeyValueEmpty>
+	void StartImpl();						// Обход клеток (проверка ключевого значения выбирается при компиляции)
+	void ConvertHistoryToCandidates();		// Перевод истории клеток пути из формата файлов в оставшиеся кандидаты
+	void GetCellsHistory(unsigned int history[Rank][Rank]);	// История клеток в формате файлов (перебранные значения сброшены)
 	void Reset();							// Сброс всех значений внутренних структур
 
 	void CopyState(Generator& source);		// Копирование состояния
 	void Read(std::istream& is);			// Считывание состояние генератора из потока
 	void Write(std::ostream& os);			// Запись состояния генератора в поток
 
-	Square newSquare;						// Генерируемый квадрат
+	Square<Rank> newSquare;					// Генерируемый квадрат
 
 	int path[CellsInPath][2];	// Путь заполнения матрицы квадрата - path[i][0] - строка на шаге i, path[i][1] - столбец
+	int workunitPath[MaxWorkunitCells][2];	// Путь обхода клеток, записываемый в задания
+	int workunitCellsInPath;	// Число клеток в пути обхода задания
 	int keyRowId;				// Идентификатор строки ключевой клетки - по значению которой расчёт будет останавливаться
 	int keyColumnId;			// Идентификатор столбца ключевой клетки
 	int keyValue;				// Значение ключевой клетки, по достижению которого расчёт будет останавливаться
@@ -52,7 +98,8 @@ private:
 	unsigned int flagsSecondary;				// "Массив" флагов-битов задействования значений на побочной диагонали
 	unsigned int flagsColumns[Rank];			// "Матрица" значений, использовавшихся в столбцах - columns[значение][столбец] = 0|1. 0 - значение занято. 1 - свободно.
 	unsigned int flagsRows[Rank];				// "Матрица" значений, использовавшихся в строках - rows[строка][значение] = 0|1
-	unsigned int flagsCellsHistory[Rank][Rank];	// "Куб" значений, которые использовались для формирования построенной части квадрата - cellsHistory[строка][столбец][значение]
+	unsigned int flagsCellsHistory[Rank][Rank];	// "Куб" значений, которые использовались для формирования построенной части квадрата - cellsHistory[строка][столбец][значение].
+												// Для заполненных клеток пути - оставшиеся кандидаты в значения клетки (в файлах хранятся перебранные значения)
 
 	string startParametersFileName;	// Название файла с параметрами запуска расчёта
 	string checkpointFileName;		// Название файла контрольной точки
@@ -64,18 +111,76 @@ private:
 	int columnId;					// Идентификатор столбца обрабатываемой клетки
 	int cellId;						// Идентификатор клетки в перечне шагов обхода квадрата
 
-	int snapshotNumber;				// Номер снимка по которым генерируются задания (от i-1 до i)
+	long long snapshotNumber;		// Номер снимка по которым генерируются задания (от i-1 до i)
 	int workunitKeyRowId;			// Строка ключевой клетки, прописываемая в задании
 	int workunitKeyColumnId;		// Столбец ключевой клетки, приписываемый в задании
 
+	int shardDepth;					// Число первых клеток пути, значения которых фиксированы для шарда (0 - генерация без шардов)
+	string workunitsPrefix;			// Префикс названий файлов заданий (сегмент шарда)
+
+	int isBenchmark;				// Флаг замера скорости: задания только подсчитываются
+
+	int symmetryReduction;			// Флаг генерации заданий только по каноническим представителям орбит префиксов
+	vector<array<int, Rank>> symmetries;		// Преобразования B[p(i)][p(j)] = p(A[i][j]), сохраняющие первую строку и клетки пути (без тождественного)
+	vector<array<int, Rank>> symmetriesInverse;	// Обратные перестановки преобразований
+	int orbitSize;					// Размер орбиты префикса последнего канонического задания
+	void BuildSymmetries();			// Построение группы преобразований пути генератора
+	int IsCanonicalPrefix(int depth);	// Проверка, что префикс пути генератора может быть минимальным представителем своей орбиты
+	int IsPrunedBySymmetry(int depth);	// Проверка, что поддерево отсекается симметрийной редукцией
+
 	long long workunitsCount;		// Число заданий, созданных в рамках этого прогона (не входит в контрольную точку!)
 	long long workunitsToGenerate;	// Число заданий, которые необходимо сгенерировать (не входит в контрольную точку!)
 
 	void CreateCheckpoint();		// Создание контрольной точки
-	void ProcessWorkunit();			// Формирование очередного задания
-	void ProcessWorkunitR8();		// Формирование очередного задания для квадратов 8-го ранга
-	void ProcessWorkunitR9();		// Формирование очередного задания для квадратов 9-го ранга
-	void ProcessWorkunitR10();		// Формирование очередного задания для квадратов 10-го ранга
+	string GetWorkunitFileName(string prefix, long long number);	// Название файла задания с номером number
+	int IsRootState();				// Проверка, что клетки пути генератора пусты (генерация не начата)
+	int CreateShards(int depth, int shardCells, int shardsCount);	// Запись контрольных точек шардов - префиксов из shardCells клеток пути
+	static string GetShardName(const char* format, int shard);		// Название файла шарда по шаблону
+	void BuildWorkunitPath();		// Построение пути обхода клеток для заданий
+	int ReadWorkunitPath();			// Считывание порядка обхода клеток в заданиях из файла
+	void ProcessWorkunit(int depth);	// Формирование задания по поддереву с depth заполненными клетками пути генератора
+	void WriteWorkunit(int depth, int rangeStart, int rangeEnd, double nodes);	// Запись файла задания
+	void ProcessWorkunitR8();		// Формирование очередного задания для квадратов 8-го ранга в формате V1/V2
+	void ProcessWorkunitR9();		// Формирование очередного задания для квадратов 9-го ранга в формате V1/V2
+	void WriteLegacyWorkunit(string workunitFileName);	// Запись файла задания в формате V1/V2
+	int IsCheapSubtree(int depth);		// Проверка, укладывается ли поддерево в целевую трудоёмкость задания
+	void EstimateSubtree(int depth, int fixedCells);	// Оценка трудоёмкости поддерева случайными спусками (оценка Кнута)
+	int CountPathPrefixes(int pathPos);	// Подсчёт числа префиксов пути задания под текущим состоянием
+	void SplitWorkunit(int pathPos);	// Деление трудоёмкого задания по диапазонам префиксов пути
+
+	double targetCost;				// Целевая трудоёмкость задания в секундах (0 - балансировка отключена)
+	int probesCount;				// Число случайных спусков при оценке поддерева (0 - оценка не выполняется)
+	double nodeCost;				// Время обработки одного узла дерева поиска в секундах
+	int minRootDepth;				// Минимальное число заполненных клеток пути, при котором заполнены все клетки диагоналей
+	double estimatedNodes;			// Оценка числа узлов дерева поиска в последнем оценённом поддереве
+	double estimatedCost;			// Оценка времени обработки последнего оценённого поддерева в секундах
+	vector<PrefixRange> ranges;		// Диапазоны префиксов, по которым делится трудоёмкое задание
+	int rangePosition;				// Число префиксов, уже распределённых по диапазонам
+	mt19937 randomGenerator;		// Генератор случайных чисел для спусков
+
+	vector<long long> indexCounts[IndexDepth + 1];	// Индекс заданий: число заданий в поддереве каждого узла уровня (узлы в порядке обхода)
+	vector<int> indexChildren[IndexDepth];		// Номер первого потомка узла в следующем уровне индекса
+	int InitializeIndex(string start, string index);	// Чтение индекса заданий или его построение по файлу параметров запуска
+	long long BuildIndex(int depth);	// Построение уровней индекса от depth для текущего узла, возвращает число заданий в нём
+	int ReadIndex(string index);		// Считывание индекса заданий из файла
+	void WriteIndex(string index);		// Запись индекса заданий в файл
+	long long CountSubtree(int depth);	// Подсчёт числа заданий в поддереве с depth заполненными клетками пути генератора
+	long long CountRowAssignments(int* cells, int cellsCount);	// Подсчёт числа заполнений клеток вне диагоналей
+	long long CountLinkedAssignments(int* linked, int linkedCount, int* unlinked, int unlinkedCount,
+		int* other, int otherCount, unsigned int rowValues, vector<long long>& ways);	// Перебор связанных клеток строки и подсчёт заполнений остальных
+	long long CountCellsDirect(int* cells, int cellsCount);		// Подсчёт числа заполнений клеток перебором
+	unsigned int GetFreeValues(int cellNumber);	// Маска допустимых значений клетки пути генератора с номером cellNumber
+	void SetCellValue(int rowId, int columnId, int value);		// Запись значения в клетку с отметкой во флагах
+	void ClearCellValue(int rowId, int columnId);				// Удаление значения из клетки с возвратом во флаги
+
+	string workunitPathFileName;	// Название файла с порядком обхода клеток в заданиях (пустое - порядок из контрольной точки)
+	vector<array<int, 2>> customWorkunitPath;	// Заданный порядок обхода клеток в заданиях (пустой - по строкам)
+
+	int isLegacyFormat;				// Флаг записи заданий в формате RakeSearch V1/V2
+
+	string archiveFileName;			// Название файла архива заданий (пустое - задания пишутся в отдельные файлы)
+	WorkunitArchiveWriter archive;	// Архив заданий, создаваемых за этот прогон
+	void OpenArchive();				// Создание архива и запись в него общей для всех заданий части
 
 	string generatorStateHeader;	// Заголовок, после которого в файле параметров или контрольной точки идёт состояние генератора диагональных квадратов
 };
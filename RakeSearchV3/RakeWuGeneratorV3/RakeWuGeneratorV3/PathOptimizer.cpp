@@ -0,0 +1,512 @@
+// Подбор порядка обхода клеток задания RakeSearch: сравнение вариантов пути по числу узлов дерева поиска
+
+# include <stdlib.h>
+# include <math.h>
+# include <iostream>
+# include <fstream>
+# include <sstream>
+# include <iomanip>
+# include <string>
+# include <vector>
+# include <array>
+# include <random>
+# include <algorithm>
+
+using namespace std;
+
+typedef array<int, 2> Cell;
+
+// Вариант порядка обхода клеток и результаты его оценки
+struct PathOrder
+{
+	string name;			// Название способа построения
+	vector<Cell> cells;		// Клетки в порядке обхода
+	double nodes;			// Оценка числа узлов дерева поиска
+	double nodesError;		// Стандартная ошибка оценки числа узлов
+	double squares;			// Оценка числа построенных квадратов (от порядка не зависит - контроль оценки)
+};
+
+// Задание: квадрат с заполненными клетками и путь обхода пустых клеток
+struct Workunit
+{
+	int rank;
+	vector<int> square;		// Значения клеток (rank * rank), -1 - пустая клетка
+	vector<Cell> path;		// Путь обхода клеток из файла задания
+	string head;			// Текст файла до числа клеток пути (заголовки и квадрат)
+	string tail;			// Текст файла после строки текущей клетки
+	int isFresh;			// Задание не начиналось: текущая клетка - первая клетка пути, ключевое значение пустое
+	int hasPrefixRange;		// Задание ограничено диапазоном префиксов пути, который зависит от порядка клеток
+};
+
+static const int Yes = 1;
+static const int No = 0;
+
+// Состояние обхода: маски свободных значений строк и столбцов
+static vector<unsigned int> rows;
+static vector<unsigned int> columns;
+
+
+// Считывание задания в текстовом формате RakeWuGeneratorV3
+static void ReadWorkunit(const string& fileName, Workunit& workunit)
+{
+	ifstream workunitFile(fileName.c_str());
+	stringstream buffer;
+	string text;
+	string marker;
+	int cellsCount;
+	int keyRowId, keyColumnId, keyValue;
+	int rowId, columnId, cellId;
+
+	if (!workunitFile.is_open())
+	{
+		throw("Cannot open workunit file.");
+	}
+	buffer << workunitFile.rdbuf();
+	text = buffer.str();
+
+	// Поиск заголовка задания
+	istringstream is(text);
+	do
+	{
+		std::getline(is, marker);
+	}
+	while (is && marker != "# RakeSearch of diagonal Latin squares");
+
+	is >> workunit.rank;
+	if (!is || workunit.rank < 1 || workunit.rank > 32)
+	{
+		throw("Invalid workunit file.");
+	}
+
+	// Квадрат в фигурных скобках
+	is >> marker;
+	if (marker != "{")
+	{
+		throw("Invalid workunit file.");
+	}
+	workunit.square.resize(workunit.rank * workunit.rank);
+	for (int i = 0; i < workunit.rank * workunit.rank; i++)
+	{
+		is >> workunit.square[i];
+	}
+	is >> marker;
+	if (!is || marker != "}")
+	{
+		throw("Invalid workunit file.");
+	}
+	workunit.head = text.substr(0, (size_t)is.tellg());
+
+	// Путь обхода клеток
+	is >> cellsCount;
+	if (!is || cellsCount < 1 || cellsCount > workunit.rank * workunit.rank)
+	{
+		throw("Invalid workunit file.");
+	}
+	workunit.path.resize(cellsCount);
+	for (int i = 0; i < cellsCount; i++)
+	{
+		is >> workunit.path[i][0] >> workunit.path[i][1];
+		if (workunit.path[i][0] < 0 || workunit.path[i][0] >= workunit.rank
+			|| workunit.path[i][1] < 0 || workunit.path[i][1] >= workunit.rank
+			|| workunit.square[workunit.path[i][0] * workunit.rank + workunit.path[i][1]] >= 0)
+		{
+			throw("Invalid workunit path.");
+		}
+	}
+
+	// Ключевая и текущая клетки
+	is >> keyRowId >> keyColumnId >> keyValue >> rowId >> columnId >> cellId;
+	if (!is)
+	{
+		throw("Invalid workunit file.");
+	}
+	workunit.tail = text.substr((size_t)is.tellg());
+	workunit.isFresh = (keyValue < 0 && cellId == 0 && rowId == workunit.path[0][0] && columnId == workunit.path[0][1]) ? Yes : No;
+	workunit.hasPrefixRange = workunit.tail.find("# Path prefix range") != string::npos ? Yes : No;
+}
+
+
+// Заполнение масок свободных значений строк и столбцов по квадрату задания
+static void ResetFlags(const Workunit& workunit)
+{
+	const int rank = workunit.rank;
+	const unsigned int allBits = rank < 32 ? (1u << rank) - 1 : ~0u;
+
+	rows.assign(rank, allBits);
+	columns.assign(rank, allBits);
+	for (int i = 0; i < rank; i++)
+	{
+		for (int j = 0; j < rank; j++)
+		{
+			int value = workunit.square[i * rank + j];
+			if (value >= 0)
+			{
+				rows[i] &= ~(1u << value);
+				columns[j] &= ~(1u << value);
+			}
+		}
+	}
+}
+
+
+// Точный подсчёт узлов (записанных в клетки значений) и построенных квадратов в поддереве от клетки pathPos.
+// Клетки перебираются так же, как в RakeSearch::StartImpl: кандидаты - значения, свободные в строке и столбце
+static void CountSubtree(const vector<Cell>& cells, size_t pathPos, double& nodes, double& squares)
+{
+	if (pathPos == cells.size())
+	{
+		squares += 1;
+		return;
+	}
+
+	int r = cells[pathPos][0];
+	int c = cells[pathPos][1];
+
+	for (unsigned int candidates = rows[r] & columns[c]; candidates; candidates &= candidates - 1)
+	{
+		unsigned int bit = candidates & (0u - candidates);
+
+		nodes += 1;
+		rows[r] &= ~bit;
+		columns[c] &= ~bit;
+		CountSubtree(cells, pathPos + 1, nodes, squares);
+		rows[r] |= bit;
+		columns[c] |= bit;
+	}
+}
+
+
+// Оценка размера дерева поиска для порядка клеток: случайный спуск по первым клеткам пути (оценка Кнута),
+// поддерево последних exactCells клеток считается точно. Каждая выборка - несмещённая оценка числа узлов
+static void EstimateOrder(const Workunit& workunit, PathOrder& order, int probes, int exactCells, unsigned int seed)
+{
+	const size_t randomCells = order.cells.size() > (size_t)exactCells ? order.cells.size() - exactCells : 0;
+	mt19937 randomGenerator(seed);
+	double sum = 0;
+	double sumSquares = 0;
+	double squares = 0;
+
+	for (int probe = 0; probe < probes; probe++)
+	{
+		double weight = 1;
+		double nodes = 0;
+		double subtreeNodes = 0;
+		double subtreeSquares = 0;
+		size_t pathPos;
+
+		ResetFlags(workunit);
+
+		for (pathPos = 0; pathPos < randomCells; pathPos++)
+		{
+			int r = order.cells[pathPos][0];
+			int c = order.cells[pathPos][1];
+			unsigned int candidates = rows[r] & columns[c];
+			int count = __builtin_popcount(candidates);
+
+			if (count == 0)
+			{
+				break;
+			}
+
+			nodes += weight * count;
+			weight *= count;
+
+			// Случайный выбор одного из кандидатов
+			int choice = (int)(randomGenerator() % count);
+			for (int k = 0; k < choice; k++)
+			{
+				candidates &= candidates - 1;
+			}
+			unsigned int bit = candidates & (0u - candidates);
+			rows[r] &= ~bit;
+			columns[c] &= ~bit;
+		}
+
+		if (pathPos == randomCells)
+		{
+			CountSubtree(order.cells, randomCells, subtreeNodes, subtreeSquares);
+			nodes += weight * subtreeNodes;
+			squares += weight * subtreeSquares;
+		}
+
+		sum += nodes;
+		sumSquares += nodes * nodes;
+	}
+
+	order.nodes = sum / probes;
+	order.nodesError = probes > 1 ? sqrt(max(0.0, sumSquares / probes - order.nodes * order.nodes) / (probes - 1)) : 0;
+	order.squares = squares / probes;
+}
+
+
+// Число свободных значений клетки без учёта значений клеток, выбранных раньше неё
+static int GetCandidatesCount(const Workunit& workunit, const Cell& cell)
+{
+	ResetFlags(workunit);
+
+	return __builtin_popcount(rows[cell[0]] & columns[cell[1]]);
+}
+
+
+// Варианты порядка обхода клеток задания
+static vector<PathOrder> BuildOrders(const Workunit& workunit)
+{
+	const int rank = workunit.rank;
+	vector<PathOrder> orders;
+	vector<Cell> cells = workunit.path;
+	PathOrder order;
+
+	// Порядок из файла задания
+	order.name = "workunit";
+	order.cells = workunit.path;
+	orders.push_back(order);
+
+	// По строкам
+	sort(cells.begin(), cells.end());
+	order.name = "rows";
+	order.cells = cells;
+	orders.push_back(order);
+
+	// По столбцам
+	sort(cells.begin(), cells.end(), [](const Cell& a, const Cell& b) { return a[1] != b[1] ? a[1] < b[1] : a[0] < b[0]; });
+	order.name = "columns";
+	order.cells = cells;
+	orders.push_back(order);
+
+	// Чередование строк и столбцов: строка k, затем оставшиеся клетки столбца k
+	order.name = "interleaved";
+	order.cells.clear();
+	{
+		vector<int> isTaken(cells.size(), No);
+
+		for (int k = 0; k < rank; k++)
+		{
+			for (int pass = 0; pass < 2; pass++)
+			{
+				vector<size_t> line;
+
+				for (size_t i = 0; i < cells.size(); i++)
+				{
+					if (isTaken[i] == No && cells[i][pass] == k)
+					{
+						line.push_back(i);
+					}
+				}
+				sort(line.begin(), line.end(), [&](size_t a, size_t b) { return cells[a][1 - pass] < cells[b][1 - pass]; });
+				for (size_t i : line)
+				{
+					isTaken[i] = Yes;
+					order.cells.push_back(cells[i]);
+				}
+			}
+		}
+	}
+	orders.push_back(order);
+
+	// Наиболее ограниченные клетки первыми: число свободных значений клетки уменьшается на число уже выбранных
+	// клеток её строки и столбца (каждая из них займёт одно значение)
+	order.name = "constrained";
+	order.cells.clear();
+	{
+		vector<int> isTaken(cells.size(), No);
+		vector<int> candidatesCount(cells.size());
+		vector<int> rowTaken(rank, 0);
+		vector<int> columnTaken(rank, 0);
+
+		for (size_t i = 0; i < cells.size(); i++)
+		{
+			candidatesCount[i] = GetCandidatesCount(workunit, cells[i]);
+		}
+		for (size_t step = 0; step < cells.size(); step++)
+		{
+			size_t best = cells.size();
+			int bestScore = 0;
+
+			for (size_t i = 0; i < cells.size(); i++)
+			{
+				if (isTaken[i] == Yes)
+				{
+					continue;
+				}
+				int score = candidatesCount[i] - rowTaken[cells[i][0]] - columnTaken[cells[i][1]];
+				if (best == cells.size() || score < bestScore
+					|| (score == bestScore && cells[i] < cells[best]))
+				{
+					best = i;
+					bestScore = score;
+				}
+			}
+			isTaken[best] = Yes;
+			rowTaken[cells[best][0]]++;
+			columnTaken[cells[best][1]]++;
+			order.cells.push_back(cells[best]);
+		}
+	}
+	orders.push_back(order);
+
+	// Строки с меньшим числом пустых клеток первыми, внутри строки - клетки с меньшим числом свободных значений
+	order.name = "fullest-rows";
+	order.cells = cells;
+	{
+		vector<int> emptyCells(rank, 0);
+
+		for (const Cell& cell : cells)
+		{
+			emptyCells[cell[0]]++;
+		}
+		sort(order.cells.begin(), order.cells.end(), [&](const Cell& a, const Cell& b)
+		{
+			if (emptyCells[a[0]] != emptyCells[b[0]])
+			{
+				return emptyCells[a[0]] < emptyCells[b[0]];
+			}
+			if (a[0] != b[0])
+			{
+				return a[0] < b[0];
+			}
+			int countA = GetCandidatesCount(workunit, a);
+			int countB = GetCandidatesCount(workunit, b);
+			return countA != countB ? countA < countB : a[1] < b[1];
+		});
+	}
+	orders.push_back(order);
+
+	return orders;
+}
+
+
+int main(int argsCount, char* argsValues[])
+{
+	Workunit workunit;
+	vector<PathOrder> orders;
+	string workunitFileName;
+	string pathFileName;
+	string outputFileName;
+	int probes = 100000;
+	int exactCells = -1;
+	size_t best = 0;
+
+	if (argsCount < 2)
+	{
+		cout << "Usage: RakePathOptimizer <workunit> [--probes=N] [--exact-cells=N] [--path=<path file>] [--output=<workunit file>]" << endl;
+		cout << "       --probes       number of sampled subtrees per path order (default 100000)" << endl;
+		cout << "       --exact-cells  number of last path cells counted exactly in every sample (default - rank)" << endl;
+		cout << "       --path         file with the best path for RakeWuGenerator --workunit-path" << endl;
+		cout << "       --output       workunit rewritten with the best path" << endl;
+		return 1;
+	}
+
+	for (int i = 1; i < argsCount; i++)
+	{
+		string argument = argsValues[i];
+
+		if (argument.compare(0, 9, "--probes=") == 0)
+		{
+			probes = atoi(argument.c_str() + 9);
+		}
+		else if (argument.compare(0, 14, "--exact-cells=") == 0)
+		{
+			exactCells = atoi(argument.c_str() + 14);
+		}
+		else if (argument.compare(0, 7, "--path=") == 0)
+		{
+			pathFileName = argument.substr(7);
+		}
+		else if (argument.compare(0, 9, "--output=") == 0)
+		{
+			outputFileName = argument.substr(9);
+		}
+		else
+		{
+			workunitFileName = argument;
+		}
+	}
+
+	try
+	{
+		ReadWorkunit(workunitFileName, workunit);
+		if (probes < 1)
+		{
+			probes = 1;
+		}
+		if (exactCells < 0)
+		{
+			exactCells = workunit.rank;
+		}
+
+		cout << "Rank: " << workunit.rank << ", cells in path: " << workunit.path.size()
+			<< ", probes: " << probes << ", exact cells: " << exactCells << endl;
+
+		// Все порядки оцениваются с одним зерном генератора случайных чисел
+		orders = BuildOrders(workunit);
+		for (size_t i = 0; i < orders.size(); i++)
+		{
+			EstimateOrder(workunit, orders[i], probes, exactCells, 1);
+			if (orders[i].nodes < orders[best].nodes)
+			{
+				best = i;
+			}
+		}
+
+		cout << std::left << std::setw(14) << "Order" << std::right << std::setw(16) << "Nodes" << std::setw(10) << "Error, %"
+			<< std::setw(16) << "Squares" << std::setw(10) << "Relative" << endl;
+		for (const PathOrder& order : orders)
+		{
+			cout << std::left << std::setw(14) << order.name << std::right
+				<< std::setw(16) << std::scientific << std::setprecision(4) << order.nodes
+				<< std::setw(10) << std::fixed << std::setprecision(2) << (order.nodes > 0 ? 100 * order.nodesError / order.nodes : 0)
+				<< std::setw(16) << std::scientific << std::setprecision(4) << order.squares
+				<< std::setw(10) << std::fixed << std::setprecision(3) << (orders[0].nodes > 0 ? order.nodes / orders[0].nodes : 0) << endl;
+		}
+		cout << "Best order: " << orders[best].name << endl;
+
+		// Путь для генератора заданий
+		if (!pathFileName.empty())
+		{
+			ofstream pathFile(pathFileName.c_str());
+
+			if (!pathFile.is_open())
+			{
+				throw("Cannot create path file.");
+			}
+			pathFile << "# Workunit path for RakeSearch" << endl << endl << orders[best].cells.size() << endl << endl;
+			for (const Cell& cell : orders[best].cells)
+			{
+				pathFile << cell[0] << " " << cell[1] << endl;
+			}
+			cout << "Path written to " << pathFileName << endl;
+		}
+
+		// Задание с новым путём: ключевая и текущая клетки - первая клетка пути, остальное состояние не меняется
+		if (!outputFileName.empty())
+		{
+			if (workunit.isFresh == No || workunit.hasPrefixRange == Yes)
+			{
+				throw("Only workunits which are not started and not limited by path prefix range can be rewritten.");
+			}
+
+			ofstream outputFile(outputFileName.c_str());
+			const Cell& first = orders[best].cells[0];
+
+			if (!outputFile.is_open())
+			{
+				throw("Cannot create workunit file.");
+			}
+			outputFile << workunit.head << endl << endl << orders[best].cells.size() << endl << endl;
+			for (const Cell& cell : orders[best].cells)
+			{
+				outputFile << cell[0] << " " << cell[1] << endl;
+			}
+			outputFile << endl << first[0] << " " << first[1] << " " << -1 << endl;
+			outputFile << first[0] << " " << first[1] << " " << 0 << workunit.tail;
+			cout << "Workunit written to " << outputFileName << endl;
+		}
+	}
+	catch (const char* str)
+	{
+		cerr << str << endl;
+		return 1;
+	}
+
+	return 0;
+}
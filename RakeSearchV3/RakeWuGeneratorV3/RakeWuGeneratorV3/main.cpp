@@ -3,14 +3,27 @@
 # include <stdlib.h>
 # include <iostream>
 # include <string>
-# include "Square.h"
 # include "Generator.h"
 
 int main(int argsCount, char* argsValues[])
 {
         // Set the default values of variables
         int workunitsCount = 1;
+        int isStartParametersRequested = 0;
+        double targetCost = 0;
+        int probesCount = 0;
+        double nodeCost = 0;
         string workunitsDirectory = "";
+        string archiveFileName = "";
+        string workunitPathFileName = "";
+        int isBenchmarkRequested = 0;
+        int isSymmetryRequested = 0;
+        int isLegacyFormatRequested = 0;
+        int threadsCount = 0;
+        int shardCells = 2;
+        long long unrankNumber = 0;
+        string rankFileName = "";
+        string indexFileName = "workunits_index.txt";
 
         // Define the start, checkpoint and temporary checkpoint file name
         string startFileName = "start_parameters.txt";
@@ -23,6 +36,20 @@ int main(int argsCount, char* argsValues[])
         string paramValue;                          // Parsed parameter value
         string countParamName = "--count";          // Parameter name for workunits count
         string directoryParamName = "--directory";  // Parameter name for workunits place directory
+        string initParamName = "--init";            // Parameter name for start parameters file creation
+        string symmetryParamName = "--symmetry";    // Parameter name for generation of canonical prefixes only (with --init)
+        string legacyFormatParamName = "--legacy-format";   // Parameter name for workunits of RakeSearch V1/V2 format (ranks 8 and 9)
+        string targetParamName = "--target";        // Parameter name for target workunit runtime in seconds
+        string probesParamName = "--probes";        // Parameter name for number of random probes per cost estimate
+        string nodeCostParamName = "--node-cost";   // Parameter name for time of one search node processing in nanoseconds
+        string archiveParamName = "--archive";      // Parameter name for archive file of workunits
+        string workunitPathParamName = "--workunit-path";   // Parameter name for file with order of workunit cells
+        string benchmarkParamName = "--benchmark";  // Parameter name for generation speed benchmark
+        string threadsParamName = "--threads";      // Parameter name for number of threads of sharded generation
+        string shardCellsParamName = "--shard-cells";   // Parameter name for number of path cells which define a shard
+        string unrankParamName = "--unrank";        // Parameter name for number of workunit to write without generation of previous ones
+        string rankParamName = "--rank";            // Parameter name for workunit file to find its number
+        string indexParamName = "--index";          // Parameter name for index file of workunit numbers
         string delimiter = "=";                     // Delimiter for split parameter name and value in argument
         size_t delimeterPosition = -1;              // Reset the value of deimeter position
 
@@ -52,15 +79,191 @@ int main(int argsCount, char* argsValues[])
                     {
                         workunitsDirectory = paramValue;
                     }
+
+                    if (paramName == targetParamName)
+                    {
+                        targetCost = atof(paramValue.c_str());
+                    }
+
+                    if (paramName == probesParamName)
+                    {
+                        probesCount = atoi(paramValue.c_str());
+                    }
+
+                    if (paramName == workunitPathParamName)
+                    {
+                        workunitPathFileName = paramValue;
+                    }
+
+                    if (paramName == archiveParamName)
+                    {
+                        archiveFileName = paramValue;
+                    }
+
+                    if (paramName == threadsParamName)
+                    {
+                        threadsCount = atoi(paramValue.c_str());
+                    }
+
+                    if (paramName == shardCellsParamName)
+                    {
+                        shardCells = atoi(paramValue.c_str());
+                    }
+
+                    if (paramName == unrankParamName)
+                    {
+                        unrankNumber = atoll(paramValue.c_str());
+                    }
+
+                    if (paramName == rankParamName)
+                    {
+                        rankFileName = paramValue;
+                    }
+
+                    if (paramName == indexParamName)
+                    {
+                        indexFileName = paramValue;
+                    }
+
+                    if (paramName == nodeCostParamName)
+                    {
+                        nodeCost = atof(paramValue.c_str());
+                    }
+
+                    if (argument == benchmarkParamName)
+                    {
+                        isBenchmarkRequested = 1;
+                    }
+
+                    if (argument == symmetryParamName)
+                    {
+                        isSymmetryRequested = 1;
+                    }
+
+                    if (argument == legacyFormatParamName)
+                    {
+                        isLegacyFormatRequested = 1;
+                    }
+
+                    if (argument == initParamName)
+                    {
+                        isStartParametersRequested = 1;
+                    }
+            }
+        }
+
+        // Create the start parameters file for the compiled rank
+        if (isStartParametersRequested)
+        {
+            Generator startGenerator;
+            startGenerator.SetWorkunitPath(workunitPathFileName);
+            if (startGenerator.CreateStartParameters(startFileName, isSymmetryRequested) == 0)
+            {
+                cout << "Start parameters are not written!" << endl;
+                return 1;
+            }
+
+            cout << "Start parameters for rank " << RANK << " written to " << startFileName << endl;
+            if (isSymmetryRequested)
+            {
+                cout << "Symmetry reduction: workunits are generated for canonical prefixes only" << endl;
+            }
+
+            return 0;
+        }
+
+        // Write the workunit with given number or find number of the workunit using the index of workunit numbers
+        if (unrankNumber > 0)
+        {
+            Generator indexGenerator;
+            indexGenerator.SetWorkunitPath(workunitPathFileName);
+            indexGenerator.WriteWorkunitByNumber(startFileName, workunitsDirectory, indexFileName, unrankNumber);
+
+            return 0;
+        }
+        if (!rankFileName.empty())
+        {
+            Generator indexGenerator;
+            long long number = indexGenerator.FindWorkunitNumber(startFileName, indexFileName, rankFileName);
+
+            if (number > 0)
+            {
+                cout << "Workunit " << rankFileName << " number: " << number << endl;
             }
+
+            return number > 0 ? 0 : 1;
         }
 
         // Explain parsed parameters
         cout << "Workunits to generate: " << workunitsCount << endl;
         cout << "Workunits directory: " << workunitsDirectory << endl;
+        if (!archiveFileName.empty())
+        {
+            cout << "Workunits archive: " << archiveFileName << endl;
+        }
+        if (!workunitPathFileName.empty())
+        {
+            cout << "Workunit path: " << workunitPathFileName << endl;
+        }
+
+        // Cost balancing needs estimates of subtrees
+        if (targetCost > 0 && probesCount <= 0)
+        {
+            probesCount = 1000;
+        }
+        if (probesCount > 0)
+        {
+            cout << "Probes per cost estimate: " << probesCount << endl;
+        }
+        if (targetCost > 0)
+        {
+            cout << "Target workunit runtime: " << targetCost << " s" << endl;
+        }
+
+        // Measure the generation speed from the start parameters without writing of workunits
+        if (isBenchmarkRequested)
+        {
+            Generator benchmarkGenerator;
+            benchmarkGenerator.SetCostBalancing(targetCost, probesCount, nodeCost);
+            benchmarkGenerator.SetWorkunitPath(workunitPathFileName);
+            benchmarkGenerator.Benchmark(startFileName, workunitsCount);
+
+            return 0;
+        }
 
         Generator wuGenerator;
-        wuGenerator.GenerateWorkunits(startFileName, workunitsDirectory, checkpointFileName, tempCheckpointFileName, workunitsCount);
+        wuGenerator.SetCostBalancing(targetCost, probesCount, nodeCost);
+        wuGenerator.SetWorkunitPath(workunitPathFileName);
+        if (isLegacyFormatRequested)
+        {
+            // Workunits of V1/V2 format are written whole, one file per square of the generator path
+            if (wuGenerator.SetLegacyFormat(1) == 0)
+            {
+                cout << "Workunits of V1/V2 format are supported for ranks 8 and 9 only!" << endl;
+                return 1;
+            }
+            if (!archiveFileName.empty() || threadsCount > 0 || targetCost > 0)
+            {
+                cout << "Workunits of V1/V2 format are not supported with archive, threads or target runtime!" << endl;
+                return 1;
+            }
+            cout << "Workunits format: RakeSearch V1/V2" << endl;
+        }
+        if (threadsCount > 0)
+        {
+            // Sharded generation: every shard generates up to workunitsCount workunits per run
+            if (!archiveFileName.empty())
+            {
+                cout << "Archive is not supported by sharded generation!" << endl;
+                return 1;
+            }
+            wuGenerator.GenerateWorkunitsSharded(startFileName, workunitsDirectory, workunitsCount, threadsCount, shardCells);
+        }
+        else
+        {
+            wuGenerator.SetArchive(archiveFileName);
+            wuGenerator.GenerateWorkunits(startFileName, workunitsDirectory, checkpointFileName, tempCheckpointFileName, workunitsCount);
+        }
 
         cout << "Workunits generation complete!" << endl;
 		